@@ -0,0 +1,211 @@
+#include "BatchSolver.h"
+
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+
+template<typename T>
+void C_BatchSolverT<T>::setup(const C_UniformParams* new_ups, int new_count) {
+    assert(new_count > 0 && new_count <= lanes);
+
+    up.corr_selector = new_ups[0].corr_selector;
+    up.elements_count = new_ups[0].elements_count;
+    for (int lane = 0; lane < lanes; ++lane) {
+        internal_set_lane(lane, new_ups[lane < new_count ? lane : 0]);
+    }
+    count = new_count;
+
+    elements.resize((size_t)up.elements_count + 1);
+
+    if constexpr (std::is_same<T, float>::value) {
+        // There are no float sinh & cosh lanes: the exponential correction cancels out in float anyway
+        assert(up.corr_selector == 0);
+        traverse_kernel = &C_BatchSolverT::internal_traverse<0>;
+    }
+    else if (up.corr_selector == 0) {
+        traverse_kernel = &C_BatchSolverT::internal_traverse<0>;
+    }
+    else {
+        traverse_kernel = &C_BatchSolverT::internal_traverse<1>;
+    }
+}
+
+template<typename T>
+void C_BatchSolverT<T>::traverse(size_t begin, size_t end) {
+    if constexpr (std::is_same<T, float>::value) {
+        C_DenormalsFlush flush;
+        (this->*traverse_kernel)(begin, end);
+    }
+    else {
+        (this->*traverse_kernel)(begin, end);
+    }
+}
+
+template<typename T>
+template<int corr_selector>
+void C_BatchSolverT<T>::internal_traverse(size_t begin, size_t end) {
+    Lane each_length = up.total_length / (T)up.elements_count;
+
+    if (begin == 0) {
+        C_SolutionFullT<Lane> border = C_EQLINK_setup_initial_border(up);
+        elements[0] = C_border_element(border);
+    }
+
+    for (size_t element_i = begin; element_i < end; ++element_i) {
+        C_SolutionFullT<Lane> full0 = elements[element_i].full;
+        C_SolutionBaseT<Lane> base0 = C_EQLINK_setup_base(up, full0);
+        C_SolutionCorrT<Lane> corr0 = C_EQLINK_setup_corr(up, full0, base0);
+        elements[element_i].base = base0;
+        elements[element_i].corr = corr0;
+
+        C_SolutionBaseT<Lane> base1 = C_EQLINK_link_base(up, full0, base0, each_length);
+        C_SolutionCorrT<Lane> corr1 = C_EQLINK_link_corr_of<corr_selector>(up, full0, base0, corr0, each_length);
+        C_SolutionFullT<Lane> full1 = C_EQLINK_link_full(up, full0, base0, base1, corr1, each_length);
+
+        elements[element_i + 1] = C_border_element(full1);
+    }
+}
+
+template<typename T>
+C_Element C_BatchSolverT<T>::get_element(int lane, size_t element_i) const {
+    return C_convert<C_float>(C_lane_get(elements[element_i], lane));
+}
+
+template<typename T>
+C_float C_BatchSolverT<T>::end_deviation(int lane) const {
+    return C_lane_get(elements[up.elements_count].full.y, lane);
+}
+
+template<typename T>
+C_TraverseStatus C_BatchSolverT<T>::lane_status(int lane) const {
+    C_TraverseStatus status;
+    size_t elements_count = (size_t)up.elements_count;
+    if (std::isfinite(end_deviation(lane))) {
+        return status;
+    }
+
+    status.reason = C_TRAVERSE_NON_FINITE;
+    status.element_i = elements_count - 1;
+    for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+        C_float y = C_lane_get(elements[element_i + 1].full.y, lane);
+        if (!std::isfinite(y)) {
+            status.element_i = element_i;
+            status.value = y;
+            break;
+        }
+    }
+    return status;
+}
+
+template<typename T>
+std::vector<C_FitResult> C_BatchSolverT<T>::fit_angle(C_FitParams fp) {
+    int fit_count = count;
+    std::vector<C_FitResult> results(fit_count);
+    std::vector<C_UniformParams> fit_ups(ups, ups + fit_count);
+
+    // Each lane is filled with its problem once & never refilled
+    fit_angle_stream(fp, [&](int lane, C_UniformParams& lane_up) {
+        if (lane >= fit_count || results[lane].iterations > 0) {
+            return false;
+        }
+        lane_up = fit_ups[lane];
+        return true;
+    }, [&](int lane, const C_FitResult& fit) {
+        results[lane] = fit;
+    });
+
+    count = fit_count;
+    return results;
+}
+
+template<typename T>
+void C_BatchSolverT<T>::fit_angle_stream(C_FitParams fp, const LaneFill& fill, const LaneDone& done) {
+    C_FitResult results[lanes];
+    C_AngleFitter fitters[lanes];
+    bool active[lanes] {};
+    int active_count = 0;
+    bool first = true;
+
+    auto refill = [&](int lane) {
+        C_UniformParams lane_up {};
+        active[lane] = fill(lane, lane_up);
+        if (!active[lane]) {
+            return;
+        }
+
+        // The first problem decides the shape of the whole stream
+        if (first) {
+            setup(&lane_up, 1);
+            first = false;
+        }
+        assert(lane_up.corr_selector == up.corr_selector && lane_up.elements_count == up.elements_count);
+
+        internal_set_lane(lane, lane_up);
+        fitters[lane].reset(lane_up.total_length);
+        results[lane] = C_FitResult();
+        ++active_count;
+    };
+
+    for (int lane = 0; lane < lanes; ++lane) {
+        refill(lane);
+    }
+    count = lanes;
+
+    while (active_count > 0) {
+        traverse(0, up.elements_count);
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            if (!active[lane]) {
+                continue;
+            }
+
+            C_FitResult& result = results[lane];
+            ++result.iterations;
+            result.residual = end_deviation(lane);
+            result.residual_history.push_back(result.residual);
+            result.traverse_status = lane_status(lane);
+            if (!result.traverse_status.ok()) {
+                ++result.diverged_traversals;
+            }
+
+            if (fabs(result.residual) < fp.threshold) {
+                result.converged = true;
+            }
+            if (result.converged || result.iterations >= fp.max_iterations) {
+                done(lane, result);
+                --active_count;
+                refill(lane);
+                continue;
+            }
+
+            internal_set_angle(lane, fitters[lane].next(ups[lane].initial_angle, result.residual));
+        }
+    }
+}
+
+template<typename T>
+void C_BatchSolverT<T>::export_lane(int lane, C_Solver* solver) const {
+    solver->setup(ups[lane]);
+    for (size_t element_i = 0; element_i <= (size_t)up.elements_count; ++element_i) {
+        solver->elements[element_i] = get_element(lane, element_i);
+    }
+    // Solved already, so that the next traversal doesn't overwrite it
+    solver->mark_solved();
+}
+
+template<typename T>
+void C_BatchSolverT<T>::internal_set_lane(int lane, const C_UniformParams& lane_up) {
+    ups[lane] = lane_up;
+    C_lane_set(up, lane, C_convert<T>(lane_up));
+}
+
+template<typename T>
+void C_BatchSolverT<T>::internal_set_angle(int lane, C_float angle) {
+    ups[lane].initial_angle = angle;
+    up.initial_angle.set(lane, (T)angle);
+}
+
+
+template class C_BatchSolverT<C_float>;
+template class C_BatchSolverT<float>;
@@ -0,0 +1,85 @@
+#ifndef SHADERBEAMS_BATCHSOLVER_H
+#define SHADERBEAMS_BATCHSOLVER_H
+
+#include "Solver.h"
+#include "Lanes.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+
+using C_LaneFloat = C_LanesOf<C_float>;
+using C_LaneElement = C_ElementT<C_LaneFloat>;
+using C_LaneUniformParams = C_UniformParamsT<C_LaneFloat>;
+
+// Solves several independent problems at once, one per vector lane
+// Elements are stored lane-interleaved (each field of an element holds that field for all problems),
+// so every formula runs as vector instructions across the problems
+// All problems must share corr_selector & elements_count
+// T is the number type of the lanes: C_float, or float for twice as many lanes (linear correction only, see C_PRECISION_FLOAT)
+template<typename T>
+class C_BatchSolverT {
+public:
+    using Lane = C_LanesOf<T>;
+
+    static constexpr int lanes = Lane::width;
+
+    // Called when a lane is free, should put the next problem into up & return true (or false if there are none left)
+    using LaneFill = std::function<bool(int lane, C_UniformParams& up)>;
+    // Called when a lane's fit is done, while the lane still holds its solution
+    using LaneDone = std::function<void(int lane, const C_FitResult& fit)>;
+
+    // Unused lanes (count < lanes) repeat the first problem
+    void setup(const C_UniformParams* new_ups, int new_count);
+
+    [[nodiscard]] bool was_setup() const { return count > 0; }
+
+    [[nodiscard]] int size() const { return count; }
+
+    void traverse(size_t begin, size_t end);
+
+    [[nodiscard]] const C_UniformParams& lane_params(int lane) const { return ups[lane]; }
+
+    [[nodiscard]] C_Element get_element(int lane, size_t element_i) const;
+
+    [[nodiscard]] C_float end_deviation(int lane) const;
+
+    // Lanes are traversed in lockstep, so a diverging lane can't stop early (& saves nothing by it):
+    // it's only checked for non-finite values once the traversal is done, at the first element they appear at
+    [[nodiscard]] C_TraverseStatus lane_status(int lane) const;
+
+    // Fits all initial angles in lockstep, each lane with its own fitter
+    // Lanes that are done keep their angle (and so their solution) while the others iterate
+    std::vector<C_FitResult> fit_angle(C_FitParams fp);
+
+    // Fits a stream of problems: as soon as a lane is done, it's refilled with the next problem,
+    // so that lanes don't idle until the slowest problem of a batch converges
+    void fit_angle_stream(C_FitParams fp, const LaneFill& fill, const LaneDone& done);
+
+    // Copies the lane's problem & solution into a plain solver
+    void export_lane(int lane, C_Solver* solver) const;
+
+private:
+    template<int corr_selector>
+    void internal_traverse(size_t begin, size_t end);
+
+    void internal_set_lane(int lane, const C_UniformParams& lane_up);
+
+    void internal_set_angle(int lane, C_float angle);
+
+    C_UniformParamsT<Lane> up {};
+    C_UniformParams ups[lanes] {};
+    int count = 0;
+
+    // Instantiation for up.corr_selector, picked in setup()
+    void (C_BatchSolverT::*traverse_kernel)(size_t, size_t) = nullptr;
+
+    std::vector<C_ElementT<Lane>> elements;
+};
+
+using C_BatchSolver = C_BatchSolverT<C_float>;
+using C_BatchSolverFloat = C_BatchSolverT<float>;
+
+
+#endif //SHADERBEAMS_BATCHSOLVER_H
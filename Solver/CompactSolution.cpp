@@ -0,0 +1,221 @@
+#include "CompactSolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+void C_CompactSolution::internal_re_alloc(const C_UniformParams& new_up, const C_CompactParams& new_cp) {
+    up = new_up;
+    cp = new_cp;
+    cp.stride = std::max(cp.stride, 1);
+
+    size_t elements_count = (size_t)up.elements_count;
+    size_t kept_count = (elements_count + cp.stride - 1) / cp.stride + 1;
+    kept.clear();
+    kept_float.clear();
+    if (cp.single_precision) {
+        kept_float.resize(kept_count);
+    }
+    else {
+        kept.resize(kept_count);
+    }
+    EI_profile.clear();
+    weight_profile.clear();
+}
+
+void C_CompactSolution::internal_keep(size_t element_i, const C_SolutionFull& full) {
+    size_t elements_count = (size_t)up.elements_count;
+    size_t kept_i;
+    if (element_i == elements_count) {
+        kept_i = cp.single_precision ? kept_float.size() - 1 : kept.size() - 1;
+    }
+    else if (element_i % cp.stride == 0) {
+        kept_i = element_i / cp.stride;
+    }
+    else {
+        return;
+    }
+
+    if (cp.single_precision) {
+        kept_float[kept_i] = C_convert<float>(full);
+    }
+    else {
+        kept[kept_i] = full;
+    }
+}
+
+void C_CompactSolution::store(const C_Solver& solver, const C_CompactParams& new_cp) {
+    internal_re_alloc(solver.up, new_cp);
+
+    size_t elements_count = (size_t)up.elements_count;
+    if (solver.has_EI_profile()) {
+        EI_profile.resize(elements_count);
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            EI_profile[element_i] = solver.element_EI(element_i);
+        }
+    }
+    if (solver.has_weight_profile()) {
+        weight_profile.resize(elements_count);
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            weight_profile[element_i] = solver.element_weight(element_i);
+        }
+    }
+
+    for (size_t element_i = 0; element_i < elements_count; element_i += cp.stride) {
+        internal_keep(element_i, solver.elements[element_i].full);
+    }
+    internal_keep(elements_count, solver.elements[elements_count].full);
+}
+
+C_FitResult C_CompactSolution::solve(const C_UniformParams& new_up, const C_CompactParams& new_cp, bool fit, C_FitParams fp,
+                                     const std::atomic<bool>* cancel_flag) {
+    internal_re_alloc(new_up, new_cp);
+
+    size_t elements_count = (size_t)up.elements_count;
+    // Checked between chunks of elements, as C_Solver does
+    const size_t cancel_check_elements = 4096;
+
+    C_FitResult result;
+    C_AngleFitter fitter;
+    fitter.reset(up.total_length);
+
+    while (true) {
+        C_SolutionFull full = C_EQLINK_setup_initial_border(up, up.total_weight / 2.0);
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            internal_keep(element_i, full);
+            full = internal_next_border(element_i, internal_setup(element_i, full));
+
+            if (cancel_flag != nullptr && element_i % cancel_check_elements == 0 && cancel_flag->load(std::memory_order_relaxed)) {
+                result.cancelled = true;
+                return result;
+            }
+        }
+        internal_keep(elements_count, full);
+        ++result.iterations;
+
+        result.residual = full.y;
+        result.residual_history.push_back(result.residual);
+
+        if (!fit || fabs(result.residual) < fp.threshold) {
+            result.converged = true;
+            break;
+        }
+        if (result.iterations >= fp.max_iterations) {
+            break;
+        }
+        up.initial_angle = fitter.next(up.initial_angle, result.residual);
+    }
+
+    return result;
+}
+
+C_float C_CompactSolution::internal_element_EI(size_t element_i) const {
+    if (EI_profile.empty()) {
+        return up.EI;
+    }
+    return EI_profile[std::min(element_i, EI_profile.size() - 1)];
+}
+
+C_float C_CompactSolution::internal_element_weight(size_t element_i) const {
+    if (weight_profile.empty()) {
+        return up.total_weight / (C_float)up.elements_count;
+    }
+    return weight_profile[element_i];
+}
+
+C_Element C_CompactSolution::internal_setup(size_t element_i, const C_SolutionFull& full0) const {
+    C_UniformParams up_el = up;
+    up_el.EI = internal_element_EI(element_i);
+
+    C_Element el0 = C_border_element(full0);
+    el0.base = C_EQLINK_setup_base(up_el, full0);
+    el0.corr = C_EQLINK_setup_corr(up_el, full0, el0.base, internal_element_weight(element_i));
+    return el0;
+}
+
+template<int corr_selector>
+C_SolutionFull C_CompactSolution::internal_link(size_t element_i, const C_Element& el0) const {
+    C_UniformParams up_el = up;
+    up_el.EI = internal_element_EI(element_i);
+    C_float each_length = up.total_length / (C_float)up.elements_count;
+
+    C_SolutionBase base_s = C_EQLINK_link_base(up_el, el0.full, el0.base, each_length);
+    C_SolutionCorr corr_s = C_EQLINK_link_corr_of<corr_selector>(up_el, el0.full, el0.base, el0.corr, each_length);
+    return C_EQLINK_link_full(up_el, el0.full, el0.base, base_s, corr_s, each_length);
+}
+
+C_SolutionFull C_CompactSolution::internal_next_border(size_t element_i, const C_Element& el0) const {
+    return up.corr_selector == 0 ? internal_link<0>(element_i, el0) : internal_link<1>(element_i, el0);
+}
+
+C_SolutionFull C_CompactSolution::border(size_t element_i) const {
+    size_t elements_count = (size_t)up.elements_count;
+    size_t kept_i = element_i == elements_count ? (cp.single_precision ? kept_float.size() : kept.size()) - 1
+                                                : element_i / cp.stride;
+    C_SolutionFull full = cp.single_precision ? C_convert<C_float>(kept_float[kept_i]) : kept[kept_i];
+
+    if (element_i < elements_count) {
+        for (size_t traversed_i = kept_i * cp.stride; traversed_i < element_i; ++traversed_i) {
+            full = internal_next_border(traversed_i, internal_setup(traversed_i, full));
+        }
+    }
+    return full;
+}
+
+C_Element C_CompactSolution::element(size_t element_i) const {
+    C_SolutionFull full0 = border(element_i);
+    if (element_i == (size_t)up.elements_count) {
+        return C_border_element(full0);
+    }
+    return internal_setup(element_i, full0);
+}
+
+C_Element C_CompactSolution::get_solution_at(size_t element_i, C_float s) const {
+    C_Element el0 = element(element_i);
+
+    C_UniformParams up_el = up;
+    up_el.EI = internal_element_EI(element_i);
+    C_SolutionBase base_s = C_EQLINK_link_base(up_el, el0.full, el0.base, s);
+    C_SolutionCorr corr_s = up.corr_selector == 0 ? C_EQLINK_link_corr_of<0>(up_el, el0.full, el0.base, el0.corr, s)
+                                                  : C_EQLINK_link_corr_of<1>(up_el, el0.full, el0.base, el0.corr, s);
+    C_SolutionFull full_s = C_EQLINK_link_full(up_el, el0.full, el0.base, base_s, corr_s, s);
+    return { full_s, base_s, corr_s };
+}
+
+void C_CompactSolution::expand(size_t begin, size_t end, C_Element* out) const {
+    size_t elements_count = (size_t)up.elements_count;
+    if (begin >= end) {
+        return;
+    }
+
+    C_SolutionFull full = border(begin);
+    for (size_t element_i = begin; element_i < end; ++element_i) {
+        if (element_i == elements_count) {
+            // Kept end border, rather than the traversed one (they differ in float)
+            out[element_i - begin] = C_border_element(border(elements_count));
+            break;
+        }
+        // Kept borders are taken as they are, so that expanded elements match element()
+        if (element_i % cp.stride == 0) {
+            full = border(element_i);
+        }
+        C_Element el0 = internal_setup(element_i, full);
+        out[element_i - begin] = el0;
+        full = internal_next_border(element_i, el0);
+    }
+}
+
+size_t C_CompactSolution::memory_bytes() const {
+    return kept.size() * sizeof(C_SolutionFull) + kept_float.size() * sizeof(C_SolutionFullT<float>) +
+           (EI_profile.size() + weight_profile.size()) * sizeof(C_float);
+}
+
+void C_CompactSolution::forget() {
+    kept.clear();
+    kept.shrink_to_fit();
+    kept_float.clear();
+    kept_float.shrink_to_fit();
+    EI_profile.clear();
+    weight_profile.clear();
+    up = {};
+}
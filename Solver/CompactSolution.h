@@ -0,0 +1,82 @@
+#ifndef SHADERBEAMS_COMPACTSOLUTION_H
+#define SHADERBEAMS_COMPACTSOLUTION_H
+
+#include "Solver.h"
+
+#include <atomic>
+#include <vector>
+
+
+// Storage of a solution by its border states alone: an element's base & correction (& the borders between
+// the kept ones) are recomputed from the nearest kept border when asked for
+// A border takes 80 bytes (40 in float) against an element's 208, & only every stride-th one is kept
+#define C_CompactParams_FIELDS stride, single_precision
+struct C_CompactParams {
+    // Every stride-th border is kept (the end one always is), so recomputing an element traverses up to stride - 1 others
+    int stride = 4;
+    // Borders are kept in float (recomputed elements then carry its rounding, ~1e-6 relative)
+    bool single_precision = false;
+};
+
+class C_CompactSolution {
+public:
+    // Keeps the borders of a solved solver, with its parameters & profiles
+    // Elements recomputed from them (in double) are exactly the solver's for double precision ones
+    void store(const C_Solver& solver, const C_CompactParams& new_cp);
+
+    // Solves a uniform beam without ever holding its elements: traversals carry a single border along,
+    // keeping every stride-th one as they pass it
+    // Fits the initial angle the same way as C_Solver::fit_angle() if fit (shooting chunks aren't used)
+    C_FitResult solve(const C_UniformParams& new_up, const C_CompactParams& new_cp, bool fit, C_FitParams fp,
+                      const std::atomic<bool>* cancel_flag = nullptr);
+
+    [[nodiscard]] bool stored() const { return !kept.empty() || !kept_float.empty(); }
+
+    // Border state at the start of element_i (element_i <= up.elements_count)
+    [[nodiscard]] C_SolutionFull border(size_t element_i) const;
+
+    // Element with its base & correction (the end border has none, as in C_Solver)
+    [[nodiscard]] C_Element element(size_t element_i) const;
+
+    // Same as C_Solver::get_solution_at()
+    [[nodiscard]] C_Element get_solution_at(size_t element_i, C_float s) const;
+
+    // Elements [begin, end) recomputed by a single traversal from the kept border before begin (end <= up.elements_count + 1)
+    void expand(size_t begin, size_t end, C_Element* out) const;
+
+    [[nodiscard]] C_float end_deviation() const { return border((size_t)up.elements_count).y; }
+
+    // Bytes held (kept borders & profiles)
+    [[nodiscard]] size_t memory_bytes() const;
+
+    void forget();
+
+    C_UniformParams up {};
+
+private:
+    [[nodiscard]] C_float internal_element_EI(size_t element_i) const;
+
+    [[nodiscard]] C_float internal_element_weight(size_t element_i) const;
+
+    void internal_re_alloc(const C_UniformParams& new_up, const C_CompactParams& new_cp);
+
+    void internal_keep(size_t element_i, const C_SolutionFull& full);
+
+    // Element's base & correction from its start border
+    [[nodiscard]] C_Element internal_setup(size_t element_i, const C_SolutionFull& full0) const;
+
+    // Border at the end of the element (set up by internal_setup())
+    template<int corr_selector>
+    [[nodiscard]] C_SolutionFull internal_link(size_t element_i, const C_Element& el0) const;
+
+    [[nodiscard]] C_SolutionFull internal_next_border(size_t element_i, const C_Element& el0) const;
+
+    C_CompactParams cp;
+    // Borders 0, stride, 2 stride, ... & the end one (in one of them, as per cp.single_precision)
+    std::vector<C_SolutionFull> kept;
+    std::vector<C_SolutionFullT<float>> kept_float;
+    std::vector<C_float> EI_profile, weight_profile;
+};
+
+
+#endif //SHADERBEAMS_COMPACTSOLUTION_H
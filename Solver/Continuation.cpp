@@ -0,0 +1,133 @@
+#include "Continuation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+C_float C_continuation_value(const C_UniformParams& up, int parameter) {
+    switch (parameter) {
+        case C_CONTINUATION_EI:
+            return up.EI;
+        case C_CONTINUATION_TOTAL_LENGTH:
+            return up.total_length;
+        default:
+            return up.total_weight;
+    }
+}
+
+void C_set_continuation_value(C_UniformParams& up, int parameter, C_float value) {
+    switch (parameter) {
+        case C_CONTINUATION_EI:
+            up.EI = value;
+            break;
+        case C_CONTINUATION_TOTAL_LENGTH:
+            up.total_length = value;
+            break;
+        default:
+            up.total_weight = value;
+            break;
+    }
+}
+
+// Angle at value extrapolated through the last (up to 3) points of the path, i.e. quadratically once there are enough
+static C_float predict_angle(const std::vector<C_ContinuationPoint>& path, C_float value, C_float fallback) {
+    if (path.empty()) {
+        return fallback;
+    }
+
+    size_t points_count = std::min(path.size(), (size_t)3);
+    size_t first_i = path.size() - points_count;
+    C_float angle = 0.0;
+    for (size_t i = first_i; i < path.size(); ++i) {
+        C_float weight = 1.0;
+        for (size_t j = first_i; j < path.size(); ++j) {
+            if (j != i) {
+                weight *= (value - path[j].value) / (path[i].value - path[j].value);
+            }
+        }
+        angle += weight * path[i].initial_angle;
+    }
+    return std::isfinite(angle) ? angle : path.back().initial_angle;
+}
+
+C_ContinuationResult C_continue_path(C_Solver& solver, C_UniformParams up, const C_ContinuationParams& cp, C_FitParams fp) {
+    C_ContinuationResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    C_float range = fabs(cp.end - cp.begin);
+    C_float direction = cp.end >= cp.begin ? 1.0 : -1.0;
+    C_float min_step = cp.min_step != 0.0 ? fabs(cp.min_step) : range * 1e-6;
+    C_float max_step = fmax(cp.max_step != 0.0 ? fabs(cp.max_step) : range / 4.0, min_step);
+    C_float step = cp.initial_step != 0.0 ? fabs(cp.initial_step) : range / 16.0;
+    step = fmin(fmax(step, min_step), max_step);
+    int target_iterations = std::max(cp.target_iterations, 1);
+
+    C_float value = cp.begin;
+    // Of the last accepted fit, which changes slowly along the path
+    C_float slope = 0.0;
+
+    while (true) {
+        C_ContinuationPoint point;
+        point.value = value;
+        point.predicted_angle = predict_angle(result.path, value, up.initial_angle);
+
+        C_UniformParams step_up = up;
+        C_set_continuation_value(step_up, cp.parameter, value);
+        step_up.initial_angle = point.predicted_angle;
+        solver.setup(step_up);
+
+        C_FitParams step_fp = fp;
+        step_fp.initial_slope = slope;
+        point.fit = solver.fit_angle(step_fp);
+        result.traversals += point.fit.iterations;
+        if (point.fit.cancelled) {
+            result.cancelled = true;
+            break;
+        }
+        point.initial_angle = solver.up.initial_angle;
+
+        // First point has nothing to be retried from
+        bool accepted = point.fit.converged &&
+                        (result.path.empty() || (point.fit.iterations <= 3 * target_iterations &&
+                                                 fabs(point.initial_angle - point.predicted_angle) <= cp.max_correction));
+        if (!accepted) {
+            if (result.path.empty()) {
+                break;
+            }
+            ++result.rejected_steps;
+            step /= 2.0;
+            if (step < min_step) {
+                break;
+            }
+            value = result.path.back().value + direction * step;
+            if ((cp.end - value) * direction <= 0.0) {
+                value = cp.end;
+            }
+            continue;
+        }
+
+        point.end = solver.elements[step_up.elements_count].full;
+        if (point.fit.slope != 0.0) {
+            slope = point.fit.slope;
+        }
+        int iterations = point.fit.iterations;
+        result.path.push_back(std::move(point));
+
+        if (value == cp.end) {
+            result.completed = true;
+            break;
+        }
+
+        // Step follows the fit's effort: it halves at twice the target iterations & doubles at half of them
+        C_float factor = (C_float)target_iterations / (C_float)std::max(iterations, 1);
+        step = fmin(fmax(step * fmin(fmax(factor, 0.5), 2.0), min_step), max_step);
+        value += direction * step;
+        if ((cp.end - value) * direction <= 0.0) {
+            value = cp.end;
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
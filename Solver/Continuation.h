@@ -0,0 +1,64 @@
+#ifndef SHADERBEAMS_CONTINUATION_H
+#define SHADERBEAMS_CONTINUATION_H
+
+#include "Solver.h"
+
+#include <vector>
+
+
+// Parameters a path can be traced along
+const int C_CONTINUATION_TOTAL_WEIGHT = 0;
+const int C_CONTINUATION_EI = 1;
+const int C_CONTINUATION_TOTAL_LENGTH = 2;
+
+// Load stepping (natural parameter continuation): the parameter is stepped from begin to end, each step's initial angle
+// is extrapolated from the previous solutions & corrected by the angle fit, which starts with the previous step's slope
+// Steps grow while fits take fewer than target_iterations traversals & shrink while they take more,
+// & are retried shorter when their fit took over 3 times as many
+#define C_ContinuationParams_FIELDS parameter, begin, end, initial_step, min_step, max_step, target_iterations, max_correction
+struct C_ContinuationParams {
+    // One of C_CONTINUATION_*
+    int parameter = C_CONTINUATION_TOTAL_WEIGHT;
+    C_float begin = 0.0;
+    C_float end = 1.0;
+    // Of the parameter (their sign doesn't matter), 0 means 1/16, 1e-6 & 1/4 of the range
+    C_float initial_step = 0.0;
+    C_float min_step = 0.0;
+    C_float max_step = 0.0;
+    int target_iterations = 4;
+    // Steps whose fit moved the angle further than this from the prediction are retried shorter
+    // (so that the path doesn't jump to another branch)
+    C_float max_correction = 0.2;
+};
+
+struct C_ContinuationPoint {
+    C_float value = 0.0;
+    C_float predicted_angle = 0.0;
+    C_float initial_angle = 0.0;
+    C_FitResult fit;
+    C_SolutionFull end {};
+};
+
+struct C_ContinuationResult {
+    // Whether the path got to the end of the range (rather than stopping at a step below min_step, e.g. at a limit point)
+    bool completed = false;
+    // Stopped by the solver's cancel flag (the elements don't hold a solution then)
+    bool cancelled = false;
+    // Traversals of all the fits, the rejected ones included
+    int traversals = 0;
+    int rejected_steps = 0;
+    double seconds = 0.0;
+    // Accepted points, from begin towards end (the solver holds the last one's solution once completed)
+    std::vector<C_ContinuationPoint> path;
+};
+
+C_float C_continuation_value(const C_UniformParams& up, int parameter);
+
+void C_set_continuation_value(C_UniformParams& up, int parameter, C_float value);
+
+// Traces the equilibrium path of up along cp.parameter, the first point being fitted from up.initial_angle
+// The solver keeps its precision & cancel flag; per-element profiles would be scaled inconsistently, so they're dropped
+C_ContinuationResult C_continue_path(C_Solver& solver, C_UniformParams up, const C_ContinuationParams& cp, C_FitParams fp);
+
+
+#endif //SHADERBEAMS_CONTINUATION_H
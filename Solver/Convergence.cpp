@@ -0,0 +1,105 @@
+#include "Convergence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+// Richardson extrapolation of a value known at two levels (fine at twice the elements of coarse)
+static C_float extrapolate(C_float coarse, C_float fine, C_float factor) {
+    return fine + (fine - coarse) * factor;
+}
+
+static C_SolutionFull extrapolate_end(const C_SolutionFull& coarse, const C_SolutionFull& fine, C_float factor) {
+    C_SolutionFull end = fine;
+    end.x = extrapolate(coarse.x, fine.x, factor);
+    end.y = extrapolate(coarse.y, fine.y, factor);
+    end.M = extrapolate(coarse.M, fine.M, factor);
+    end.T = extrapolate(coarse.T, fine.T, factor);
+    end.tn.t[0] = cos(end.T); end.tn.t[1] = sin(end.T);
+    end.tn.n[0] = -sin(end.T); end.tn.n[1] = cos(end.T);
+    end.Fx = extrapolate(coarse.Fx, fine.Fx, factor);
+    end.Fy = extrapolate(coarse.Fy, fine.Fy, factor);
+    return end;
+}
+
+C_ConvergenceResult C_converge_mesh(C_Solver& solver, C_UniformParams up, const C_ConvergenceParams& cp,
+                                    bool fit, C_FitParams fp) {
+    C_ConvergenceResult result;
+
+    // Fit's own error must stay well below the differences between levels
+    fp.threshold = std::min(fp.threshold, 1e-3 * cp.tolerance * up.total_length);
+
+    C_UniformParams level_up = up;
+    level_up.elements_count = std::max(cp.initial_elements_count, 1);
+
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        solver.setup(level_up);
+
+        C_ConvergenceLevel level;
+        level.elements_count = level_up.elements_count;
+        if (fit) {
+            level.fit = solver.fit_angle(fp);
+        }
+        else {
+            level.fit.traverse_status = solver.traverse(level_up.elements_count);
+            level.fit.converged = level.fit.traverse_status.ok();
+            level.fit.iterations = 1;
+            level.fit.residual = level.fit.converged ? solver.end_deviation() : NAN;
+        }
+        if (solver.cancelled()) {
+            result.cancelled = true;
+            return result;
+        }
+        level.end = solver.elements[level_up.elements_count].full;
+        level.initial_angle = solver.up.initial_angle;
+        level.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!result.levels.empty()) {
+            const C_ConvergenceLevel& previous = result.levels.back();
+            level.difference = C_state_difference(level.end, previous.end, up.total_length, up.EI);
+            if (fit) {
+                level.difference = std::max(level.difference, fabs(level.initial_angle - previous.initial_angle));
+            }
+
+            // Error falls 2^order times per level, so the rest of it (summed over the finer levels) is difference / (2^order - 1)
+            // Until the order is known it's assumed to be 1
+            result.order = 0.0;
+            if (result.levels.size() >= 2 && level.difference > 0.0) {
+                C_float order = log2(previous.difference / level.difference);
+                if (std::isfinite(order) && order > 0.0) {
+                    result.order = order;
+                }
+            }
+            C_float factor = result.order > 0.0 ? 1.0 / (pow(2.0, result.order) - 1.0) : 1.0;
+            level.error = level.difference * factor;
+
+            if (result.order > 0.0) {
+                result.extrapolated_end = extrapolate_end(previous.end, level.end, factor);
+                result.extrapolated_initial_angle = extrapolate(previous.initial_angle, level.initial_angle, factor);
+            }
+            else {
+                result.extrapolated_end = level.end;
+                result.extrapolated_initial_angle = level.initial_angle;
+            }
+            result.converged = level.error <= cp.tolerance;
+        }
+        else {
+            // A single level can't tell its error
+            level.error = INFINITY;
+            result.extrapolated_end = level.end;
+            result.extrapolated_initial_angle = level.initial_angle;
+        }
+        result.levels.push_back(std::move(level));
+
+        if (result.converged || level_up.elements_count > cp.max_elements_count / 2) {
+            break;
+        }
+        // Next level starts from this one's angle
+        level_up.elements_count *= 2;
+        level_up.initial_angle = solver.up.initial_angle;
+    }
+
+    return result;
+}
@@ -0,0 +1,53 @@
+#ifndef SHADERBEAMS_CONVERGENCE_H
+#define SHADERBEAMS_CONVERGENCE_H
+
+#include "Solver.h"
+
+#include <vector>
+
+
+// Mesh refinement: the problem is solved at initial_elements_count elements, then at twice as many, & so on,
+// until the discretisation error estimated from successive solutions is within tolerance
+#define C_ConvergenceParams_FIELDS tolerance, initial_elements_count, max_elements_count
+struct C_ConvergenceParams {
+    // Of the end state (see C_state_difference) & the fitted initial angle
+    C_float tolerance = 1e-3;
+    int initial_elements_count = 10;
+    int max_elements_count = 1 << 20;
+};
+
+struct C_ConvergenceLevel {
+    int elements_count = 0;
+    C_FitResult fit;
+    C_SolutionFull end {};
+    C_float initial_angle = 0.0;
+    // Difference from the previous (coarser) level's solution & the estimated error of this one
+    C_float difference = 0.0;
+    C_float error = 0.0;
+    double seconds = 0.0;
+};
+
+struct C_ConvergenceResult {
+    // Whether the last level's error estimate is within the tolerance
+    bool converged = false;
+    // Stopped by the solver's cancel flag (the elements don't hold a solution then)
+    bool cancelled = false;
+    // Observed order of convergence (error ~ 1 / elements_count^order), 0 until there are 3 levels that agree on one
+    C_float order = 0.0;
+    // Richardson extrapolation of the last two levels (the last level's solution while the order isn't known)
+    C_SolutionFull extrapolated_end {};
+    C_float extrapolated_initial_angle = 0.0;
+    // From the coarsest to the finest (the solver holds the last one's solution)
+    std::vector<C_ConvergenceLevel> levels;
+
+    [[nodiscard]] const C_ConvergenceLevel& last() const { return levels.back(); }
+};
+
+// Solves up (its elements_count is ignored) at doubling elements counts, stopping at the first one that meets cp.tolerance
+// Each level is warm-started from the previous level's fitted angle, & fits to a threshold well below the tolerance
+// The solver keeps its precision & cancel flag; per-element profiles can't be refined, so they're dropped
+C_ConvergenceResult C_converge_mesh(C_Solver& solver, C_UniformParams up, const C_ConvergenceParams& cp,
+                                    bool fit, C_FitParams fp);
+
+
+#endif //SHADERBEAMS_CONVERGENCE_H
@@ -0,0 +1,157 @@
+#ifndef SHADERBEAMS_DUAL_H
+#define SHADERBEAMS_DUAL_H
+
+#include "Equations.h"
+#include "Lanes.h"
+
+#include <cmath>
+#include <type_traits>
+
+
+// Dual number (forward-mode automatic differentiation): a value together with its derivatives
+// with respect to N parameters, all carried through the formulae at once
+template<typename T, int N>
+struct C_Dual {
+    static constexpr int size = N;
+
+    // Derivatives are one lane vector when it fits into the enabled vector registers,
+    // so that the chain rule runs as vector instructions
+    using Derivatives = typename std::conditional<(N * sizeof(T) <= C_SIMD_BYTES),
+            typename C_LaneVector<T, N>::type, C_LaneArray<T, N>>::type;
+
+    T v;
+    Derivatives d;
+
+    C_Dual() = default;
+
+    // Constants have zero derivatives
+    C_Dual(T value) : v(value), d {} {}
+
+    // i-th parameter itself
+    static C_Dual variable(T value, int i) {
+        C_Dual x(value);
+        x.d[i] = 1.0;
+        return x;
+    }
+
+    // Chain rule: f(a) with f'(a) = df
+    static C_Dual apply(const C_Dual& a, T f, T df) {
+        C_Dual r(f);
+        r.d = df * a.d;
+        return r;
+    }
+
+    friend C_Dual operator+(const C_Dual& a) { return a; }
+
+    friend C_Dual operator-(const C_Dual& a) {
+        C_Dual r(-a.v);
+        r.d = -a.d;
+        return r;
+    }
+
+    friend C_Dual operator+(const C_Dual& a, const C_Dual& b) {
+        C_Dual r(a.v + b.v);
+        r.d = a.d + b.d;
+        return r;
+    }
+
+    friend C_Dual operator-(const C_Dual& a, const C_Dual& b) {
+        C_Dual r(a.v - b.v);
+        r.d = a.d - b.d;
+        return r;
+    }
+
+    friend C_Dual operator*(const C_Dual& a, const C_Dual& b) {
+        C_Dual r(a.v * b.v);
+        r.d = a.d * b.v + a.v * b.d;
+        return r;
+    }
+
+    friend C_Dual operator/(const C_Dual& a, const C_Dual& b) {
+        C_Dual r(a.v / b.v);
+        r.d = (a.d - r.v * b.d) / b.v;
+        return r;
+    }
+
+    // Mixed with plain numbers (no derivatives to carry on that side)
+    friend C_Dual operator+(const C_Dual& a, T b) { C_Dual r = a; r.v += b; return r; }
+    friend C_Dual operator+(T a, const C_Dual& b) { return b + a; }
+    friend C_Dual operator-(const C_Dual& a, T b) { C_Dual r = a; r.v -= b; return r; }
+    friend C_Dual operator-(T a, const C_Dual& b) { return -b + a; }
+
+    friend C_Dual operator*(const C_Dual& a, T b) {
+        C_Dual r(a.v * b);
+        r.d = a.d * b;
+        return r;
+    }
+    friend C_Dual operator*(T a, const C_Dual& b) { return b * a; }
+
+    friend C_Dual operator/(const C_Dual& a, T b) {
+        C_Dual r(a.v / b);
+        r.d = a.d / b;
+        return r;
+    }
+    friend C_Dual operator/(T a, const C_Dual& b) {
+        T r = a / b.v;
+        return apply(b, r, -r / b.v);
+    }
+
+    C_Dual& operator+=(const C_Dual& b) { return *this = *this + b; }
+    C_Dual& operator-=(const C_Dual& b) { return *this = *this - b; }
+    C_Dual& operator*=(const C_Dual& b) { return *this = *this * b; }
+    C_Dual& operator/=(const C_Dual& b) { return *this = *this / b; }
+
+    friend bool operator==(const C_Dual& a, const C_Dual& b) {
+        for (int i = 0; i < N; ++i) {
+            if (a.d[i] != b.d[i]) return false;
+        }
+        return a.v == b.v;
+    }
+    friend bool operator!=(const C_Dual& a, const C_Dual& b) { return !(a == b); }
+};
+
+template<typename T, int N>
+struct C_ScalarOf<C_Dual<T, N>> {
+    using type = T;
+};
+
+template<typename T, int N>
+C_Dual<T, N> sin(const C_Dual<T, N>& a) {
+    return C_Dual<T, N>::apply(a, std::sin(a.v), std::cos(a.v));
+}
+
+template<typename T, int N>
+C_Dual<T, N> cos(const C_Dual<T, N>& a) {
+    return C_Dual<T, N>::apply(a, std::cos(a.v), -std::sin(a.v));
+}
+
+template<typename T, int N>
+C_Dual<T, N> sinh(const C_Dual<T, N>& a) {
+    return C_Dual<T, N>::apply(a, std::sinh(a.v), std::cosh(a.v));
+}
+
+template<typename T, int N>
+C_Dual<T, N> cosh(const C_Dual<T, N>& a) {
+    return C_Dual<T, N>::apply(a, std::cosh(a.v), std::sinh(a.v));
+}
+
+// Value without derivatives (plain numbers are returned as is)
+template<typename T>
+T C_value(const T& x) { return x; }
+
+template<typename T, int N>
+T C_value(const C_Dual<T, N>& x) { return x.v; }
+
+// Same number with another value (derivatives are kept)
+template<typename T>
+T C_with_value(const T&, T value) { return value; }
+
+template<typename T, int N>
+C_Dual<T, N> C_with_value(const C_Dual<T, N>& x, T value) {
+    C_Dual<T, N> r = x;
+    r.v = value;
+    return r;
+}
+
+
+#endif //SHADERBEAMS_DUAL_H
@@ -0,0 +1,117 @@
+#include "ElementArena.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+// Pages are touched at this spacing (the smallest page size in use)
+static const size_t TOUCH_STRIDE = 4096;
+
+static size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Block of bytes (a multiple of C_ARENA_HUGE_PAGE) starting on a C_ARENA_HUGE_PAGE boundary, or nullptr
+static void* map_block(size_t bytes) {
+#if defined(_WIN32)
+    // Large pages need a privilege users rarely have, so these are plain (page-aligned) ones
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    // Mapped with a huge page of slack, which is trimmed off both ends to leave an aligned block
+    size_t mapped_bytes = bytes + C_ARENA_HUGE_PAGE;
+    void* mapping = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    auto begin = (uintptr_t)mapping;
+    uintptr_t aligned = round_up(begin, C_ARENA_HUGE_PAGE);
+    if (aligned > begin) {
+        munmap(mapping, aligned - begin);
+    }
+    size_t tail = begin + mapped_bytes - (aligned + bytes);
+    if (tail > 0) {
+        munmap((void*)(aligned + bytes), tail);
+    }
+#if defined(MADV_HUGEPAGE)
+    madvise((void*)aligned, bytes, MADV_HUGEPAGE);
+#endif
+    return (void*)aligned;
+#endif
+}
+
+static void unmap_block(void* data, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(data, 0, MEM_RELEASE);
+#else
+    munmap(data, bytes);
+#endif
+}
+
+void* C_ElementArena::reserve(size_t bytes, C_ThreadPool* pool) {
+    if (data != nullptr && bytes <= _capacity) {
+        return data;
+    }
+
+    // Grows by half at least, so that growing step by step reallocates O(log) times
+    size_t new_capacity = std::max(round_up(std::max(bytes, (size_t)1), C_ARENA_ALIGNMENT), _capacity + _capacity / 2);
+    release();
+
+    if (use_huge_pages && new_capacity >= C_ARENA_HUGE_PAGE) {
+        new_capacity = round_up(new_capacity, C_ARENA_HUGE_PAGE);
+        data = map_block(new_capacity);
+        if (data != nullptr) {
+            _capacity = new_capacity;
+            _mapped = true;
+            internal_first_touch(pool);
+            return data;
+        }
+    }
+
+    data = ::operator new(new_capacity, std::align_val_t(C_ARENA_ALIGNMENT));
+    _capacity = new_capacity;
+    _mapped = false;
+    return data;
+}
+
+void C_ElementArena::internal_first_touch(C_ThreadPool* pool) {
+    if (pool == nullptr) {
+        pool = &C_ThreadPool::shared();
+    }
+
+    // One contiguous part per thread, as the shooting traversal splits the elements
+    size_t parts_count = pool->size();
+    size_t part_bytes = round_up((_capacity + parts_count - 1) / parts_count, TOUCH_STRIDE);
+    auto bytes = (unsigned char*)data;
+    pool->parallel_for(0, parts_count, 1, [&](size_t part_i, size_t) {
+        size_t begin = part_i * part_bytes, end = std::min(begin + part_bytes, _capacity);
+        for (size_t offset = begin; offset < end; offset += TOUCH_STRIDE) {
+            bytes[offset] = 0;
+        }
+    });
+}
+
+void C_ElementArena::release() {
+    if (data == nullptr) {
+        return;
+    }
+    if (_mapped) {
+        unmap_block(data, _capacity);
+    }
+    else {
+        ::operator delete(data, std::align_val_t(C_ARENA_ALIGNMENT));
+    }
+    data = nullptr;
+    _capacity = 0;
+    _mapped = false;
+}
@@ -0,0 +1,50 @@
+#ifndef SHADERBEAMS_ELEMENTARENA_H
+#define SHADERBEAMS_ELEMENTARENA_H
+
+#include <cstddef>
+
+
+class C_ThreadPool;
+
+// Cache lines & the widest vector registers (AVX-512)
+const size_t C_ARENA_ALIGNMENT = 64;
+// Blocks at least this large are mapped on its boundaries, so that they can be backed by transparent huge pages
+const size_t C_ARENA_HUGE_PAGE = 2 << 20;
+
+// Raw storage of the solver's elements, which keeps its capacity between sizes: only growing past it reallocates
+// (geometrically, so a slider dragged upwards reallocates a few times at most), & the contents aren't initialised
+// Large blocks are first touched by the pool's threads, each writing the contiguous part it would traverse,
+// so that their pages are placed on the NUMA nodes of those threads
+class C_ElementArena {
+public:
+    C_ElementArena() = default;
+
+    C_ElementArena(const C_ElementArena&) = delete;
+    C_ElementArena& operator=(const C_ElementArena&) = delete;
+
+    ~C_ElementArena() { release(); }
+
+    // Storage of at least bytes, aligned to C_ARENA_ALIGNMENT (previous contents are lost when it grows)
+    // pool defaults to C_ThreadPool::shared()
+    void* reserve(size_t bytes, C_ThreadPool* pool = nullptr);
+
+    void release();
+
+    [[nodiscard]] size_t capacity() const { return _capacity; }
+
+    // Whether the block is mapped (& advised to use huge pages where the system has them)
+    [[nodiscard]] bool mapped() const { return _mapped; }
+
+    // Maps large blocks (on by default), read when a block is allocated
+    static inline bool use_huge_pages = true;
+
+private:
+    void internal_first_touch(C_ThreadPool* pool);
+
+    void* data = nullptr;
+    size_t _capacity = 0;
+    bool _mapped = false;
+};
+
+
+#endif //SHADERBEAMS_ELEMENTARENA_H
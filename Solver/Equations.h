@@ -0,0 +1,570 @@
+#ifndef SHADERBEAMS_EQUATIONS_H
+#define SHADERBEAMS_EQUATIONS_H
+
+#include <cmath>
+
+
+// Formulae are generic over the floating point type F, so that the same code runs on plain numbers
+// and on lane vectors (several independent problems at once, see Lanes.h)
+
+// Underlying scalar of F (F itself for plain numbers)
+template<typename F>
+struct C_ScalarOf {
+    using type = F;
+};
+
+template<typename F>
+using C_scalar_t = typename C_ScalarOf<F>::type;
+
+
+#define C_Basis_FIELDS t, n
+template<typename F>
+struct C_BasisT {
+    F t[2];
+    F n[2];
+};
+
+#define C_SolutionFull_FIELDS x, y, M, T, tn, Fx, Fy
+template<typename F>
+struct C_SolutionFullT {
+    F x, y;
+    F M;
+    F T;
+    C_BasisT<F> tn;
+    F Fx, Fy;
+};
+
+#define C_SolutionBase_FIELDS u, w, M, T, tn
+template<typename F>
+struct C_SolutionBaseT {
+    F u, w;
+    F M;
+    F T;
+    C_BasisT<F> tn;
+};
+
+#define C_SolutionCorr_FIELDS u, w, M, T, N, Q, Pt, Pn
+template<typename F>
+struct C_SolutionCorrT {
+    F u, w;
+    F M;
+    F T;
+    F N, Q;
+    F Pt, Pn;
+};
+
+#define C_Element_FIELDS full, base, corr
+template<typename F>
+struct C_ElementT {
+    C_SolutionFullT<F> full;
+    C_SolutionBaseT<F> base;
+    C_SolutionCorrT<F> corr;
+};
+
+#define C_UniformParams_FIELDS corr_selector, EI, initial_angle, total_weight, total_length, gap, elements_count
+template<typename F>
+struct C_UniformParamsT {
+    int corr_selector;
+    F EI;
+    F initial_angle;
+    F total_weight;
+    F total_length;
+    F gap;
+    int elements_count;
+};
+
+#define UP_ARRAY_SIZE 7
+
+// Coefficient known to be zero: terms multiplied by it vanish at compile time
+// (a plain 0.0 can't do this, since 0.0 * x is not 0.0 for infinite x or NaN)
+struct C_Zero {};
+
+template<typename T>
+constexpr C_Zero operator*(C_Zero, const T&) { return {}; }
+template<typename T>
+constexpr C_Zero operator*(const T&, C_Zero) { return {}; }
+template<typename T>
+constexpr C_Zero operator/(C_Zero, const T&) { return {}; }
+constexpr C_Zero operator-(C_Zero) { return {}; }
+template<typename T>
+constexpr T operator+(const T& a, C_Zero) { return a; }
+template<typename T>
+constexpr T operator-(const T& a, C_Zero) { return a; }
+
+// Coefficients f & mu of the correction solution
+// Kernels are compiled for the default ones (f == 0, mu == 1) unless others are passed explicitly
+struct C_CorrDefault {
+    static constexpr C_Zero f {};
+    static constexpr double mu = 1.0;
+};
+
+template<typename S>
+struct C_CorrCoeffsT {
+    S f;
+    S mu;
+};
+
+template<typename F>
+C_SolutionFullT<F> C_EQLINK_setup_initial_border(const C_UniformParamsT<F>& up);
+template<typename F>
+C_SolutionFullT<F> C_EQLINK_setup_initial_border(const C_UniformParamsT<F>& up, const F& left_reaction);
+template<typename F>
+C_SolutionBaseT<F> C_EQLINK_setup_base(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0);
+template<typename F>
+C_SolutionCorrT<F> C_EQLINK_setup_corr(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0);
+template<typename F>
+C_SolutionCorrT<F> C_EQLINK_setup_corr(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const F& each_el_weight);
+template<typename F>
+C_SolutionBaseT<F> C_EQLINK_link_base(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const F& s);
+template<typename F>
+C_SolutionCorrT<F> C_EQLINK_link_corr(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s);
+template<int corr_selector, typename F>
+C_SolutionCorrT<F> C_EQLINK_link_corr_of(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s);
+template<typename F, typename Coeffs = C_CorrDefault>
+C_SolutionCorrT<F> C_EQLINK_link_corr_linear(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s,
+                                             const Coeffs& coeffs = {});
+template<typename F, typename Coeffs = C_CorrDefault>
+C_SolutionCorrT<F> C_EQLINK_link_corr_exponential(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s,
+                                                  const Coeffs& coeffs = {});
+template<typename F>
+C_SolutionFullT<F> C_EQLINK_link_full([[maybe_unused]] const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0,
+                                     const C_SolutionBaseT<F>& base_s, const C_SolutionCorrT<F>& corr_s, [[maybe_unused]] const F& s);
+
+
+template<typename F>
+C_SolutionFullT<F> C_EQLINK_setup_initial_border(const C_UniformParamsT<F>& up) {
+    // For the uniform load, each stand carries half of it
+    F each_stand_load = up.total_weight / 2.0;
+    return C_EQLINK_setup_initial_border(up, each_stand_load);
+}
+
+template<typename F>
+C_SolutionFullT<F> C_EQLINK_setup_initial_border(const C_UniformParamsT<F>& up, const F& left_reaction) {
+    // Beam's left end is hinged at a known angle
+    F x = 0.0, y = 0.0;
+    F M = 0.0;
+    F T = up.initial_angle;
+    C_BasisT<F> tn{};
+    tn.t[0] = cos(T); tn.t[1] = sin(T);
+    tn.n[0] = -sin(T); tn.n[1] = cos(T);
+
+    // Support reaction force is upward
+    F Fx = 0.0;
+    F Fy = left_reaction;
+
+    C_SolutionFullT<F> border{};
+    border.x = x;
+    border.y = y;
+    border.M = M;
+    border.T = T;
+    border.tn = tn;
+    border.Fx = Fx;
+    border.Fy = Fy;
+
+    return border;
+}
+
+template<typename F>
+C_SolutionBaseT<F> C_EQLINK_setup_base(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0) {
+    using S = C_scalar_t<F>;
+
+    // Base solution accounts for geometry
+    F u = full0.x, w = full0.y;
+    F T = full0.T;
+    C_BasisT<F> tn = full0.tn;
+
+    // Force induces a moment in the middle of the element
+    // Since we don't know the curvature yet, we treat the element as straight
+    F each_el_length = up.total_length / S(up.elements_count);
+    F middle_s = each_el_length / 2.0;
+    F F_arm_x = full0.tn.t[0] * middle_s, F_arm_y = full0.tn.t[1] * middle_s;
+    // Moment is <0 when beam goes to the right (because F then induces a counter-clockwise rotation)
+    F M = F_arm_x * full0.Fy - F_arm_y * full0.Fx;
+
+    C_SolutionBaseT<F> base0{};
+    base0.u = u;
+    base0.w = w;
+    base0.M = M;
+    base0.T = T;
+    base0.tn = tn;
+
+    return base0;
+}
+
+template<typename F>
+C_SolutionCorrT<F> C_EQLINK_setup_corr(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0) {
+    using S = C_scalar_t<F>;
+
+    // Weight is distributed uniformly
+    F each_el_weight = up.total_weight / S(up.elements_count);
+    return C_EQLINK_setup_corr(up, full0, base0, each_el_weight);
+}
+
+template<typename F>
+C_SolutionCorrT<F> C_EQLINK_setup_corr(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const F& each_el_weight) {
+    using S = C_scalar_t<F>;
+
+    // No offset or rotation at the beginning
+    F u = 0.0, w = 0.0;
+    F T = 0.0;
+
+    // Since full moment is zero (for hinge), the moment induced by F in base solution
+    // should be compensated in correction solution
+    F M = -base0.M;
+
+    // Upward force is expressed in basis (at the middle)
+    F each_el_length = up.total_length / S(up.elements_count);
+    C_SolutionBaseT<F> base_mid = C_EQLINK_link_base(up, full0, base0, each_el_length / S(2));
+    F N = full0.Fy * base_mid.tn.t[1];
+    F Q = full0.Fy * base_mid.tn.n[1];
+
+    // Each element has weight
+    F P = each_el_weight;
+
+    // Its force is also expressed in basis (at the middle)
+    F Pt = P * base_mid.tn.t[1];
+    F Pn = P * base_mid.tn.n[1];
+
+    C_SolutionCorrT<F> corr0{};
+    corr0.u = u;
+    corr0.w = w;
+    corr0.M = M;
+    corr0.T = T;
+    corr0.N = N;
+    corr0.Q = Q;
+    corr0.Pt = Pt;
+    corr0.Pn = Pn;
+
+    return corr0;
+}
+
+template<typename F>
+F C_calc_K(const C_UniformParamsT<F>& up, const F& M) {
+    // Moment induces curvature
+    F K = M / up.EI;
+    return K;
+}
+
+template<typename F>
+C_BasisT<F> C_rotate_basis(const C_BasisT<F>& tn0, const F& phi) {
+    F rot_mat_s[2][2];
+    rot_mat_s[0][0] = cos(phi); rot_mat_s[0][1] = sin(phi);
+    rot_mat_s[1][0] = -sin(phi); rot_mat_s[1][1] = cos(phi);
+
+    C_BasisT<F> tn_s{};
+    tn_s.t[0] = rot_mat_s[0][0] * tn0.t[0] + rot_mat_s[0][1] * tn0.n[0];
+    tn_s.t[1] = rot_mat_s[0][0] * tn0.t[1] + rot_mat_s[0][1] * tn0.n[1];
+    tn_s.n[0] = rot_mat_s[1][0] * tn0.t[0] + rot_mat_s[1][1] * tn0.n[0];
+    tn_s.n[1] = rot_mat_s[1][0] * tn0.t[1] + rot_mat_s[1][1] * tn0.n[1];
+
+    return tn_s;
+}
+
+template<typename F>
+C_SolutionBaseT<F> C_EQLINK_link_base(const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const F& s) {
+    // Moment is constant
+    F M = base0.M;
+    F K = C_calc_K(up, M);
+
+    // This moment induces curvature
+    F phi = s * K;
+
+    // Coordinates are shifted
+    F shift_mat_s[2];
+    shift_mat_s[0] = 1.0 / K * sin(phi);
+    shift_mat_s[1] = 1.0 / K * (1.0 - cos(phi));
+
+    F du = shift_mat_s[0] * full0.tn.t[0] + shift_mat_s[1] * full0.tn.n[0];
+    F dw = shift_mat_s[0] * full0.tn.t[1] + shift_mat_s[1] * full0.tn.n[1];
+    F u_s = base0.u + du;
+    F w_s = base0.w + dw;
+
+    // Basis is rotated
+    F T = base0.T;
+    F T_s = T + phi;
+    C_BasisT<F> tn_s = C_rotate_basis(full0.tn, phi);
+
+    C_SolutionBaseT<F> base_s{};
+    base_s.u = u_s;
+    base_s.w = w_s;
+    base_s.M = M;
+    base_s.T = T_s;
+    base_s.tn = tn_s;
+
+    return base_s;
+}
+
+template<typename F>
+C_SolutionCorrT<F> C_EQLINK_link_corr(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s) {
+    if (up.corr_selector == 0)
+        return C_EQLINK_link_corr_linear(up, full0, base0, corr0, s);
+    else
+        return C_EQLINK_link_corr_exponential(up, full0, base0, corr0, s);
+}
+
+// Same as C_EQLINK_link_corr, but the correction is chosen at compile time
+// (traversals pick the instantiation once instead of branching for every element)
+template<int corr_selector, typename F>
+C_SolutionCorrT<F> C_EQLINK_link_corr_of(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s) {
+    if constexpr (corr_selector == 0)
+        return C_EQLINK_link_corr_linear(up, full0, base0, corr0, s);
+    else
+        return C_EQLINK_link_corr_exponential(up, full0, base0, corr0, s);
+}
+
+template<typename F, typename Coeffs>
+C_SolutionCorrT<F> C_EQLINK_link_corr_linear(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s,
+                                             const Coeffs& coeffs) {
+    using S = C_scalar_t<F>;
+
+    F K = C_calc_K(up, base0.M);
+    F R = 1.0 / K;
+    F phi = s * K;
+    F sin_phi = sin(phi), cos_phi = cos(phi);
+
+    F u0 = corr0.u, w0 = corr0.w;
+    F T0 = corr0.T;
+    F M0 = corr0.M;
+    F N0 = corr0.N, Q0 = corr0.Q;
+    F Pt = corr0.Pt, Pn = corr0.Pn;
+    auto f = coeffs.f;
+    F EJ = up.EI;
+
+    const S fact[7] = { 1, 1, 2, 6, 24, 120, 720 };
+    F pow_phi[6];
+    pow_phi[0] = 1.0;
+    for (int k = 1; k < 6; ++k) pow_phi[k] = pow_phi[k - 1] * phi;
+    F pow_s[5];
+    pow_s[0] = 1.0;
+    for (int k = 1; k < 5; ++k) pow_s[k] = pow_s[k - 1] * s;
+
+    F u_s = 0.0;
+    u_s += u0 * cos_phi;
+    u_s += w0 * sin_phi;
+    u_s += T0 * s * (phi / 2.0 - pow_phi[3] / fact[4] + pow_phi[5] / fact[6]);
+    u_s += Q0 * (pow_s[3] / EJ * (phi / fact[4] - 2.0 * pow_phi[3] / fact[6]) - f * s * (phi / 2.0 - pow_phi[3] / 2.0 / fact[3] + pow_phi[5] / 2.0 / fact[5]));
+    u_s += N0 * (-pow_s[3] / EJ * (pow_phi[2] / fact[5]) - f * s * (1.0 - 2.0 * pow_phi[2] / 3.0 + 3.0 * pow_phi[4] / fact[5]));
+    u_s += M0 * pow_s[2] / EJ * (phi / fact[3] - pow_phi[3] / fact[5]);
+    u_s += Pn * (pow_s[4] / EJ * (phi / fact[5]) + f * pow_s[2] * (-phi / fact[3] + 2.0 * pow_phi[3] / fact[5]));
+    u_s += Pt * (-pow_s[4] / EJ * (pow_phi[2] / fact[6]) - f * pow_s[2] * (1.0 / 2.0 - pow_phi[2] / 2.0 / fact[3] + pow_phi[4] / 2.0 / fact[5]));
+
+    F w_s = 0.0;
+    w_s += u0 * -sin_phi;
+    w_s += w0 * cos_phi;
+    w_s += T0 * R * sin_phi;
+    w_s += Q0 * (pow_s[3] / EJ * (1.0 / fact[3] - 2.0 * pow_phi[2] / fact[5]) + f * s * (pow_phi[2] / fact[3] - 2.0 * pow_phi[4] / fact[5]));
+    w_s += N0 * (-pow_s[3] / EJ * (phi / fact[4] - 2.0 * pow_phi[3] / fact[6]) + f * s * (phi / 2.0 - pow_phi[3] / 2.0 / fact[3] + pow_phi[5] / 2.0 / fact[5]));
+    w_s += M0 * pow_s[2] / EJ * (1.0 / 2.0 - pow_phi[2] / fact[4] + pow_phi[4] / fact[6]);
+    w_s += Pn * (pow_s[4] / EJ * (1.0 / fact[4] - 2.0 * pow_phi[2] / fact[6]) + f * pow_s[2] * (pow_phi[2] / fact[4] - 2.0 * pow_phi[4] / fact[6]));
+    w_s += Pt * (pow_s[4] / EJ * (-phi / fact[5]) + f * pow_s[2] * (phi / fact[3] - 2.0 * pow_phi[3] / fact[5]));
+
+    F T_s = 0.0;
+    T_s += T0;
+    T_s += Q0 * pow_s[2] / EJ * (1.0 / 2.0 - pow_phi[2] / fact[4] + pow_phi[4] / fact[6]);
+    T_s += N0 * (-pow_s[2] / EJ * (phi / fact[3] - pow_phi[3] / fact[5]));
+    T_s += M0 * s / EJ;
+    T_s += Pn * pow_s[3] / EJ * (1.0 / fact[3] - pow_phi[2] / fact[5]);
+    T_s += Pt * pow_s[3] / EJ * (-phi / fact[4] + pow_phi[3] / fact[6]);
+
+    F Q_s = 0.0;
+    Q_s += Q0 * cos_phi;
+    Q_s += N0 * -sin_phi;
+    Q_s += Pn * R * sin_phi;
+    Q_s += Pt * s * (-phi / 2.0 + pow_phi[3] / fact[4] - pow_phi[5] / fact[6]);
+
+    F N_s = 0.0;
+    N_s += Q0 * sin_phi;
+    N_s += N0 * cos_phi;
+    N_s += Pn * s * (phi / 2.0 - pow_phi[3] / fact[4] + pow_phi[5] / fact[6]);
+    N_s += Pt * R * sin_phi;
+
+    F M_s = 0.0;
+    M_s += Q0 * R * sin_phi;
+    M_s += N0 * s * (-phi / 2.0 + pow_phi[3] / fact[4] - pow_phi[5] / fact[6]) * N0;
+    M_s += M0;
+    M_s += Pn * pow_s[2] * (1.0 / 2.0 - pow_phi[2] / fact[4] + pow_phi[4] / fact[6]);
+    M_s += Pt * pow_s[2] * (-phi / fact[3] + pow_phi[3] / fact[5]);
+
+    C_SolutionCorrT<F> corr_s{};
+    corr_s.u = u_s;
+    corr_s.w = w_s;
+    corr_s.M = M_s;
+    corr_s.T = T_s;
+    corr_s.N = N_s;
+    corr_s.Q = Q_s;
+    corr_s.Pt = Pt;
+    corr_s.Pn = Pn;
+
+    return corr_s;
+}
+
+template<typename F, typename Coeffs>
+C_SolutionCorrT<F> C_EQLINK_link_corr_exponential(const C_UniformParamsT<F>& up, [[maybe_unused]] const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0, const C_SolutionCorrT<F>& corr0, const F& s,
+                                                  const Coeffs& coeffs) {
+    using S = C_scalar_t<F>;
+
+    F K = C_calc_K(up, base0.M);
+    F R = 1.0 / K;
+    F phi = s * K;
+    F sin_phi = sin(phi), cos_phi = cos(phi);
+
+    F u0 = corr0.u, w0 = corr0.w;
+    F T0 = corr0.T;
+    F M0 = corr0.M;
+    F N0 = corr0.N, Q0 = corr0.Q;
+    F Pt = corr0.Pt, Pn = corr0.Pn;
+    auto f = coeffs.f;
+    S mu = coeffs.mu;
+    F sh_mu_phi = sinh(mu*phi), ch_mu_phi = cosh(mu*phi);
+    S mu_sp1 = mu * mu + 1;
+    F EJ = up.EI;
+
+    F pow_phi[6];
+    pow_phi[0] = 1.0;
+    for (int k = 1; k < 6; ++k) pow_phi[k] = pow_phi[k - 1] * phi;
+    F pow_R[4];
+    pow_R[0] = 1.0;
+    for (int k = 1; k < 4; ++k) pow_R[k] = pow_R[k - 1] * R;
+    S pow_mu[5];
+    pow_mu[0] = 1.0;
+    for (int k = 1; k < 5; ++k) pow_mu[k] = pow_mu[k - 1] * mu;
+
+    F u_s = 0.0;
+    u_s += u0 * cos_phi;
+    u_s += w0 * sin_phi;
+    u_s += T0 * R * (1 - cos_phi);
+    u_s += Q0 * (pow_R[3]/(EJ*pow_mu[2])*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi))-f*R*((ch_mu_phi-cos_phi)/mu_sp1));
+    u_s += N0 * -(pow_R[3]/(EJ*pow_mu[3])*((sh_mu_phi-mu*sin_phi)/mu_sp1-mu*(phi-sin_phi))+f*R/pow_mu[2]*((pow_mu[4]+2*pow_mu[2])*sin_phi/mu_sp1-mu*sh_mu_phi/mu_sp1));
+    u_s += M0 * (pow_R[2]/EJ*(sh_mu_phi/pow_mu[3]-phi/pow_mu[2])-f*(1/mu)*(sh_mu_phi-mu*sin_phi));
+    u_s += Pn * R*(pow_R[3]/(EJ*pow_mu[3])*((sh_mu_phi-mu*sin_phi)/mu_sp1-mu*(phi-sin_phi))-f*R/mu*(sh_mu_phi/mu_sp1-mu*sin_phi/mu_sp1));
+    u_s += Pt * R*(pow_R[3]/(EJ*pow_mu[4])*(ch_mu_phi/mu_sp1-cos_phi*pow_mu[4]/mu_sp1-pow_mu[2]*pow_phi[2]/2+pow_mu[2]-1)-f*R/pow_mu[2]*((cos_phi-ch_mu_phi)/mu_sp1+mu_sp1*(1-cos_phi)));
+
+    F w_s = 0.0;
+    w_s += u0 * -sin_phi;
+    w_s += w0 * cos_phi;
+    w_s += T0 * R * sin_phi;
+    w_s += Q0 * (pow_R[3]/(EJ*pow_mu[2])*(mu*sh_mu_phi/mu_sp1-sin_phi*pow_mu[2]/mu_sp1)+f*R/mu*((sh_mu_phi-mu*sin_phi)/mu_sp1));
+    w_s += N0 * (pow_R[3]/(EJ*pow_mu[2])*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi))-f*R/pow_mu[2]*((1-cos_phi)*mu_sp1-(ch_mu_phi-cos_phi)/mu_sp1));
+    w_s += M0 * (pow_R[2]/EJ*(ch_mu_phi-1)/pow_mu[2]+f*mu_sp1/pow_mu[2]*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi)));
+    w_s += Pn * R*(pow_R[3]/(EJ*pow_mu[2])*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi))+f*R/pow_mu[2]*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi)));
+    w_s += Pt * R*(pow_R[3]/(EJ*pow_mu[4])*(mu*sh_mu_phi/mu_sp1+pow_mu[4]*sin_phi/mu_sp1-pow_mu[2]*phi)-f*R/pow_mu[3]*(mu_sp1*mu*(phi-sin_phi)-(sh_mu_phi-mu*sin_phi)/mu_sp1));
+
+    F T_s = 0.0;
+    T_s += T0;
+    T_s += Q0 * pow_R[2]/(EJ*pow_mu[2])*(ch_mu_phi-1);
+    T_s += N0 * -pow_R[2]/(EJ*pow_mu[3])*(sh_mu_phi-mu*phi);
+    T_s += M0 * R/EJ*(phi+mu_sp1/pow_mu[3]*(sh_mu_phi-mu*phi));
+    T_s += Pn * pow_R[3]/(EJ*pow_mu[3])*(sh_mu_phi-mu*phi);
+    T_s += Pt * -pow_R[3]/(EJ*pow_mu[4])*(ch_mu_phi-pow_mu[2]*pow_phi[2]/2-1);
+
+    F Q_s = 0.0;
+    Q_s += Q0 * ch_mu_phi;
+    Q_s += N0 * -1/mu*sh_mu_phi;
+    Q_s += M0 * mu_sp1/(R*mu)*sh_mu_phi;
+    Q_s += Pn * R * sh_mu_phi/mu;
+    Q_s += Pt * R/pow_mu[2]*(-ch_mu_phi+1);
+
+    F N_s = 0.0;
+    N_s += Q0 * sh_mu_phi/mu;
+    N_s += N0 * (1-(ch_mu_phi-1)/pow_mu[2]);
+    N_s += M0 * mu_sp1/(pow_mu[2]*R)*(ch_mu_phi-1);
+    N_s += Pn * R*(ch_mu_phi-1)/pow_mu[2];
+    N_s += Pt * -R*(sh_mu_phi/pow_mu[3]-mu_sp1/pow_mu[2]*phi);
+
+    F M_s = 0.0;
+    M_s += Q0 * R/mu*sh_mu_phi;
+    M_s += N0 * R/pow_mu[2]*(-ch_mu_phi+1);
+    M_s += M0 * (ch_mu_phi+1/pow_mu[2]*(ch_mu_phi-1));
+    M_s += Pn * R*R/pow_mu[2]*(ch_mu_phi-1);
+    M_s += Pt * R*(-R/pow_mu[3]*sh_mu_phi+R*phi/pow_mu[2]);
+
+    C_SolutionCorrT<F> corr_s{};
+    corr_s.u = u_s;
+    corr_s.w = w_s;
+    corr_s.M = M_s;
+    corr_s.T = T_s;
+    corr_s.N = N_s;
+    corr_s.Q = Q_s;
+    corr_s.Pt = Pt;
+    corr_s.Pn = Pn;
+
+    return corr_s;
+}
+
+template<typename F>
+C_SolutionFullT<F> C_EQLINK_link_full([[maybe_unused]] const C_UniformParamsT<F>& up, const C_SolutionFullT<F>& full0, const C_SolutionBaseT<F>& base0,
+                                     const C_SolutionBaseT<F>& base_s, const C_SolutionCorrT<F>& corr_s, [[maybe_unused]] const F& s) {
+    F diff_u = corr_s.u * base_s.tn.t[0] + corr_s.w * base_s.tn.n[0];
+    F diff_w = corr_s.u * base_s.tn.t[1] + corr_s.w * base_s.tn.n[1];
+    F diff_M = corr_s.M;
+    F diff_T = corr_s.T;
+
+    F x_s = base_s.u + diff_u;
+    F y_s = base_s.w + diff_w;
+    F M_s = base_s.M + diff_M;
+    F T_s = base_s.T + diff_T;
+
+    F diff_T_bc = T_s - base0.T;
+    C_BasisT<F> tn_s = C_rotate_basis(full0.tn, diff_T_bc);
+
+    F Fx_s = corr_s.N * base_s.tn.t[0] + corr_s.Q * base_s.tn.n[0];
+    F Fy_s = corr_s.N * base_s.tn.t[1] + corr_s.Q * base_s.tn.n[1];
+
+    C_SolutionFullT<F> full_s{};
+    full_s.x = x_s;
+    full_s.y = y_s;
+    full_s.M = M_s;
+    full_s.T = T_s;
+    full_s.tn = tn_s;
+    full_s.Fx = Fx_s;
+    full_s.Fy = Fy_s;
+
+    return full_s;
+}
+
+template<typename F>
+C_ElementT<F> C_border_element(const C_SolutionFullT<F>& border) {
+    C_SolutionBaseT<F> base_undef{};
+    C_SolutionCorrT<F> corr_undef{};
+    C_ElementT<F> el0 { border, base_undef, corr_undef };
+    return el0;
+}
+
+
+// Same structures over another number type (e.g. to run the formulae in float on double data)
+template<typename To, typename From>
+C_BasisT<To> C_convert(const C_BasisT<From>& a) {
+    C_BasisT<To> r{};
+    r.t[0] = To(a.t[0]); r.t[1] = To(a.t[1]);
+    r.n[0] = To(a.n[0]); r.n[1] = To(a.n[1]);
+    return r;
+}
+
+template<typename To, typename From>
+C_SolutionFullT<To> C_convert(const C_SolutionFullT<From>& a) {
+    return { To(a.x), To(a.y), To(a.M), To(a.T), C_convert<To>(a.tn), To(a.Fx), To(a.Fy) };
+}
+
+template<typename To, typename From>
+C_SolutionBaseT<To> C_convert(const C_SolutionBaseT<From>& a) {
+    return { To(a.u), To(a.w), To(a.M), To(a.T), C_convert<To>(a.tn) };
+}
+
+template<typename To, typename From>
+C_SolutionCorrT<To> C_convert(const C_SolutionCorrT<From>& a) {
+    return { To(a.u), To(a.w), To(a.M), To(a.T), To(a.N), To(a.Q), To(a.Pt), To(a.Pn) };
+}
+
+template<typename To, typename From>
+C_ElementT<To> C_convert(const C_ElementT<From>& a) {
+    return { C_convert<To>(a.full), C_convert<To>(a.base), C_convert<To>(a.corr) };
+}
+
+template<typename To, typename From>
+C_UniformParamsT<To> C_convert(const C_UniformParamsT<From>& a) {
+    return { a.corr_selector, To(a.EI), To(a.initial_angle), To(a.total_weight), To(a.total_length), To(a.gap),
+             a.elements_count };
+}
+
+
+#endif //SHADERBEAMS_EQUATIONS_H
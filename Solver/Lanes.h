@@ -0,0 +1,574 @@
+#ifndef SHADERBEAMS_LANES_H
+#define SHADERBEAMS_LANES_H
+
+#include "Equations.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+
+// Storage of W values, operated on as one
+// GCC & Clang have native vector types (arithmetic, comparisons & ?: compile straight to vector instructions),
+// other compilers get an array with element-wise loops
+#if defined(__GNUC__) || defined(__clang__)
+#define C_LANES_VECTOR_EXTENSIONS 1
+#else
+#define C_LANES_VECTOR_EXTENSIONS 0
+#endif
+
+// Number of values of type T that fit into the widest enabled vector register
+// Without AVX (or vector types), a batch of doubles would be no faster than single problems, so lanes are disabled (width 1)
+#if C_LANES_VECTOR_EXTENSIONS && defined(__AVX512F__)
+#define C_SIMD_BYTES 64
+#elif C_LANES_VECTOR_EXTENSIONS && defined(__AVX__)
+#define C_SIMD_BYTES 32
+#else
+#define C_SIMD_BYTES 8
+#endif
+
+template<typename T>
+constexpr int C_simd_width() {
+    return C_SIMD_BYTES / (int)sizeof(T) > 0 ? C_SIMD_BYTES / (int)sizeof(T) : 1;
+}
+
+
+// Plain array of W values with element-wise operators (storage of lanes without vector types)
+template<typename T, int W>
+struct C_LaneArray {
+    T e[W];
+
+    T& operator[](int i) { return e[i]; }
+    const T& operator[](int i) const { return e[i]; }
+};
+
+// Comparisons give all-ones (true) or zero (false) per lane, like vector instructions do
+#define C_LANE_ARRAY_OPERATOR(op, R, r_value) \
+    template<typename T, int W> \
+    inline C_LaneArray<R, W> operator op(const C_LaneArray<T, W>& a, const C_LaneArray<T, W>& b) { \
+        C_LaneArray<R, W> r; for (int i = 0; i < W; ++i) r[i] = r_value(a[i] op b[i]); return r; \
+    } \
+    template<typename T, int W> \
+    inline C_LaneArray<R, W> operator op(const C_LaneArray<T, W>& a, T b) { \
+        C_LaneArray<R, W> r; for (int i = 0; i < W; ++i) r[i] = r_value(a[i] op b); return r; \
+    } \
+    template<typename T, int W> \
+    inline C_LaneArray<R, W> operator op(T a, const C_LaneArray<T, W>& b) { \
+        C_LaneArray<R, W> r; for (int i = 0; i < W; ++i) r[i] = r_value(a op b[i]); return r; \
+    }
+
+#define C_LANE_ARRAY_VALUE(x) (x)
+#define C_LANE_ARRAY_MASK(x) ((x) ? int64_t(-1) : int64_t(0))
+
+C_LANE_ARRAY_OPERATOR(+, T, C_LANE_ARRAY_VALUE)
+C_LANE_ARRAY_OPERATOR(-, T, C_LANE_ARRAY_VALUE)
+C_LANE_ARRAY_OPERATOR(*, T, C_LANE_ARRAY_VALUE)
+C_LANE_ARRAY_OPERATOR(/, T, C_LANE_ARRAY_VALUE)
+C_LANE_ARRAY_OPERATOR(|, T, C_LANE_ARRAY_VALUE)
+C_LANE_ARRAY_OPERATOR(<, int64_t, C_LANE_ARRAY_MASK)
+C_LANE_ARRAY_OPERATOR(>, int64_t, C_LANE_ARRAY_MASK)
+C_LANE_ARRAY_OPERATOR(==, int64_t, C_LANE_ARRAY_MASK)
+C_LANE_ARRAY_OPERATOR(>=, int64_t, C_LANE_ARRAY_MASK)
+
+#undef C_LANE_ARRAY_OPERATOR
+#undef C_LANE_ARRAY_VALUE
+#undef C_LANE_ARRAY_MASK
+
+template<typename T, int W>
+inline C_LaneArray<T, W> operator-(const C_LaneArray<T, W>& a) {
+    C_LaneArray<T, W> r; for (int i = 0; i < W; ++i) r[i] = -a[i]; return r;
+}
+
+#if C_LANES_VECTOR_EXTENSIONS
+
+// Lane functions are always inlined, so that repeated sin(phi), cos(phi), ... of one formula merge into one computation
+#define C_LANES_INLINE inline __attribute__((always_inline))
+
+template<typename T, int W>
+struct C_LaneVector {
+    typedef T type __attribute__((vector_size(W * sizeof(T))));
+};
+
+#else
+
+#define C_LANES_INLINE inline
+
+template<typename T, int W>
+struct C_LaneVector {
+    using type = C_LaneArray<T, W>;
+};
+
+#endif
+
+
+// W independent values processed in lockstep
+template<typename T, int W>
+struct C_Lanes {
+    using scalar = T;
+    using vector = typename C_LaneVector<T, W>::type;
+    static constexpr int width = W;
+
+    vector v;
+
+    C_Lanes() = default;
+
+    // Broadcast (implicit, so that formulae can freely mix lanes & scalar constants)
+    C_Lanes(T value) {
+        for (int i = 0; i < W; ++i) v[i] = value;
+    }
+
+    T operator[](int i) const { return v[i]; }
+
+    void set(int i, T value) { v[i] = value; }
+
+    C_Lanes& operator+=(const C_Lanes& b) { v = v + b.v; return *this; }
+    C_Lanes& operator-=(const C_Lanes& b) { v = v - b.v; return *this; }
+    C_Lanes& operator*=(const C_Lanes& b) { v = v * b.v; return *this; }
+    C_Lanes& operator/=(const C_Lanes& b) { v = v / b.v; return *this; }
+};
+
+template<typename T, int W>
+struct C_ScalarOf<C_Lanes<T, W>> {
+    using type = T;
+};
+
+// Lanes as wide as the enabled vector registers
+template<typename T>
+using C_LanesOf = C_Lanes<T, C_simd_width<T>()>;
+
+// Scalar operands are taken as non-deduced C_Lanes::scalar, so that any arithmetic type converts to it
+#define C_LANES_BINARY_OPERATOR(op) \
+    template<typename T, int W> \
+    inline C_Lanes<T, W> operator op(const C_Lanes<T, W>& a, const C_Lanes<T, W>& b) { \
+        C_Lanes<T, W> r; r.v = a.v op b.v; return r; \
+    } \
+    template<typename T, int W> \
+    inline C_Lanes<T, W> operator op(const C_Lanes<T, W>& a, typename C_Lanes<T, W>::scalar b) { \
+        C_Lanes<T, W> r; r.v = a.v op b; return r; \
+    } \
+    template<typename T, int W> \
+    inline C_Lanes<T, W> operator op(typename C_Lanes<T, W>::scalar a, const C_Lanes<T, W>& b) { \
+        C_Lanes<T, W> r; r.v = a op b.v; return r; \
+    }
+
+C_LANES_BINARY_OPERATOR(+)
+C_LANES_BINARY_OPERATOR(-)
+C_LANES_BINARY_OPERATOR(*)
+C_LANES_BINARY_OPERATOR(/)
+
+#undef C_LANES_BINARY_OPERATOR
+
+template<typename T, int W>
+inline C_Lanes<T, W> operator-(const C_Lanes<T, W>& a) {
+    C_Lanes<T, W> r; r.v = -a.v; return r;
+}
+
+
+// Building blocks of the lane functions, for plain numbers & lane vectors alike
+
+template<typename V, typename T>
+C_LANES_INLINE V C_lane_broadcast(T value) {
+    V zero{};
+    return zero + value;
+}
+
+inline double C_lane_blend(bool mask, double a, double b) {
+    return mask ? a : b;
+}
+
+#if C_LANES_VECTOR_EXTENSIONS
+template<typename M, typename V>
+inline V C_lane_blend(const M& mask, const V& a, const V& b) {
+    return mask ? a : b;
+}
+#else
+template<typename T, int W>
+inline C_LaneArray<T, W> C_lane_blend(const C_LaneArray<int64_t, W>& mask, const C_LaneArray<T, W>& a, const C_LaneArray<T, W>& b) {
+    C_LaneArray<T, W> r; for (int i = 0; i < W; ++i) r[i] = mask[i] ? a[i] : b[i]; return r;
+}
+#endif
+
+template<typename V>
+C_LANES_INLINE V C_lane_fabs(const V& x) {
+    return C_lane_blend(x < 0.0, -x, x);
+}
+
+// Round-to-nearest by pushing the fraction out of the mantissa (|x| < 2^51), then corrected downwards
+template<typename V>
+C_LANES_INLINE V C_lane_floor(const V& x) {
+    const double ROUND = 6755399441055744.0;
+    V r = (x + ROUND) - ROUND;
+    return r - C_lane_blend(r > x, C_lane_broadcast<V>(1.0), C_lane_broadcast<V>(0.0));
+}
+
+// Same for float lanes (|x| < 2^22)
+template<typename V>
+C_LANES_INLINE V C_lane_floor_float(const V& x) {
+    const float ROUND = 12582912.0f;
+    V r = (x + ROUND) - ROUND;
+    return r - C_lane_blend(r > x, C_lane_broadcast<V>(1.0f), C_lane_broadcast<V>(0.0f));
+}
+
+// 2^n for an integer-valued n in [-1022, 1023], assembled from the exponent bits:
+// adding 2^52 puts (n + 1023) into the low mantissa bits
+inline double C_lane_pow2(double n) {
+    double biased = n + (1023.0 + 4503599627370496.0);
+    uint64_t bits;
+    memcpy(&bits, &biased, sizeof(bits));
+    bits <<= 52;
+    double r;
+    memcpy(&r, &bits, sizeof(r));
+    return r;
+}
+
+#if C_LANES_VECTOR_EXTENSIONS
+template<typename V>
+C_LANES_INLINE V C_lane_pow2(const V& n) {
+    using I = decltype(n < n);
+    V biased = n + (1023.0 + 4503599627370496.0);
+    I bits = (I)biased;
+    bits <<= 52;
+    return (V)bits;
+}
+#else
+template<int W>
+inline C_LaneArray<double, W> C_lane_pow2(const C_LaneArray<double, W>& n) {
+    C_LaneArray<double, W> r; for (int i = 0; i < W; ++i) r[i] = C_lane_pow2(n[i]); return r;
+}
+#endif
+
+
+// Branch-free versions of the functions (Cephes algorithms, accurate to a couple ulp)
+// Vector math libraries aren't available everywhere, and std:: ones can't be vectorized otherwise
+
+template<typename V>
+C_LANES_INLINE void C_lane_sincos(const V& x, V& s, V& c) {
+    // Reduction by PI/4 with an extra-precise 3-part constant
+    const double FOPI = 1.27323954473516268615;
+    const double DP1 = 7.85398125648498535156E-1, DP2 = 3.77489470793079817668E-8, DP3 = 2.69515142907905952645E-15;
+
+    V sign_x = C_lane_blend(x < 0.0, C_lane_broadcast<V>(-1.0), C_lane_broadcast<V>(1.0));
+    V ax = C_lane_fabs(x);
+
+    // Octant, made even (so that z lies within [-PI/4, PI/4])
+    V y = C_lane_floor(ax * FOPI);
+    y = y + (y - 2.0 * C_lane_floor(y * 0.5));
+    V j = y - 8.0 * C_lane_floor(y * 0.125);
+
+    V z = ((ax - y * DP1) - y * DP2) - y * DP3;
+    V zz = z * z;
+
+    V ps = C_lane_broadcast<V>(1.58962301576546568060E-10);
+    ps = ps * zz - 2.50507477628578072866E-8;
+    ps = ps * zz + 2.75573136213857245213E-6;
+    ps = ps * zz - 1.98412698295895385996E-4;
+    ps = ps * zz + 8.33333333332211858878E-3;
+    ps = ps * zz - 1.66666666666666307295E-1;
+    ps = z + z * zz * ps;
+
+    V pc = C_lane_broadcast<V>(-1.13585365213876817300E-11);
+    pc = pc * zz + 2.08757008419747316778E-9;
+    pc = pc * zz - 2.75573141792967388112E-7;
+    pc = pc * zz + 2.48015872888517045348E-5;
+    pc = pc * zz - 1.38888888888730564116E-3;
+    pc = pc * zz + 4.16666666666665929218E-2;
+    pc = 1.0 - 0.5 * zz + zz * zz * pc;
+
+    // Octants 0, 2, 4, 6: (sin, cos) = (ps, pc), (pc, -ps), (-ps, -pc), (-pc, ps)
+    auto swap = (j == 2.0) | (j == 6.0);
+    V sign_s = C_lane_blend(j >= 4.0, C_lane_broadcast<V>(-1.0), C_lane_broadcast<V>(1.0));
+    V sign_c = C_lane_blend((j == 2.0) | (j == 4.0), C_lane_broadcast<V>(-1.0), C_lane_broadcast<V>(1.0));
+    s = C_lane_blend(swap, pc, ps) * sign_s * sign_x;
+    c = C_lane_blend(swap, ps, pc) * sign_c;
+}
+
+// Single precision version (Cephes sinf & cosf): same octants, shorter polynomials
+template<typename V>
+C_LANES_INLINE void C_lane_sincos_float(const V& x, V& s, V& c) {
+    const float FOPI = 1.27323954473516f;
+    const float DP1 = 0.78515625f, DP2 = 2.4187564849853515625e-4f, DP3 = 3.77489497744594108e-8f;
+
+    V sign_x = C_lane_blend(x < 0.0f, C_lane_broadcast<V>(-1.0f), C_lane_broadcast<V>(1.0f));
+    V ax = C_lane_fabs(x);
+
+    V y = C_lane_floor_float(ax * FOPI);
+    y = y + (y - 2.0f * C_lane_floor_float(y * 0.5f));
+    V j = y - 8.0f * C_lane_floor_float(y * 0.125f);
+
+    V z = ((ax - y * DP1) - y * DP2) - y * DP3;
+    V zz = z * z;
+
+    V ps = C_lane_broadcast<V>(-1.9515295891E-4f);
+    ps = ps * zz + 8.3321608736E-3f;
+    ps = ps * zz - 1.6666654611E-1f;
+    ps = z + z * zz * ps;
+
+    V pc = C_lane_broadcast<V>(2.443315711809948E-5f);
+    pc = pc * zz - 1.388731625493765E-3f;
+    pc = pc * zz + 4.166664568298827E-2f;
+    pc = 1.0f - 0.5f * zz + zz * zz * pc;
+
+    auto swap = (j == 2.0f) | (j == 6.0f);
+    V sign_s = C_lane_blend(j >= 4.0f, C_lane_broadcast<V>(-1.0f), C_lane_broadcast<V>(1.0f));
+    V sign_c = C_lane_blend((j == 2.0f) | (j == 4.0f), C_lane_broadcast<V>(-1.0f), C_lane_broadcast<V>(1.0f));
+    s = C_lane_blend(swap, pc, ps) * sign_s * sign_x;
+    c = C_lane_blend(swap, ps, pc) * sign_c;
+}
+
+template<typename V>
+C_LANES_INLINE V C_lane_exp(const V& x_in) {
+    const double LOG2E = 1.4426950408889634073599;
+    const double C1 = 6.93145751953125E-1, C2 = 1.42860682030941723212E-6;
+
+    V x = C_lane_blend(x_in < -708.0, C_lane_broadcast<V>(-708.0), x_in);
+    x = C_lane_blend(x > 708.0, C_lane_broadcast<V>(708.0), x);
+
+    // x = n * ln(2) + r, |r| <= ln(2) / 2
+    V n = C_lane_floor(LOG2E * x + 0.5);
+    x = x - n * C1;
+    x = x - n * C2;
+
+    // Pade approximation of exp(r)
+    V xx = x * x;
+    V p = ((1.26177193074810590878E-4 * xx + 3.02994407707441961300E-2) * xx + 9.99999999999999999910E-1) * x;
+    V q = ((3.00198505138664455042E-6 * xx + 2.52448340349684104192E-3) * xx + 2.27265548208155028766E-1) * xx + 2.00000000000000000009E0;
+    V e = 1.0 + 2.0 * p / (q - p);
+
+    return e * C_lane_pow2(n);
+}
+
+template<typename V>
+C_LANES_INLINE void C_lane_sinhcosh(const V& x, V& sh, V& ch) {
+    V ax = C_lane_fabs(x);
+    V e = C_lane_exp(ax);
+    V inv_e = 1.0 / e;
+
+    // Near zero, (e - 1/e) & (e + 1/e) - 2 cancel, so Taylor series are used instead
+    // The formulae subtract phi & 1 back from these, so the small terms have to be accurate
+    // Coefficients are 1 / k!
+    V xx = x * x;
+    V sh_series = C_lane_broadcast<V>(8.22063524662433e-18);
+    sh_series = sh_series * xx + 2.8114572543455206e-15;
+    sh_series = sh_series * xx + 7.647163731819816e-13;
+    sh_series = sh_series * xx + 1.6059043836821613e-10;
+    sh_series = sh_series * xx + 2.505210838544172e-08;
+    sh_series = sh_series * xx + 2.7557319223985893e-06;
+    sh_series = sh_series * xx + 1.984126984126984e-04;
+    sh_series = sh_series * xx + 8.333333333333333e-03;
+    sh_series = sh_series * xx + 1.6666666666666666e-01;
+    sh_series = x + x * xx * sh_series;
+
+    V ch_series = C_lane_broadcast<V>(1.5619206968586225e-16);
+    ch_series = ch_series * xx + 4.779477332387385e-14;
+    ch_series = ch_series * xx + 1.1470745597729725e-11;
+    ch_series = ch_series * xx + 2.08767569878681e-09;
+    ch_series = ch_series * xx + 2.755731922398589e-07;
+    ch_series = ch_series * xx + 2.48015873015873e-05;
+    ch_series = ch_series * xx + 1.388888888888889e-03;
+    ch_series = ch_series * xx + 4.1666666666666664e-02;
+    ch_series = ch_series * xx + 0.5;
+    ch_series = 1.0 + xx * ch_series;
+
+    V sh_exp = 0.5 * (e - inv_e);
+    sh = C_lane_blend(ax < 1.0, sh_series, C_lane_blend(x < 0.0, -sh_exp, sh_exp));
+    ch = C_lane_blend(ax < 1.0, ch_series, 0.5 * (e + inv_e));
+}
+
+// Lane functions are double-only (the polynomials & bit tricks above are for double),
+// except for sin & cos, which float formulae need (these only run the linear correction, see C_SolverT::set_precision())
+template<int W>
+C_LANES_INLINE C_Lanes<double, W> sin(const C_Lanes<double, W>& a) {
+    C_Lanes<double, W> s, c;
+    C_lane_sincos(a.v, s.v, c.v);
+    return s;
+}
+
+template<int W>
+C_LANES_INLINE C_Lanes<double, W> cos(const C_Lanes<double, W>& a) {
+    C_Lanes<double, W> s, c;
+    C_lane_sincos(a.v, s.v, c.v);
+    return c;
+}
+
+template<int W>
+C_LANES_INLINE C_Lanes<float, W> sin(const C_Lanes<float, W>& a) {
+    C_Lanes<float, W> s, c;
+    C_lane_sincos_float(a.v, s.v, c.v);
+    return s;
+}
+
+template<int W>
+C_LANES_INLINE C_Lanes<float, W> cos(const C_Lanes<float, W>& a) {
+    C_Lanes<float, W> s, c;
+    C_lane_sincos_float(a.v, s.v, c.v);
+    return c;
+}
+
+template<int W>
+C_LANES_INLINE C_Lanes<double, W> sinh(const C_Lanes<double, W>& a) {
+    C_Lanes<double, W> sh, ch;
+    C_lane_sinhcosh(a.v, sh.v, ch.v);
+    return sh;
+}
+
+template<int W>
+C_LANES_INLINE C_Lanes<double, W> cosh(const C_Lanes<double, W>& a) {
+    C_Lanes<double, W> sh, ch;
+    C_lane_sinhcosh(a.v, sh.v, ch.v);
+    return ch;
+}
+
+
+// Flushes denormals to zero while alive
+// Float formulae of short elements produce lots of them (in negligible terms, but these are very slow to compute with)
+struct C_DenormalsFlush {
+#if defined(__SSE__)
+    unsigned int saved_csr = _mm_getcsr();
+
+    C_DenormalsFlush() { _mm_setcsr(saved_csr | 0x8040); } // FTZ | DAZ
+
+    ~C_DenormalsFlush() { _mm_setcsr(saved_csr); }
+#endif
+};
+
+// Lane i of a lane structure as a plain one & back
+template<typename T, int W>
+inline T C_lane_get(const C_Lanes<T, W>& a, int i) {
+    return a[i];
+}
+
+template<typename T, int W>
+inline void C_lane_set(C_Lanes<T, W>& a, int i, T value) {
+    a.set(i, value);
+}
+
+template<typename T, int W>
+C_BasisT<T> C_lane_get(const C_BasisT<C_Lanes<T, W>>& a, int i) {
+    C_BasisT<T> r{};
+    for (int k = 0; k < 2; ++k) {
+        r.t[k] = a.t[k][i];
+        r.n[k] = a.n[k][i];
+    }
+    return r;
+}
+
+template<typename T, int W>
+C_SolutionFullT<T> C_lane_get(const C_SolutionFullT<C_Lanes<T, W>>& a, int i) {
+    C_SolutionFullT<T> r{};
+    r.x = a.x[i]; r.y = a.y[i];
+    r.M = a.M[i];
+    r.T = a.T[i];
+    r.tn = C_lane_get(a.tn, i);
+    r.Fx = a.Fx[i]; r.Fy = a.Fy[i];
+    return r;
+}
+
+template<typename T, int W>
+C_SolutionBaseT<T> C_lane_get(const C_SolutionBaseT<C_Lanes<T, W>>& a, int i) {
+    C_SolutionBaseT<T> r{};
+    r.u = a.u[i]; r.w = a.w[i];
+    r.M = a.M[i];
+    r.T = a.T[i];
+    r.tn = C_lane_get(a.tn, i);
+    return r;
+}
+
+template<typename T, int W>
+C_SolutionCorrT<T> C_lane_get(const C_SolutionCorrT<C_Lanes<T, W>>& a, int i) {
+    C_SolutionCorrT<T> r{};
+    r.u = a.u[i]; r.w = a.w[i];
+    r.M = a.M[i];
+    r.T = a.T[i];
+    r.N = a.N[i]; r.Q = a.Q[i];
+    r.Pt = a.Pt[i]; r.Pn = a.Pn[i];
+    return r;
+}
+
+template<typename T, int W>
+C_ElementT<T> C_lane_get(const C_ElementT<C_Lanes<T, W>>& a, int i) {
+    C_ElementT<T> r { C_lane_get(a.full, i), C_lane_get(a.base, i), C_lane_get(a.corr, i) };
+    return r;
+}
+
+// First count lanes of a structure made only of F fields, as count plain structures
+// Fields of both are laid out in the same order, so this is a transposition (much cheaper than picking fields one by one)
+template<template<typename> class S, typename T, int W>
+void C_lane_scatter(const S<C_Lanes<T, W>>& a, S<T>* out, int count) {
+    static_assert(sizeof(S<C_Lanes<T, W>>) == sizeof(S<T>) * W, "Structure must consist of F fields only");
+    constexpr int fields = (int)(sizeof(S<T>) / sizeof(T));
+
+    T in[fields * W];
+    memcpy(in, &a, sizeof(in));
+    for (int i = 0; i < count; ++i) {
+        T plain[fields];
+        for (int field = 0; field < fields; ++field) {
+            plain[field] = in[field * W + i];
+        }
+        memcpy(&out[i], plain, sizeof(plain));
+    }
+}
+
+template<typename T, int W>
+void C_lane_set(C_BasisT<C_Lanes<T, W>>& a, int i, const C_BasisT<T>& value) {
+    for (int k = 0; k < 2; ++k) {
+        a.t[k].set(i, value.t[k]);
+        a.n[k].set(i, value.n[k]);
+    }
+}
+
+template<typename T, int W>
+void C_lane_set(C_SolutionFullT<C_Lanes<T, W>>& a, int i, const C_SolutionFullT<T>& value) {
+    a.x.set(i, value.x); a.y.set(i, value.y);
+    a.M.set(i, value.M);
+    a.T.set(i, value.T);
+    C_lane_set(a.tn, i, value.tn);
+    a.Fx.set(i, value.Fx); a.Fy.set(i, value.Fy);
+}
+
+template<typename T, int W>
+void C_lane_set(C_SolutionBaseT<C_Lanes<T, W>>& a, int i, const C_SolutionBaseT<T>& value) {
+    a.u.set(i, value.u); a.w.set(i, value.w);
+    a.M.set(i, value.M);
+    a.T.set(i, value.T);
+    C_lane_set(a.tn, i, value.tn);
+}
+
+template<typename T, int W>
+void C_lane_set(C_SolutionCorrT<C_Lanes<T, W>>& a, int i, const C_SolutionCorrT<T>& value) {
+    a.u.set(i, value.u); a.w.set(i, value.w);
+    a.M.set(i, value.M);
+    a.T.set(i, value.T);
+    a.N.set(i, value.N); a.Q.set(i, value.Q);
+    a.Pt.set(i, value.Pt); a.Pn.set(i, value.Pn);
+}
+
+template<typename T, int W>
+void C_lane_set(C_ElementT<C_Lanes<T, W>>& a, int i, const C_ElementT<T>& value) {
+    C_lane_set(a.full, i, value.full);
+    C_lane_set(a.base, i, value.base);
+    C_lane_set(a.corr, i, value.corr);
+}
+
+template<typename T, int W>
+void C_lane_set(C_UniformParamsT<C_Lanes<T, W>>& a, int i, const C_UniformParamsT<T>& value) {
+    a.EI.set(i, value.EI);
+    a.initial_angle.set(i, value.initial_angle);
+    a.total_weight.set(i, value.total_weight);
+    a.total_length.set(i, value.total_length);
+    a.gap.set(i, value.gap);
+}
+
+// Same structure in every lane
+template<template<typename> class S, typename T, int W>
+void C_lane_broadcast_to(S<C_Lanes<T, W>>& a, const S<T>& value) {
+    for (int i = 0; i < W; ++i) {
+        C_lane_set(a, i, value);
+    }
+}
+
+
+#endif //SHADERBEAMS_LANES_H
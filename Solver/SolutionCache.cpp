@@ -0,0 +1,351 @@
+#include "SolutionCache.h"
+#include "SolutionFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+
+// FNV-1a
+const uint64_t HASH_OFFSET = 14695981039346656037ull;
+const uint64_t HASH_PRIME = 1099511628211ull;
+
+static void hash_bytes(uint64_t& hash, const void* bytes, size_t size) {
+    auto data = (const unsigned char*)bytes;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * HASH_PRIME;
+    }
+}
+
+static void hash_float(uint64_t& hash, C_float value) {
+    // Both zeros are the same value
+    if (value == 0.0) {
+        value = 0.0;
+    }
+    hash_bytes(hash, &value, sizeof(value));
+}
+
+static void hash_int(uint64_t& hash, int64_t value) {
+    hash_bytes(hash, &value, sizeof(value));
+}
+
+static uint64_t profiles_hash(const C_Solver& solver) {
+    if (!solver.has_EI_profile() && !solver.has_weight_profile()) {
+        return 0;
+    }
+
+    uint64_t hash = HASH_OFFSET;
+    size_t elements_count = (size_t)solver.up.elements_count;
+    for (int profile = 0; profile < 2; ++profile) {
+        bool has_profile = profile == 0 ? solver.has_EI_profile() : solver.has_weight_profile();
+        hash_int(hash, has_profile);
+        for (size_t element_i = 0; has_profile && element_i < elements_count; ++element_i) {
+            hash_float(hash, profile == 0 ? solver.element_EI(element_i) : solver.element_weight(element_i));
+        }
+    }
+    return hash;
+}
+
+uint64_t C_SolutionKey::hash() const {
+    uint64_t hash = HASH_OFFSET;
+    hash_int(hash, up.corr_selector);
+    hash_float(hash, up.EI);
+    hash_float(hash, up.initial_angle);
+    hash_float(hash, up.total_weight);
+    hash_float(hash, up.total_length);
+    hash_float(hash, up.gap);
+    hash_int(hash, up.elements_count);
+    hash_int(hash, precision);
+    hash_int(hash, fitted);
+    hash_float(hash, fit_threshold);
+    hash_int(hash, fit_max_iterations);
+    hash_int(hash, (int64_t)profiles_hash);
+    return hash;
+}
+
+bool C_SolutionKey::operator==(const C_SolutionKey& other) const {
+    return up.corr_selector == other.up.corr_selector && up.EI == other.up.EI && up.initial_angle == other.up.initial_angle &&
+           up.total_weight == other.up.total_weight && up.total_length == other.up.total_length && up.gap == other.up.gap &&
+           up.elements_count == other.up.elements_count && precision == other.precision && fitted == other.fitted &&
+           fit_threshold == other.fit_threshold && fit_max_iterations == other.fit_max_iterations &&
+           profiles_hash == other.profiles_hash;
+}
+
+static void copy_solution(const C_Solver& solver, const C_FitResult& fit, C_CachedSolution& solution) {
+    solution.up = solver.up;
+    solution.fit = fit;
+    size_t elements_count = (size_t)solver.up.elements_count;
+    solution.elements.assign(solver.elements, solver.elements + elements_count + 1);
+    if (solver.has_EI_profile()) {
+        solution.EI_profile.resize(elements_count);
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            solution.EI_profile[element_i] = solver.element_EI(element_i);
+        }
+    }
+    if (solver.has_weight_profile()) {
+        solution.weight_profile.resize(elements_count);
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            solution.weight_profile[element_i] = solver.element_weight(element_i);
+        }
+    }
+}
+
+size_t C_CachedSolution::memory_bytes() const {
+    return sizeof(C_CachedSolution) + elements.size() * sizeof(C_Element) +
+           (EI_profile.size() + weight_profile.size()) * sizeof(C_float) + fit.residual_history.size() * sizeof(C_float);
+}
+
+
+C_SolutionKey C_SolutionCache::key_of(const C_Solver& solver, bool fit, const C_FitParams& fp) {
+    C_SolutionKey key;
+    key.up = solver.up;
+    key.precision = solver.precision();
+    key.fitted = fit;
+    if (fit) {
+        key.up.initial_angle = 0.0;
+        key.fit_threshold = fp.threshold;
+        key.fit_max_iterations = fp.max_iterations;
+    }
+    key.profiles_hash = profiles_hash(solver);
+    return key;
+}
+
+bool C_SolutionCache::load(const C_SolutionKey& key, C_Solver& solver, C_FitResult& fit) {
+    std::shared_ptr<const C_CachedSolution> solution = find(key);
+    if (solution == nullptr) {
+        return false;
+    }
+
+    solver.set_precision(key.precision);
+    solver.setup(solution->up);
+    solver.set_EI_profile(solution->EI_profile.data(), solution->EI_profile.size());
+    solver.set_weight_profile(solution->weight_profile.data(), solution->weight_profile.size());
+    std::copy(solution->elements.begin(), solution->elements.end(), solver.elements);
+    solver.mark_solved();
+
+    fit = solution->fit;
+    return true;
+}
+
+std::shared_ptr<const C_CachedSolution> C_SolutionCache::find(const C_SolutionKey& key) {
+    std::string dir;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = index.find(key.hash());
+        if (found != index.end() && found->second->first == key) {
+            // Most recently used goes to the front
+            entries.splice(entries.begin(), entries, found->second);
+            ++_hits;
+            return found->second->second;
+        }
+        dir = disk_dir;
+    }
+
+    std::shared_ptr<const C_CachedSolution> solution;
+    if (!dir.empty()) {
+        std::lock_guard<std::mutex> disk_lock(disk_mutex);
+        solution = internal_read_disk(dir, key);
+    }
+    if (solution == nullptr) {
+        ++_misses;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++_hits;
+    internal_insert(key, solution);
+    return solution;
+}
+
+void C_SolutionCache::store(const C_SolutionKey& key, const C_Solver& solver, const C_FitResult& fit) {
+    if (!fit.converged || fit.cancelled) {
+        return;
+    }
+
+    auto solution = std::make_shared<C_CachedSolution>();
+    copy_solution(solver, fit, *solution);
+
+    std::string dir;
+    size_t budget;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        internal_insert(key, std::move(solution));
+        dir = disk_dir;
+        budget = disk_budget;
+    }
+
+    if (!dir.empty()) {
+        std::lock_guard<std::mutex> disk_lock(disk_mutex);
+        internal_write_disk(dir, budget, key, solver, fit);
+    }
+}
+
+void C_SolutionCache::internal_insert(const C_SolutionKey& key, std::shared_ptr<const C_CachedSolution> solution) {
+    // Replaces a solution of the same key (or the rare other key of the same hash)
+    uint64_t hash = key.hash();
+    auto found = index.find(hash);
+    if (found != index.end()) {
+        _memory_bytes -= found->second->second->memory_bytes();
+        entries.erase(found->second);
+        index.erase(found);
+    }
+
+    // Solutions larger than the whole budget aren't kept in memory
+    size_t bytes = solution->memory_bytes();
+    if (bytes > memory_budget) {
+        return;
+    }
+    entries.emplace_front(key, std::move(solution));
+    index[hash] = entries.begin();
+    _memory_bytes += bytes;
+    internal_evict();
+}
+
+void C_SolutionCache::internal_evict() {
+    while (_memory_bytes > memory_budget && !entries.empty()) {
+        const Entry& entry = entries.back();
+        _memory_bytes -= entry.second->memory_bytes();
+        index.erase(entry.first.hash());
+        entries.pop_back();
+    }
+}
+
+std::string C_SolutionCache::internal_disk_path(const std::string& dir, const C_SolutionKey& key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bsol", (unsigned long long)key.hash());
+    return (fs::path(dir) / name).string();
+}
+
+std::shared_ptr<const C_CachedSolution> C_SolutionCache::internal_read_disk(const std::string& dir, const C_SolutionKey& key) {
+    std::string path = internal_disk_path(dir, key);
+    C_SolutionFile file;
+    if (!file.open(path.c_str())) {
+        return nullptr;
+    }
+
+    // Files are checked against the key, in case another key has the same hash
+    const C_SolutionFileHeader& h = file.header();
+    C_Solver solver;
+    file.attach(&solver);
+    C_FitParams fp;
+    fp.threshold = h.fit_threshold;
+    fp.max_iterations = h.fit_max_iterations;
+    // (not fitted solutions are at the very angle of their key, the fitted ones' key has none)
+    if (!h.solved || !(key_of(solver, key.fitted, fp) == key)) {
+        return nullptr;
+    }
+
+    C_FitResult fit;
+    fit.converged = true;
+    fit.iterations = h.fit_iterations;
+    fit.residual = h.fit_residual;
+    auto solution = std::make_shared<C_CachedSolution>();
+    copy_solution(solver, fit, *solution);
+    // The solver used the mapping in place
+    solver.forget();
+
+    // Recently used files are the last to be evicted
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    return solution;
+}
+
+void C_SolutionCache::internal_write_disk(const std::string& dir, size_t budget, const C_SolutionKey& key, const C_Solver& solver,
+                                          const C_FitResult& fit) {
+    // Written aside & renamed, so that readers never see a partial file
+    std::string path = internal_disk_path(dir, key);
+    std::string temporary_path = path + ".tmp";
+    C_FitParams fp;
+    fp.threshold = key.fit_threshold;
+    fp.max_iterations = key.fit_max_iterations;
+    std::error_code error;
+    if (!C_save_solution_file(temporary_path.c_str(), solver, fp, &fit)) {
+        fs::remove(temporary_path, error);
+        return;
+    }
+    fs::rename(temporary_path, path, error);
+    if (error) {
+        fs::remove(temporary_path, error);
+        return;
+    }
+    internal_evict_disk(dir, budget);
+}
+
+void C_SolutionCache::internal_evict_disk(const std::string& dir, size_t budget) {
+    struct File {
+        fs::path path;
+        fs::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<File> files;
+    uintmax_t total_size = 0;
+
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir, error)) {
+        if (entry.path().extension() != ".bsol") {
+            continue;
+        }
+        File file {entry.path(), entry.last_write_time(error), entry.file_size(error)};
+        if (!error) {
+            total_size += file.size;
+            files.push_back(std::move(file));
+        }
+    }
+    if (total_size <= budget) {
+        return;
+    }
+
+    // Least recently used ones first
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.time < b.time; });
+    for (const File& file : files) {
+        if (total_size <= budget) {
+            break;
+        }
+        if (fs::remove(file.path, error)) {
+            total_size -= file.size;
+        }
+    }
+}
+
+void C_SolutionCache::set_memory_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    memory_budget = bytes;
+    internal_evict();
+}
+
+void C_SolutionCache::set_disk_tier(const std::string& dir, size_t budget_bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        disk_dir = dir;
+        disk_budget = budget_bytes;
+    }
+    if (!dir.empty()) {
+        std::lock_guard<std::mutex> disk_lock(disk_mutex);
+        std::error_code error;
+        fs::create_directories(dir, error);
+        internal_evict_disk(dir, budget_bytes);
+    }
+}
+
+void C_SolutionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    _memory_bytes = 0;
+}
+
+size_t C_SolutionCache::memory_bytes() const {
+    return _memory_bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t C_SolutionCache::hits() const {
+    return _hits.load(std::memory_order_relaxed);
+}
+
+uint64_t C_SolutionCache::misses() const {
+    return _misses.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,112 @@
+#ifndef SHADERBEAMS_SOLUTIONCACHE_H
+#define SHADERBEAMS_SOLUTIONCACHE_H
+
+#include "Solver.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Everything a cached solution depends on
+struct C_SolutionKey {
+    // Its initial_angle is 0 for fitted solutions, as the fit finds the same root from wherever it starts
+    C_UniformParams up {};
+    int precision = C_PRECISION_DOUBLE;
+    bool fitted = false;
+    C_float fit_threshold = 0.0;
+    int fit_max_iterations = 0;
+    // Of the per-element profiles (0 without any), which are only told apart by it
+    uint64_t profiles_hash = 0;
+
+    // Of the canonical values (-0.0 is taken as 0.0), also used to name the disk tier's files
+    [[nodiscard]] uint64_t hash() const;
+
+    bool operator==(const C_SolutionKey& other) const;
+};
+
+struct C_CachedSolution {
+    // With the fitted angle
+    C_UniformParams up {};
+    C_FitResult fit;
+    std::vector<C_Element> elements;
+    std::vector<C_float> EI_profile, weight_profile;
+
+    [[nodiscard]] size_t memory_bytes() const;
+};
+
+// Converged solutions by their problems, least recently used ones evicted beyond a memory budget
+// The optional disk tier keeps every stored solution as a .bsol file (see SolutionFile.h) named by its key's hash,
+// within its own budget; solutions found there are moved back to memory
+// Safe to use from several threads; files are read & written outside the lock of the memory tier,
+// so that the statistics & memory hits never wait for them
+class C_SolutionCache {
+public:
+    // Key of the problem the solver is set up with (taken before solving, as the fit changes the angle)
+    static C_SolutionKey key_of(const C_Solver& solver, bool fit, const C_FitParams& fp);
+
+    // Sets the solver up with the solution cached under key, its elements taken as solved (so nothing is traversed),
+    // & returns the solution's fit; false on a miss (the solver is left as it was)
+    bool load(const C_SolutionKey& key, C_Solver& solver, C_FitResult& fit);
+
+    // Solution cached under key (nullptr on a miss), which stays valid while it's held even if it's evicted
+    std::shared_ptr<const C_CachedSolution> find(const C_SolutionKey& key);
+
+    // Keeps the solver's solution of the problem under key (unless its fit didn't converge)
+    void store(const C_SolutionKey& key, const C_Solver& solver, const C_FitResult& fit);
+
+    void set_memory_budget(size_t bytes);
+
+    // Directory of the disk tier (created if needed, empty disables it) & its budget
+    void set_disk_tier(const std::string& dir, size_t budget_bytes);
+
+    // Drops the solutions in memory (the disk tier's are kept)
+    void clear();
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    [[nodiscard]] uint64_t hits() const;
+
+    [[nodiscard]] uint64_t misses() const;
+
+private:
+    using Entry = std::pair<C_SolutionKey, std::shared_ptr<const C_CachedSolution>>;
+
+    // Following ones are called with the mutex held
+    void internal_insert(const C_SolutionKey& key, std::shared_ptr<const C_CachedSolution> solution);
+
+    void internal_evict();
+
+    // Following ones are called with disk_mutex held (& the disk tier's settings as they were under the mutex)
+    static std::string internal_disk_path(const std::string& dir, const C_SolutionKey& key);
+
+    static std::shared_ptr<const C_CachedSolution> internal_read_disk(const std::string& dir, const C_SolutionKey& key);
+
+    static void internal_write_disk(const std::string& dir, size_t budget, const C_SolutionKey& key, const C_Solver& solver,
+                                    const C_FitResult& fit);
+
+    static void internal_evict_disk(const std::string& dir, size_t budget);
+
+    // Guards the memory tier & the disk tier's settings
+    std::mutex mutex;
+    // Serialises the disk tier's files
+    std::mutex disk_mutex;
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    size_t memory_budget = 256 << 20;
+    std::string disk_dir;
+    size_t disk_budget = 0;
+    // Statistics are read without the lock
+    std::atomic<size_t> _memory_bytes {0};
+    std::atomic<uint64_t> _hits {0}, _misses {0};
+};
+
+
+#endif //SHADERBEAMS_SOLUTIONCACHE_H
@@ -0,0 +1,227 @@
+#include "SolutionFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + C_SOLUTION_FILE_ALIGN - 1) / C_SOLUTION_FILE_ALIGN * C_SOLUTION_FILE_ALIGN;
+}
+
+// Writes size bytes & pads the file up to the next aligned offset
+static bool write_aligned(FILE* file, const void* bytes, size_t size, uint64_t& offset) {
+    if (size > 0 && fwrite(bytes, 1, size, file) != size) {
+        return false;
+    }
+    offset += size;
+
+    static const unsigned char zeros[C_SOLUTION_FILE_ALIGN] {};
+    size_t padding = (size_t)(align_up(offset) - offset);
+    if (padding > 0 && fwrite(zeros, 1, padding, file) != padding) {
+        return false;
+    }
+    offset += padding;
+    return true;
+}
+
+bool C_save_solution_file(const char* path, const C_Solver& solver, const C_FitParams& fp, const C_FitResult* fit) {
+    const C_UniformParams& up = solver.up;
+    size_t elements_count = (size_t)up.elements_count + 1;
+    size_t EI_profile_count = solver.has_EI_profile() ? (size_t)up.elements_count : 0;
+    size_t weight_profile_count = solver.has_weight_profile() ? (size_t)up.elements_count : 0;
+
+    C_SolutionFileHeader header {};
+    memcpy(header.magic, C_SOLUTION_FILE_MAGIC, sizeof(header.magic));
+    header.version = C_SOLUTION_FILE_VERSION;
+    header.byte_order = C_SOLUTION_FILE_BYTE_ORDER;
+    header.float_size = sizeof(C_float);
+    header.element_size = sizeof(C_Element);
+
+    header.corr_selector = up.corr_selector;
+    header.elements_count = up.elements_count;
+    header.EI = up.EI;
+    header.initial_angle = up.initial_angle;
+    header.total_weight = up.total_weight;
+    header.total_length = up.total_length;
+    header.gap = up.gap;
+
+    header.precision = solver.precision();
+    header.fit_max_iterations = fp.max_iterations;
+    header.fit_threshold = fp.threshold;
+    header.solved = fit != nullptr;
+    header.fit_iterations = fit != nullptr ? fit->iterations : 0;
+    header.fit_residual = fit != nullptr ? fit->residual : 0.0;
+
+    header.elements_offset = align_up(sizeof(header));
+    header.EI_profile_offset = align_up(header.elements_offset + elements_count * sizeof(C_Element));
+    header.EI_profile_count = EI_profile_count;
+    header.weight_profile_offset = align_up(header.EI_profile_offset + EI_profile_count * sizeof(C_float));
+    header.weight_profile_count = weight_profile_count;
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    // Elements are written straight from the solver, profiles in chunks
+    uint64_t offset = 0;
+    bool ok = write_aligned(file, &header, sizeof(header), offset);
+    ok = ok && write_aligned(file, solver.elements, elements_count * sizeof(C_Element), offset);
+
+    const size_t chunk_size = 4096;
+    C_float chunk[chunk_size];
+    for (int profile = 0; profile < 2 && ok; ++profile) {
+        size_t count = profile == 0 ? EI_profile_count : weight_profile_count;
+        for (size_t begin = 0; begin < count && ok; begin += chunk_size) {
+            size_t end = begin + chunk_size < count ? begin + chunk_size : count;
+            for (size_t element_i = begin; element_i < end; ++element_i) {
+                chunk[element_i - begin] = profile == 0 ? solver.element_EI(element_i) : solver.element_weight(element_i);
+            }
+            ok = fwrite(chunk, sizeof(C_float), end - begin, file) == end - begin;
+            offset += (end - begin) * sizeof(C_float);
+        }
+        ok = ok && write_aligned(file, nullptr, 0, offset);
+    }
+
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+
+bool C_SolutionFile::open(const char* path) {
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_handle = file;
+    mapping_handle = mapping;
+    data = (unsigned char*)view;
+    size = (size_t)file_size.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    data = (unsigned char*)view;
+    size = (size_t)st.st_size;
+#endif
+
+    // Header & layout are checked before anything is used in place
+    const C_SolutionFileHeader& h = header();
+    bool valid = size >= sizeof(C_SolutionFileHeader) &&
+                 memcmp(h.magic, C_SOLUTION_FILE_MAGIC, sizeof(h.magic)) == 0 &&
+                 h.version == C_SOLUTION_FILE_VERSION &&
+                 h.byte_order == C_SOLUTION_FILE_BYTE_ORDER &&
+                 h.float_size == sizeof(C_float) && h.element_size == sizeof(C_Element) &&
+                 h.elements_count > 0;
+
+    auto array_fits = [&](uint64_t offset, uint64_t count, uint64_t item_size) {
+        return offset % C_SOLUTION_FILE_ALIGN == 0 && offset <= size && count <= (size - offset) / item_size;
+    };
+    valid = valid && array_fits(h.elements_offset, (uint64_t)h.elements_count + 1, sizeof(C_Element));
+    valid = valid && (h.EI_profile_count == 0 || h.EI_profile_count == (uint64_t)h.elements_count);
+    valid = valid && array_fits(h.EI_profile_offset, h.EI_profile_count, sizeof(C_float));
+    valid = valid && (h.weight_profile_count == 0 || h.weight_profile_count == (uint64_t)h.elements_count);
+    valid = valid && array_fits(h.weight_profile_offset, h.weight_profile_count, sizeof(C_float));
+
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void C_SolutionFile::close() {
+    if (data == nullptr) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mapping_handle);
+    CloseHandle((HANDLE)file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    munmap(data, size);
+#endif
+
+    data = nullptr;
+    size = 0;
+}
+
+C_UniformParams C_SolutionFile::params() const {
+    const C_SolutionFileHeader& h = header();
+
+    C_UniformParams up {};
+    up.corr_selector = h.corr_selector;
+    up.EI = h.EI;
+    up.initial_angle = h.initial_angle;
+    up.total_weight = h.total_weight;
+    up.total_length = h.total_length;
+    up.gap = h.gap;
+    up.elements_count = h.elements_count;
+    return up;
+}
+
+C_FitParams C_SolutionFile::fit_params() const {
+    C_FitParams fp;
+    fp.threshold = header().fit_threshold;
+    fp.max_iterations = header().fit_max_iterations;
+    return fp;
+}
+
+void C_SolutionFile::attach(C_Solver* solver) {
+    const C_SolutionFileHeader& h = header();
+
+    solver->set_precision(h.precision);
+    solver->setup(params(), (C_Element*)(data + h.elements_offset));
+
+    solver->set_EI_profile((const C_float*)(data + h.EI_profile_offset), h.EI_profile_count);
+    solver->set_weight_profile((const C_float*)(data + h.weight_profile_offset), h.weight_profile_count);
+
+    if (h.solved) {
+        solver->mark_solved();
+    }
+}
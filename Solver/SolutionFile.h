@@ -0,0 +1,91 @@
+#ifndef SHADERBEAMS_SOLUTIONFILE_H
+#define SHADERBEAMS_SOLUTIONFILE_H
+
+#include "Solver.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Binary solution file: a fixed header followed by raw arrays, laid out so that a mapped file is used in place
+// Files are only readable by builds with the same C_float & byte order (both are recorded in the header)
+#define C_SOLUTION_FILE_MAGIC "BEAMSOL"
+const uint32_t C_SOLUTION_FILE_VERSION = 1;
+const uint32_t C_SOLUTION_FILE_BYTE_ORDER = 0x01020304;
+
+// Arrays start at multiples of it (from the file's start, which is mapped at a page boundary)
+const uint64_t C_SOLUTION_FILE_ALIGN = 64;
+
+struct C_SolutionFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t float_size;
+    uint32_t element_size;
+
+    // Problem
+    int32_t corr_selector;
+    int32_t elements_count;
+    C_float EI, initial_angle, total_weight, total_length, gap;
+
+    // Solver parameters
+    int32_t precision;
+    int32_t fit_max_iterations;
+    C_float fit_threshold;
+    // Whether the elements hold the solution (otherwise they are to be recomputed)
+    int32_t solved;
+    int32_t fit_iterations;
+    C_float fit_residual;
+
+    // Offsets from the file's start
+    // elements_count + 1 elements, then the optional per-element profiles (count is 0 without one)
+    uint64_t elements_offset;
+    uint64_t EI_profile_offset, EI_profile_count;
+    uint64_t weight_profile_offset, weight_profile_count;
+};
+
+// Writes the solver's problem, precision, profiles & elements
+// fit is the solution's fit (nullptr if the elements don't hold a solution)
+bool C_save_solution_file(const char* path, const C_Solver& solver, const C_FitParams& fp, const C_FitResult* fit);
+
+// Read-only view of a mapped solution file
+// The mapping is private (copy-on-write), so solvers may traverse over the elements without changing the file
+class C_SolutionFile {
+public:
+    C_SolutionFile() = default;
+
+    C_SolutionFile(const C_SolutionFile&) = delete;
+    C_SolutionFile& operator=(const C_SolutionFile&) = delete;
+
+    ~C_SolutionFile() { close(); }
+
+    // Maps the file & validates its header & layout
+    bool open(const char* path);
+
+    void close();
+
+    [[nodiscard]] bool is_open() const { return data != nullptr; }
+
+    [[nodiscard]] const C_SolutionFileHeader& header() const { return *(const C_SolutionFileHeader*)data; }
+
+    [[nodiscard]] C_UniformParams params() const;
+
+    [[nodiscard]] C_FitParams fit_params() const;
+
+    // Sets the solver up with the mapped elements in place (nothing is parsed or copied) & its precision & profiles
+    // Elements of a solved file are taken as the solution
+    // The solver uses the mapping until its next setup() or forget(), so the file should be closed after that
+    void attach(C_Solver* solver);
+
+private:
+    unsigned char* data = nullptr;
+    size_t size = 0;
+
+#if defined(_WIN32)
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+
+#endif //SHADERBEAMS_SOLUTIONFILE_H
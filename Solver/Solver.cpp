@@ -1,418 +1,992 @@
 #include "Solver.h"
+#include "Lanes.h"
+#include "ThreadPool.h"
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <type_traits>
+
+
+using C_SampleLanes = C_LanesOf<C_float>;
+
+// Positions are handed out to threads in chunks of this many
+const size_t SAMPLE_CHUNK = 4096;
+
+
+const char* C_traverse_reason_name(int reason) {
+    switch (reason) {
+        case C_TRAVERSE_OK:
+            return "ok";
+        case C_TRAVERSE_NON_FINITE:
+            return "non-finite";
+        case C_TRAVERSE_CURVATURE:
+            return "curvature";
+        case C_TRAVERSE_MOMENT:
+            return "moment";
+        case C_TRAVERSE_FORCE:
+            return "force";
+        case C_TRAVERSE_CANCELLED:
+            return "cancelled";
+        default:
+            return "unknown";
+    }
+}
+
+void C_AngleFitter::reset(C_float new_scale) {
+    scale = new_scale;
+    points = 0;
+    _bracketed = false;
+}
+
+C_float C_AngleFitter::relaxation_step(C_float residual) const {
+    // Deviation of the whole length corresponds to a right angle
+    return -(PI / 2.0) * residual / scale;
+}
+
+C_float C_AngleFitter::clamp_step(C_float step) const {
+    // Secant may extrapolate far away while the residual is strongly nonlinear
+    C_float max_step = PI / 4.0;
+    step = fmax(-max_step, fmin(step, max_step));
+
+    // Beam should leave the left hinge to the right, so the angle is kept within (-PI/2, PI/2)
+    // (near the limits the moment vanishes and the residual becomes singular)
+    C_float limit = PI / 2.0;
+    if (fabs(b + step) >= limit) {
+        step = (copysign(limit, b + step) - b) / 2.0;
+    }
+    return step;
+}
+
+C_float C_AngleFitter::next(C_float angle, C_float residual) {
+    if (!std::isfinite(angle) || !std::isfinite(residual)) {
+        // Traversal has diverged: retreat halfway towards the last sane angle
+        if (points == 0) {
+            return std::isfinite(angle) ? angle / 2.0 : 0.0;
+        }
+        return (b + (std::isfinite(angle) ? angle : b)) / 2.0;
+    }
+
+    if (points == 0) {
+        b = angle; fb = residual;
+        points = 1;
+        return b + clamp_step(relaxation_step(residual));
+    }
+
+    if (!_bracketed) {
+        a = b; fa = fb;
+        b = angle; fb = residual;
+        ++points;
+
+        if ((fa < 0.0) != (fb < 0.0)) {
+            _bracketed = true;
+        }
+        else {
+            // Secant step (falling back to relaxation for a flat or degenerate secant)
+            C_float denominator = fb - fa;
+            C_float step = (denominator != 0.0) ? -fb * (b - a) / denominator : relaxation_step(fb);
+            if (!std::isfinite(step)) {
+                step = relaxation_step(fb);
+            }
+            return b + clamp_step(step);
+        }
+    }
+    else {
+        if ((residual < 0.0) != (fb < 0.0)) {
+            // Root is between the latest two points
+            a = b; fa = fb;
+        }
+        else {
+            // Same side again: halve the retained residual (Illinois) to avoid one-sided convergence
+            fa /= 2.0;
+        }
+        b = angle; fb = residual;
+        ++points;
+    }
+
+    // Regula falsi within the bracket, bisection if it fails to stay strictly inside
+    C_float c = b - fb * (b - a) / (fb - fa);
+    C_float lo = fmin(a, b), hi = fmax(a, b);
+    if (!(c > lo && c < hi)) {
+        c = (a + b) / 2.0;
+    }
+    return c;
+}
+
+C_float C_AngleFitter::next(C_float angle, C_float residual, C_float slope) {
+    // Keeps the bracket up to date & provides the fallback
+    C_float fallback = next(angle, residual);
+
+    C_float step = -residual / slope;
+    if (!std::isfinite(angle) || !std::isfinite(step)) {
+        return fallback;
+    }
+
+    if (!_bracketed) {
+        return b + clamp_step(step);
+    }
+
+    C_float c = b + step;
+    C_float lo = fmin(a, b), hi = fmax(a, b);
+    return (c > lo && c < hi) ? c : fallback;
+}
 
 
-C_SolutionFull C_EQLINK_setup_initial_border(C_UniformParams up) {
-    // Beam's left end is hinged at a known angle
-    C_float x = 0.0, y = 0.0;
-    C_float M = 0.0;
-    C_float T = up.initial_angle;
-    C_Basis tn{};
-    tn.t[0] = cos(T); tn.t[1] = sin(T);
-    tn.n[0] = -sin(T); tn.n[1] = cos(T);
-
-    // Support reaction force is upward
-    C_float each_stand_load = up.total_weight / 2.0;
-    C_float Fx = 0.0;
-    C_float Fy = each_stand_load;
-
-    C_SolutionFull border{};
-    border.x = x;
-    border.y = y;
-    border.M = M;
-    border.T = T;
-    border.tn = tn;
-    border.Fx = Fx;
-    border.Fy = Fy;
-
-    return border;
-}
-
-C_SolutionBase C_EQLINK_setup_base(C_UniformParams up, C_SolutionFull full0) {
-    // Base solution accounts for geometry
-    C_float u = full0.x, w = full0.y;
-    C_float T = full0.T;
-    C_Basis tn = full0.tn;
-
-    // Force induces a moment in the middle of the element
-    // Since we don't know the curvature yet, we treat the element as straight
-    C_float each_el_length = up.total_length / C_float(up.elements_count);
-    C_float middle_s = each_el_length / 2.0;
-    C_float F_arm_x = full0.tn.t[0] * middle_s, F_arm_y = full0.tn.t[1] * middle_s;
-    // Moment is <0 when beam goes to the right (because F then induces a counter-clockwise rotation)
-    C_float M = F_arm_x * full0.Fy - F_arm_y * full0.Fx;
-
-    C_SolutionBase base0{};
-    base0.u = u;
-    base0.w = w;
-    base0.M = M;
-    base0.T = T;
-    base0.tn = tn;
-
-    return base0;
-}
-
-C_SolutionCorr C_EQLINK_setup_corr(C_UniformParams up, C_SolutionFull full0, C_SolutionBase base0) {
-    // No offset or rotation at the beginning
-    C_float u = 0.0, w = 0.0;
-    C_float T = 0.0;
-
-    // Since full moment is zero (for hinge), the moment induced by F in base solution
-    // should be compensated in correction solution
-    C_float M = -base0.M;
-
-    // Upward force is expressed in basis (at the middle)
-    C_float each_el_length = up.total_length / C_float(up.elements_count);
-    C_SolutionBase base_mid = C_EQLINK_link_base(up, full0, base0, each_el_length / 2.0);
-    C_float N = full0.Fy * base_mid.tn.t[1];
-    C_float Q = full0.Fy * base_mid.tn.n[1];
-
-    // Each element has weight
-    C_float each_el_weight = up.total_weight / C_float(up.elements_count);
-    C_float P = each_el_weight;
-
-    // Its force is also expressed in basis (at the middle)
-    C_float Pt = P * base_mid.tn.t[1];
-    C_float Pn = P * base_mid.tn.n[1];
-
-    C_SolutionCorr corr0{};
-    corr0.u = u;
-    corr0.w = w;
-    corr0.M = M;
-    corr0.T = T;
-    corr0.N = N;
-    corr0.Q = Q;
-    corr0.Pt = Pt;
-    corr0.Pn = Pn;
-
-    return corr0;
-}
-
-C_float C_calc_K(C_UniformParams up, C_float M) {
-    // Moment induces curvature
-    C_float K = M / up.EI;
-    return K;
-}
-
-C_Basis C_rotate_basis(C_Basis tn0, C_float phi) {
-    C_float rot_mat_s[2][2];
-    rot_mat_s[0][0] = cos(phi); rot_mat_s[0][1] = sin(phi);
-    rot_mat_s[1][0] = -sin(phi); rot_mat_s[1][1] = cos(phi);
-
-    C_Basis tn_s{};
-    tn_s.t[0] = rot_mat_s[0][0] * tn0.t[0] + rot_mat_s[0][1] * tn0.n[0];
-    tn_s.t[1] = rot_mat_s[0][0] * tn0.t[1] + rot_mat_s[0][1] * tn0.n[1];
-    tn_s.n[0] = rot_mat_s[1][0] * tn0.t[0] + rot_mat_s[1][1] * tn0.n[0];
-    tn_s.n[1] = rot_mat_s[1][0] * tn0.t[1] + rot_mat_s[1][1] * tn0.n[1];
-
-    return tn_s;
-}
-
-C_SolutionBase C_EQLINK_link_base(C_UniformParams up, C_SolutionFull full0, C_SolutionBase base0, C_float s) {
-    // Moment is constant
-    C_float M = base0.M;
-    C_float K = C_calc_K(up, M);
-
-    // This moment induces curvature
-    C_float phi = s * K;
-
-    // Coordinates are shifted
-    C_float shift_mat_s[2];
-    shift_mat_s[0] = 1.0 / K * sin(phi);
-    shift_mat_s[1] = 1.0 / K * (1.0 - cos(phi));
-
-    C_float du = shift_mat_s[0] * full0.tn.t[0] + shift_mat_s[1] * full0.tn.n[0];
-    C_float dw = shift_mat_s[0] * full0.tn.t[1] + shift_mat_s[1] * full0.tn.n[1];
-    C_float u_s = base0.u + du;
-    C_float w_s = base0.w + dw;
-
-    // Basis is rotated
-    C_float T = base0.T;
-    C_float T_s = T + phi;
-    C_Basis tn_s = C_rotate_basis(full0.tn, phi);
-
-    C_SolutionBase base_s{};
-    base_s.u = u_s;
-    base_s.w = w_s;
-    base_s.M = M;
-    base_s.T = T_s;
-    base_s.tn = tn_s;
-
-    return base_s;
-}
-
-C_SolutionCorr C_EQLINK_link_corr(C_UniformParams up, [[maybe_unused]] C_SolutionFull full0, C_SolutionBase base0, C_SolutionCorr corr0, C_float s) {
-    if (up.corr_selector == 0)
-        return C_EQLINK_link_corr_linear(up, full0, base0, corr0, s);
-    else
-        return C_EQLINK_link_corr_exponential(up, full0, base0, corr0, s);
-}
-
-C_SolutionCorr C_EQLINK_link_corr_linear(C_UniformParams up, [[maybe_unused]] C_SolutionFull full0, C_SolutionBase base0, C_SolutionCorr corr0, C_float s) {
-    C_float K = C_calc_K(up, base0.M);
-    C_float R = 1.0 / K;
-    C_float phi = s * K;
-    C_float sin_phi = sin(phi), cos_phi = cos(phi);
-
-    C_float u0 = corr0.u, w0 = corr0.w;
-    C_float T0 = corr0.T;
-    C_float M0 = corr0.M;
-    C_float N0 = corr0.N, Q0 = corr0.Q;
-    C_float Pt = corr0.Pt, Pn = corr0.Pn;
-    C_float f = 0.0;
-    C_float EJ = up.EI;
-
-    C_float fact[7] = { 1, 1, 2, 6, 24, 120, 720 };
-    C_float pow_phi[6] = { 1.0, phi, pow(phi, 2.0), pow(phi, 3.0), pow(phi, 4.0), pow(phi, 5.0) };
-    C_float pow_s[5] = { 1.0, s, pow(s, 2.0), pow(s, 3.0), pow(s, 4.0) };
-
-    C_float u_s = 0.0;
-    u_s += u0 * cos_phi;
-    u_s += w0 * sin_phi;
-    u_s += T0 * s * (phi / 2.0 - pow_phi[3] / fact[4] + pow_phi[5] / fact[6]);
-    u_s += Q0 * (pow_s[3] / EJ * (phi / fact[4] - 2.0 * pow_phi[3] / fact[6]) - f * s * (phi / 2.0 - pow_phi[3] / 2.0 / fact[3] + pow_phi[5] / 2.0 / fact[5]));
-    u_s += N0 * (-pow_s[3] / EJ * (pow_phi[2] / fact[5]) - f * s * (1.0 - 2.0 * pow_phi[2] / 3.0 + 3.0 * pow_phi[4] / fact[5]));
-    u_s += M0 * pow_s[2] / EJ * (phi / fact[3] - pow_phi[3] / fact[5]);
-    u_s += Pn * (pow_s[4] / EJ * (phi / fact[5]) + f * pow_s[2] * (-phi / fact[3] + 2.0 * pow_phi[3] / fact[5]));
-    u_s += Pt * (-pow_s[4] / EJ * (pow_phi[2] / fact[6]) - f * pow_s[2] * (1.0 / 2.0 - pow_phi[2] / 2.0 / fact[3] + pow_phi[4] / 2.0 / fact[5]));
-
-    C_float w_s = 0.0;
-    w_s += u0 * -sin_phi;
-    w_s += w0 * cos_phi;
-    w_s += T0 * R * sin_phi;
-    w_s += Q0 * (pow_s[3] / EJ * (1.0 / fact[3] - 2.0 * pow_phi[2] / fact[5]) + f * s * (pow_phi[2] / fact[3] - 2.0 * pow_phi[4] / fact[5]));
-    w_s += N0 * (-pow_s[3] / EJ * (phi / fact[4] - 2.0 * pow_phi[3] / fact[6]) + f * s * (phi / 2.0 - pow_phi[3] / 2.0 / fact[3] + pow_phi[5] / 2.0 / fact[5]));
-    w_s += M0 * pow_s[2] / EJ * (1.0 / 2.0 - pow_phi[2] / fact[4] + pow_phi[4] / fact[6]);
-    w_s += Pn * (pow_s[4] / EJ * (1.0 / fact[4] - 2.0 * pow_phi[2] / fact[6]) + f * pow_s[2] * (pow_phi[2] / fact[4] - 2.0 * pow_phi[4] / fact[6]));
-    w_s += Pt * (pow_s[4] / EJ * (-phi / fact[5]) + f * pow_s[2] * (phi / fact[3] - 2.0 * pow_phi[3] / fact[5]));
-
-    C_float T_s = 0.0;
-    T_s += T0;
-    T_s += Q0 * pow_s[2] / EJ * (1.0 / 2.0 - pow_phi[2] / fact[4] + pow_phi[4] / fact[6]);
-    T_s += N0 * (-pow_s[2] / EJ * (phi / fact[3] - pow_phi[3] / fact[5]));
-    T_s += M0 * s / EJ;
-    T_s += Pn * pow_s[3] / EJ * (1.0 / fact[3] - pow_phi[2] / fact[5]);
-    T_s += Pt * pow_s[3] / EJ * (-phi / fact[4] + pow_phi[3] / fact[6]);
-
-    C_float Q_s = 0.0;
-    Q_s += Q0 * cos_phi;
-    Q_s += N0 * -sin_phi;
-    Q_s += Pn * R * sin_phi;
-    Q_s += Pt * s * (-phi / 2.0 + pow_phi[3] / fact[4] - pow_phi[5] / fact[6]);
-
-    C_float N_s = 0.0;
-    N_s += Q0 * sin_phi;
-    N_s += N0 * cos_phi;
-    N_s += Pn * s * (phi / 2.0 - pow_phi[3] / fact[4] + pow_phi[5] / fact[6]);
-    N_s += Pt * R * sin_phi;
-
-    C_float M_s = 0.0;
-    M_s += Q0 * R * sin_phi;
-    M_s += N0 * s * (-phi / 2.0 + pow_phi[3] / fact[4] - pow_phi[5] / fact[6]) * N0;
-    M_s += M0;
-    M_s += Pn * pow_s[2] * (1.0 / 2.0 - pow_phi[2] / fact[4] + pow_phi[4] / fact[6]);
-    M_s += Pt * pow_s[2] * (-phi / fact[3] + pow_phi[3] / fact[5]);
-
-    C_SolutionCorr corr_s{};
-    corr_s.u = u_s;
-    corr_s.w = w_s;
-    corr_s.M = M_s;
-    corr_s.T = T_s;
-    corr_s.N = N_s;
-    corr_s.Q = Q_s;
-    corr_s.Pt = Pt;
-    corr_s.Pn = Pn;
-
-    return corr_s;
-}
-
-C_SolutionCorr C_EQLINK_link_corr_exponential(C_UniformParams up, [[maybe_unused]] C_SolutionFull full0, C_SolutionBase base0, C_SolutionCorr corr0, C_float s) {
-    C_float K = C_calc_K(up, base0.M);
-    C_float R = 1.0 / K;
-    C_float phi = s * K;
-    C_float sin_phi = sin(phi), cos_phi = cos(phi);
-
-    C_float u0 = corr0.u, w0 = corr0.w;
-    C_float T0 = corr0.T;
-    C_float M0 = corr0.M;
-    C_float N0 = corr0.N, Q0 = corr0.Q;
-    C_float Pt = corr0.Pt, Pn = corr0.Pn;
-    C_float f = 0.0;
-    C_float mu = 1.0;
-    C_float sh_mu_phi = sinh(mu*phi), ch_mu_phi = cosh(mu*phi);
-    C_float mu_sp1 = pow(mu, 2) + 1;
-    C_float EJ = up.EI;
-
-    C_float pow_phi[6] = { 1.0, phi, pow(phi, 2.0), pow(phi, 3.0), pow(phi, 4.0), pow(phi, 5.0) };
-    C_float pow_R[4] = { 1.0, R, pow(R, 2.0), pow(R, 3.0) };
-    C_float pow_mu[5] = { 1.0, mu, pow(mu, 2.0), pow(mu, 3.0), pow(mu, 4.0) };
-
-    C_float u_s = 0.0;
-    u_s += u0 * cos_phi;
-    u_s += w0 * sin_phi;
-    u_s += T0 * R * (1 - cos_phi);
-    u_s += Q0 * (pow_R[3]/(EJ*pow_mu[2])*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi))-f*R*((ch_mu_phi-cos_phi)/mu_sp1));
-    u_s += N0 * -(pow_R[3]/(EJ*pow_mu[3])*((sh_mu_phi-mu*sin_phi)/mu_sp1-mu*(phi-sin_phi))+f*R/pow_mu[2]*((pow_mu[4]+2*pow_mu[2])*sin_phi/mu_sp1-mu*sh_mu_phi/mu_sp1));
-    u_s += M0 * (pow_R[2]/EJ*(sh_mu_phi/pow_mu[3]-phi/pow_mu[2])-f*(1/mu)*(sh_mu_phi-mu*sin_phi));
-    u_s += Pn * R*(pow_R[3]/(EJ*pow_mu[3])*((sh_mu_phi-mu*sin_phi)/mu_sp1-mu*(phi-sin_phi))-f*R/mu*(sh_mu_phi/mu_sp1-mu*sin_phi/mu_sp1));
-    u_s += Pt * R*(pow_R[3]/(EJ*pow_mu[4])*(ch_mu_phi/mu_sp1-cos_phi*pow_mu[4]/mu_sp1-pow_mu[2]*pow_phi[2]/2+pow_mu[2]-1)-f*R/pow_mu[2]*((cos_phi-ch_mu_phi)/mu_sp1+mu_sp1*(1-cos_phi)));
-
-    C_float w_s = 0.0;
-    w_s += u0 * -sin_phi;
-    w_s += w0 * cos_phi;
-    w_s += T0 * R * sin_phi;
-    w_s += Q0 * (pow_R[3]/(EJ*pow_mu[2])*(mu*sh_mu_phi/mu_sp1-sin_phi*pow_mu[2]/mu_sp1)+f*R/mu*((sh_mu_phi-mu*sin_phi)/mu_sp1));
-    w_s += N0 * (pow_R[3]/(EJ*pow_mu[2])*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi))-f*R/pow_mu[2]*((1-cos_phi)*mu_sp1-(ch_mu_phi-cos_phi)/mu_sp1));
-    w_s += M0 * (pow_R[2]/EJ*(ch_mu_phi-1)/pow_mu[2]+f*mu_sp1/pow_mu[2]*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi)));
-    w_s += Pn * R*(pow_R[3]/(EJ*pow_mu[2])*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi))+f*R/pow_mu[2]*((ch_mu_phi-cos_phi)/mu_sp1-(1-cos_phi)));
-    w_s += Pt * R*(pow_R[3]/(EJ*pow_mu[4])*(mu*sh_mu_phi/mu_sp1+pow_mu[4]*sin_phi/mu_sp1-pow_mu[2]*phi)-f*R/pow_mu[3]*(mu_sp1*mu*(phi-sin_phi)-(sh_mu_phi-mu*sin_phi)/mu_sp1));
-
-    C_float T_s = 0.0;
-    T_s += T0;
-    T_s += Q0 * pow_R[2]/(EJ*pow_mu[2])*(ch_mu_phi-1);
-    T_s += N0 * -pow_R[2]/(EJ*pow_mu[3])*(sh_mu_phi-mu*phi);
-    T_s += M0 * R/EJ*(phi+mu_sp1/pow_mu[3]*(sh_mu_phi-mu*phi));
-    T_s += Pn * pow_R[3]/(EJ*pow_mu[3])*(sh_mu_phi-mu*phi);
-    T_s += Pt * -pow_R[3]/(EJ*pow_mu[4])*(ch_mu_phi-pow_mu[2]*pow_phi[2]/2-1);
-
-    C_float Q_s = 0.0;
-    Q_s += Q0 * ch_mu_phi;
-    Q_s += N0 * -1/mu*sh_mu_phi;
-    Q_s += M0 * mu_sp1/(R*mu)*sh_mu_phi;
-    Q_s += Pn * R * sh_mu_phi/mu;
-    Q_s += Pt * R/pow_mu[2]*(-ch_mu_phi+1);
-
-    C_float N_s = 0.0;
-    N_s += Q0 * sh_mu_phi/mu;
-    N_s += N0 * (1-(ch_mu_phi-1)/pow_mu[2]);
-    N_s += M0 * mu_sp1/(pow_mu[2]*R)*(ch_mu_phi-1);
-    N_s += Pn * R*(ch_mu_phi-1)/pow_mu[2];
-    N_s += Pt * -R*(sh_mu_phi/pow_mu[3]-mu_sp1/pow_mu[2]*phi);
-
-    C_float M_s = 0.0;
-    M_s += Q0 * R/mu*sh_mu_phi;
-    M_s += N0 * R/pow_mu[2]*(-ch_mu_phi+1);
-    M_s += M0 * (ch_mu_phi+1/pow_mu[2]*(ch_mu_phi-1));
-    M_s += Pn * R*R/pow_mu[2]*(ch_mu_phi-1);
-    M_s += Pt * R*(-R/pow_mu[3]*sh_mu_phi+R*phi/pow_mu[2]);
-
-    C_SolutionCorr corr_s{};
-    corr_s.u = u_s;
-    corr_s.w = w_s;
-    corr_s.M = M_s;
-    corr_s.T = T_s;
-    corr_s.N = N_s;
-    corr_s.Q = Q_s;
-    corr_s.Pt = Pt;
-    corr_s.Pn = Pn;
-
-    return corr_s;
-}
-
-C_SolutionFull C_EQLINK_link_full([[maybe_unused]] C_UniformParams up, C_SolutionFull full0, C_SolutionBase base0, C_SolutionBase base_s, C_SolutionCorr corr_s, [[maybe_unused]] C_float s) {
-    C_float diff_u = corr_s.u * base_s.tn.t[0] + corr_s.w * base_s.tn.n[0];
-    C_float diff_w = corr_s.u * base_s.tn.t[1] + corr_s.w * base_s.tn.n[1];
-    C_float diff_M = corr_s.M;
-    C_float diff_T = corr_s.T;
-
-    C_float x_s = base_s.u + diff_u;
-    C_float y_s = base_s.w + diff_w;
-    C_float M_s = base_s.M + diff_M;
-    C_float T_s = base_s.T + diff_T;
-
-    C_float diff_T_bc = T_s - base0.T;
-    C_Basis tn_s = C_rotate_basis(full0.tn, diff_T_bc);
-
-    C_float Fx_s = corr_s.N * base_s.tn.t[0] + corr_s.Q * base_s.tn.n[0];
-    C_float Fy_s = corr_s.N * base_s.tn.t[1] + corr_s.Q * base_s.tn.n[1];
-
-    C_SolutionFull full_s{};
-    full_s.x = x_s;
-    full_s.y = y_s;
-    full_s.M = M_s;
-    full_s.T = T_s;
-    full_s.tn = tn_s;
-    full_s.Fx = Fx_s;
-    full_s.Fy = Fy_s;
-
-    return full_s;
-}
-
-
-C_Element border_element(C_SolutionFull border) {
-    C_SolutionBase base_undef{};
-    C_SolutionCorr corr_undef{};
-    C_Element el0 { border, base_undef, corr_undef };
-    return el0;
-}
-
-
-void C_Solver::setup(C_UniformParams new_up) {
+template<typename F>
+void C_SolverT<F>::setup(const Params& new_up) {
     internal_re_alloc((size_t) new_up.elements_count);
+    internal_setup(new_up);
+}
+
+template<typename F>
+void C_SolverT<F>::setup(const Params& new_up, Element* external_elements) {
+    internal_ensure_free();
+    elements = external_elements;
+    elements_count = (size_t) new_up.elements_count;
+    internal_setup(new_up);
+}
+
+template<typename F>
+void C_SolverT<F>::internal_setup(const Params& new_up) {
     up = new_up;
     _was_setup = true;
+
+    EI_profile.clear();
+    weight_profile.clear();
+    _dirty_begin = 0;
+    _changed_begin = 0;
+
+    internal_pick_kernels();
+}
+
+template<typename F>
+void C_SolverT<F>::set_precision(int new_precision) {
+    _precision = new_precision;
+    if (_was_setup) {
+        internal_pick_kernels();
+        mark_dirty(0);
+    }
+}
+
+template<typename F>
+void C_SolverT<F>::internal_pick_kernels() {
+    if (up.corr_selector == 0) {
+        traverse_kernel = &C_SolverT::internal_traverse<0>;
+        solution_at_kernel = &C_SolverT::internal_solution_at<0>;
+    }
+    else {
+        traverse_kernel = &C_SolverT::internal_traverse<1>;
+        solution_at_kernel = &C_SolverT::internal_solution_at<1>;
+    }
+
+    // Exponential correction stays in double (see set_precision())
+    if constexpr (std::is_same<F, C_float>::value) {
+        if (up.corr_selector == 0 && _precision == C_PRECISION_FLOAT) {
+            traverse_kernel = &C_SolverT::internal_traverse_float<0, false>;
+        }
+        else if (up.corr_selector == 0 && _precision == C_PRECISION_MIXED) {
+            traverse_kernel = &C_SolverT::internal_traverse_float<0, true>;
+        }
+    }
+}
+
+template<typename F>
+static bool same_params(const C_UniformParamsT<F>& a, const C_UniformParamsT<F>& b) {
+    return a.corr_selector == b.corr_selector && a.EI == b.EI && a.initial_angle == b.initial_angle &&
+           a.total_weight == b.total_weight && a.total_length == b.total_length && a.gap == b.gap &&
+           a.elements_count == b.elements_count;
+}
+
+template<typename F>
+C_TraverseStatus C_SolverT<F>::traverse(size_t end) const {
+    // Parameters may have been changed directly (e.g. the angle while fitting)
+    if (!same_params(up, solved_up)) {
+        solved_up = up;
+        _dirty_begin = 0;
+    }
+
+    if (_dirty_begin >= end) {
+        return {};
+    }
+    _changed_begin = std::min(_changed_begin, _dirty_begin);
+
+    if (cancel_flag == nullptr) {
+        C_TraverseStatus status = (this->*traverse_kernel)(_dirty_begin, end);
+        _dirty_begin = status.ok() ? end : status.element_i;
+        return status;
+    }
+
+    // Cancellable traversals resume from the last solved chunk, like incremental ones
+    const size_t cancel_chunk = 4096;
+    while (_dirty_begin < end && !cancelled()) {
+        size_t chunk_end = std::min(_dirty_begin + cancel_chunk, end);
+        C_TraverseStatus status = (this->*traverse_kernel)(_dirty_begin, chunk_end);
+        if (!status.ok()) {
+            _dirty_begin = status.element_i;
+            return status;
+        }
+        _dirty_begin = chunk_end;
+    }
+    if (_dirty_begin < end) {
+        return {C_TRAVERSE_CANCELLED, _dirty_begin, NAN};
+    }
+    return {};
+}
+
+// Parareal update: coarse prediction from the new start, corrected by the last fine & coarse results
+template<typename F>
+static C_SolutionFullT<F> shooting_update(const C_SolutionFullT<F>& coarse_new, const C_SolutionFullT<F>& fine,
+                                          const C_SolutionFullT<F>& coarse_old) {
+    C_SolutionFullT<F> full;
+    full.x = coarse_new.x + (fine.x - coarse_old.x);
+    full.y = coarse_new.y + (fine.y - coarse_old.y);
+    full.M = coarse_new.M + (fine.M - coarse_old.M);
+    full.T = coarse_new.T + (fine.T - coarse_old.T);
+    for (int k = 0; k < 2; ++k) {
+        full.tn.t[k] = coarse_new.tn.t[k] + (fine.tn.t[k] - coarse_old.tn.t[k]);
+        full.tn.n[k] = coarse_new.tn.n[k] + (fine.tn.n[k] - coarse_old.tn.n[k]);
+    }
+    full.Fx = coarse_new.Fx + (fine.Fx - coarse_old.Fx);
+    full.Fy = coarse_new.Fy + (fine.Fy - coarse_old.Fy);
+    return full;
+}
+
+template<typename F>
+static bool same_full(const C_SolutionFullT<F>& a, const C_SolutionFullT<F>& b) {
+    return C_value(a.x) == C_value(b.x) && C_value(a.y) == C_value(b.y) && C_value(a.M) == C_value(b.M) &&
+           C_value(a.T) == C_value(b.T) && C_value(a.Fx) == C_value(b.Fx) && C_value(a.Fy) == C_value(b.Fy);
+}
+
+template<typename F>
+C_ShootingResult C_SolverT<F>::traverse_shooting(const C_ShootingParams& sp, C_ThreadPool* pool) const {
+    C_ShootingResult result;
+    size_t elements_count = (size_t)up.elements_count;
+
+    // Float kernels keep their own serial traversal
+    if (_precision != C_PRECISION_DOUBLE) {
+        result.status = traverse(elements_count);
+        result.iterations = 1;
+        result.converged = result.status.ok() && !cancelled();
+        return result;
+    }
+
+    if (!same_params(up, solved_up)) {
+        solved_up = up;
+        _dirty_begin = 0;
+    }
+    if (_dirty_begin >= elements_count) {
+        result.converged = true;
+        return result;
+    }
+    // Like traverse(), shooting resumes from the lowest dirty element
+    size_t first = _dirty_begin;
+    _changed_begin = std::min(_changed_begin, first);
+
+    if (pool == nullptr) {
+        pool = &C_ThreadPool::shared();
+    }
+    size_t chunks_count = sp.chunks_count > 0 ? sp.chunks_count : pool->size();
+    chunks_count = std::max<size_t>(1, std::min(chunks_count, (elements_count - first) / 2));
+    size_t coarse_factor = std::max<size_t>(1, sp.coarse_factor);
+    int max_iterations = sp.max_iterations > 0 ? sp.max_iterations : (int)chunks_count;
+
+    bool linear = up.corr_selector == 0;
+    auto fine = [&](size_t begin, size_t end, const C_SolutionFullT<F>& start, C_TraverseStatus* status) {
+        return linear ? internal_traverse_chunk<0>(begin, end, start, status)
+                      : internal_traverse_chunk<1>(begin, end, start, status);
+    };
+    auto coarse = [&](size_t begin, size_t end, const C_SolutionFullT<F>& start) {
+        return linear ? internal_coarse_chunk<0>(begin, end, start, coarse_factor)
+                      : internal_coarse_chunk<1>(begin, end, start, coarse_factor);
+    };
+
+    std::vector<size_t> bounds(chunks_count + 1);
+    for (size_t chunk_i = 0; chunk_i <= chunks_count; ++chunk_i) {
+        bounds[chunk_i] = first + (elements_count - first) * chunk_i / chunks_count;
+    }
+
+    // starts[j] - guessed state at the start of chunk j, ends_fine & ends_coarse[j] - its propagated end states
+    std::vector<C_SolutionFullT<F>> starts(chunks_count + 1), ends_fine(chunks_count), ends_coarse(chunks_count);
+    // Of the last fine traversal of each chunk
+    std::vector<C_TraverseStatus> fine_status(chunks_count);
+    starts[0] = first == 0 ? C_EQLINK_setup_initial_border(up, internal_left_reaction()) : elements[first].full;
+    for (size_t chunk_i = 0; chunk_i < chunks_count; ++chunk_i) {
+        ends_coarse[chunk_i] = coarse(bounds[chunk_i], bounds[chunk_i + 1], starts[chunk_i]);
+        starts[chunk_i + 1] = ends_coarse[chunk_i];
+    }
+
+    C_float length = C_value(up.total_length), EI = C_value(up.EI);
+    // Chunks before it were propagated from their exact starts (so their elements are final)
+    size_t exact_chunks = 0;
+
+    while (result.iterations < max_iterations && !cancelled()) {
+        ++result.iterations;
+
+        // Each chunk writes its own elements only (its end state goes to the next chunk's start)
+        pool->parallel_for(exact_chunks, chunks_count, 1, [&](size_t chunk_i, size_t) {
+            fine_status[chunk_i] = C_TraverseStatus();
+            ends_fine[chunk_i] = fine(bounds[chunk_i], bounds[chunk_i + 1], starts[chunk_i], &fine_status[chunk_i]);
+        });
+
+        result.mismatch = 0.0;
+        bool healthy = true;
+        for (size_t chunk_i = exact_chunks; chunk_i < chunks_count; ++chunk_i) {
+            healthy = healthy && fine_status[chunk_i].ok();
+            if (chunk_i + 1 < chunks_count) {
+                result.mismatch = std::max(result.mismatch, C_state_difference(ends_fine[chunk_i], starts[chunk_i + 1], length, EI));
+            }
+        }
+        if (healthy && (result.mismatch <= sp.tolerance || exact_chunks + 1 >= chunks_count)) {
+            result.converged = true;
+            break;
+        }
+
+        // Serial correction sweep; chunks whose starts didn't change pass their fine end states on as they are,
+        // so the exact chain grows by at least a chunk per iteration
+        bool start_changed = false;
+        for (size_t chunk_i = exact_chunks; chunk_i < chunks_count; ++chunk_i) {
+            C_SolutionFullT<F> next_start;
+            if (!start_changed) {
+                // Unhealthy chunk traversed from its exact start: the traversal itself diverges there
+                if (!fine_status[chunk_i].ok()) {
+                    result.status = fine_status[chunk_i];
+                    break;
+                }
+                next_start = ends_fine[chunk_i];
+                exact_chunks = chunk_i + 1;
+            }
+            else {
+                C_SolutionFullT<F> coarse_new = coarse(bounds[chunk_i], bounds[chunk_i + 1], starts[chunk_i]);
+                // (a chunk that failed from its guessed start has no fine correction to offer)
+                next_start = fine_status[chunk_i].ok() ? shooting_update(coarse_new, ends_fine[chunk_i], ends_coarse[chunk_i])
+                                                       : coarse_new;
+                ends_coarse[chunk_i] = coarse_new;
+            }
+            start_changed = !same_full(next_start, starts[chunk_i + 1]);
+            starts[chunk_i + 1] = next_start;
+        }
+        if (!result.status.ok()) {
+            break;
+        }
+    }
+
+    if (result.converged) {
+        elements[elements_count] = C_border_element(ends_fine[chunks_count - 1]);
+        _dirty_begin = elements_count;
+    }
+    else if (!result.status.ok()) {
+        // Elements before the unhealthy one were traversed from exact starts
+        _dirty_begin = result.status.element_i;
+    }
+    else {
+        // Elements past the exact chain don't hold a consistent solution, so they're left dirty
+        _dirty_begin = bounds[exact_chunks];
+        if (cancelled()) {
+            result.status = {C_TRAVERSE_CANCELLED, _dirty_begin, NAN};
+        }
+    }
+    return result;
+}
+
+template<typename F>
+void C_SolverT<F>::mark_dirty(size_t element_i) {
+    _dirty_begin = std::min(_dirty_begin, element_i);
+}
+
+template<typename F>
+size_t C_SolverT<F>::take_changed_begin() {
+    size_t changed_begin = _changed_begin;
+    _changed_begin = (size_t)up.elements_count + 1;
+    return changed_begin;
+}
+
+template<typename F>
+void C_SolverT<F>::mark_solved() {
+    solved_up = up;
+    _dirty_begin = (size_t)up.elements_count;
+}
+
+template<typename F>
+void C_SolverT<F>::set_element_EI(size_t element_i, F EI) {
+    if (EI_profile.empty()) {
+        EI_profile.assign((size_t)up.elements_count, up.EI);
+    }
+    EI_profile[element_i] = EI;
+
+    mark_dirty(element_i);
+}
+
+template<typename F>
+void C_SolverT<F>::set_element_weight(size_t element_i, F weight) {
+    if (weight_profile.empty()) {
+        weight_profile.assign((size_t)up.elements_count, up.total_weight / (C_float)up.elements_count);
+        weight_profile_load = fabs(C_value(up.total_weight));
+    }
+    weight_profile_load += fabs(C_value(weight)) - fabs(C_value(weight_profile[element_i]));
+    weight_profile[element_i] = weight;
+
+    // Support reaction depends on the whole load
+    mark_dirty(0);
+}
+
+template<typename F>
+void C_SolverT<F>::set_EI_profile(const C_float* EI, size_t count) {
+    count = std::min(count, (size_t)up.elements_count);
+    if (count == 0) {
+        return;
+    }
+    if (EI_profile.empty()) {
+        EI_profile.assign((size_t)up.elements_count, up.EI);
+    }
+    std::copy(EI, EI + count, EI_profile.begin());
+
+    mark_dirty(0);
+}
+
+template<typename F>
+void C_SolverT<F>::set_weight_profile(const C_float* weights, size_t count) {
+    count = std::min(count, (size_t)up.elements_count);
+    if (count == 0) {
+        return;
+    }
+    if (weight_profile.empty()) {
+        weight_profile.assign((size_t)up.elements_count, up.total_weight / (C_float)up.elements_count);
+    }
+    std::copy(weights, weights + count, weight_profile.begin());
+    weight_profile_load = 0.0;
+    for (const F& weight : weight_profile) {
+        weight_profile_load += fabs(C_value(weight));
+    }
+
+    // Support reaction depends on the whole load
+    mark_dirty(0);
+}
+
+template<typename F>
+F C_SolverT<F>::element_EI(size_t element_i) const {
+    if (EI_profile.empty()) {
+        return up.EI;
+    }
+    // Right border element has no length, it's evaluated with the last element's stiffness
+    return EI_profile[std::min(element_i, EI_profile.size() - 1)];
+}
+
+template<typename F>
+F C_SolverT<F>::element_weight(size_t element_i) const {
+    if (weight_profile.empty()) {
+        return up.total_weight / (C_float)up.elements_count;
+    }
+    return weight_profile[element_i];
 }
 
-void C_Solver::traverse(size_t begin, size_t end) const {
-    C_float each_length = up.total_length / (C_float)up.elements_count;
+template<typename F>
+typename C_SolverT<F>::Element C_SolverT<F>::get_solution_at(size_t element_i, F s) const {
+    return (this->*solution_at_kernel)(internal_element_params(element_i), element_i, s);
+}
 
+template<typename F>
+template<int corr_selector>
+C_TraverseStatus C_SolverT<F>::internal_traverse(size_t begin, size_t end) const {
     if (begin == 0) {
-        C_SolutionFull border = C_EQLINK_setup_initial_border(up);
-        elements[0] = border_element(border);
+        C_SolutionFullT<F> border = C_EQLINK_setup_initial_border(up, internal_left_reaction());
+        elements[0] = C_border_element(border);
+    }
+
+    C_TraverseStatus status;
+    C_SolutionFullT<F> full_end = internal_traverse_chunk<corr_selector>(begin, end, elements[begin].full, &status);
+    if (status.ok()) {
+        elements[end] = C_border_element(full_end);
+    }
+    return status;
+}
+
+template<typename F>
+template<int corr_selector>
+C_SolutionFullT<F> C_SolverT<F>::internal_traverse_chunk(size_t begin, size_t end, const C_SolutionFullT<F>& start,
+                                                         C_TraverseStatus* status) const {
+    F each_length = up.total_length / (C_float)up.elements_count;
+    HealthBounds bounds;
+    if (status != nullptr) {
+        bounds = internal_health_bounds();
     }
+    elements[begin].full = start;
 
     for (size_t element_i = begin; element_i < end; ++element_i) {
-        C_SolutionFull full0 = elements[element_i].full;
-        C_SolutionBase base0 = C_EQLINK_setup_base(up, full0);
-        C_SolutionCorr corr0 = C_EQLINK_setup_corr(up, full0, base0);
+        Params up_el = internal_element_params(element_i);
+
+        C_SolutionFullT<F> full0 = elements[element_i].full;
+        C_SolutionBaseT<F> base0 = C_EQLINK_setup_base(up_el, full0);
+        C_SolutionCorrT<F> corr0 = C_EQLINK_setup_corr(up_el, full0, base0, element_weight(element_i));
         elements[element_i].base = base0;
         elements[element_i].corr = corr0;
 
-        C_Element el1 = get_solution_at(element_i, each_length);
-        C_SolutionFull full1 = el1.full;
+        Element el1 = internal_solution_at<corr_selector>(up_el, element_i, each_length);
+        C_SolutionFullT<F> full1 = el1.full;
+
+        if (bounds.enabled && !internal_check_health(bounds, element_i, full1, *status)) {
+            return full1;
+        }
+        if (element_i + 1 == end) {
+            return full1;
+        }
+        elements[element_i + 1] = C_border_element(full1);
+    }
+    return start;
+}
+
+template<typename F>
+template<int corr_selector>
+C_SolutionFullT<F> C_SolverT<F>::internal_coarse_chunk(size_t begin, size_t end, const C_SolutionFullT<F>& start,
+                                                       size_t coarse_factor) const {
+    C_SolutionFullT<F> full = start;
+
+    for (size_t element_i = begin; element_i < end; element_i += coarse_factor) {
+        size_t count = std::min(coarse_factor, end - element_i);
+
+        // Fine elements are merged into one with their total weight & mean compliance
+        Params up_c = up;
+        up_c.elements_count = 1;
+        up_c.total_length = up.total_length * ((C_float)count / (C_float)up.elements_count);
+        F weight = 0.0, compliance = 0.0;
+        for (size_t fine_i = element_i; fine_i < element_i + count; ++fine_i) {
+            weight += element_weight(fine_i);
+            compliance += 1.0 / element_EI(fine_i);
+        }
+        up_c.EI = (C_float)count / compliance;
+
+        C_SolutionBaseT<F> base0 = C_EQLINK_setup_base(up_c, full);
+        C_SolutionCorrT<F> corr0 = C_EQLINK_setup_corr(up_c, full, base0, weight);
+        F s = up_c.total_length;
+        C_SolutionBaseT<F> base_s = C_EQLINK_link_base(up_c, full, base0, s);
+        C_SolutionCorrT<F> corr_s = C_EQLINK_link_corr_of<corr_selector>(up_c, full, base0, corr0, s);
+        full = C_EQLINK_link_full(up_c, full, base0, base_s, corr_s, s);
+    }
+    return full;
+}
+
+// Adds value to sum, carrying the rounding error over to the next addition (Kahan)
+template<typename F>
+static void compensated_add(F& sum, F value, F& compensation) {
+    F y = value - compensation;
+    F t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+}
+
+template<typename F>
+template<int corr_selector, bool mixed>
+C_TraverseStatus C_SolverT<F>::internal_traverse_float(size_t begin, size_t end) const {
+    C_DenormalsFlush flush;
+    float each_length = (float)(up.total_length / (C_float)up.elements_count);
+    HealthBounds bounds = internal_health_bounds();
+    C_TraverseStatus status;
+
+    if (begin == 0) {
+        C_SolutionFullT<F> border = C_EQLINK_setup_initial_border(up, internal_left_reaction());
+        elements[0] = C_border_element(border);
+    }
+
+    // Rounding errors of the chained sums (restart with each traversal)
+    F x_error = 0.0, y_error = 0.0, T_error = 0.0;
+
+    for (size_t element_i = begin; element_i < end; ++element_i) {
+        C_UniformParamsT<float> up_el = C_convert<float>(internal_element_params(element_i));
+
+        C_SolutionFullT<F> full0 = elements[element_i].full;
+        C_SolutionFullT<float> full0_f = C_convert<float>(full0);
+        if (mixed) {
+            // Formulae are invariant to the shift & to the angle (the basis carries the orientation),
+            // so float only has to hold the changes along the element
+            full0_f.x = 0.0f;
+            full0_f.y = 0.0f;
+            full0_f.T = 0.0f;
+        }
+
+        C_SolutionBaseT<float> base0_f = C_EQLINK_setup_base(up_el, full0_f);
+        C_SolutionCorrT<float> corr0_f = C_EQLINK_setup_corr(up_el, full0_f, base0_f, (float)element_weight(element_i));
+        C_SolutionBaseT<float> base1_f = C_EQLINK_link_base(up_el, full0_f, base0_f, each_length);
+        C_SolutionCorrT<float> corr1_f = C_EQLINK_link_corr_of<corr_selector>(up_el, full0_f, base0_f, corr0_f, each_length);
+        C_SolutionFullT<float> full1_f = C_EQLINK_link_full(up_el, full0_f, base0_f, base1_f, corr1_f, each_length);
+
+        C_SolutionBaseT<F> base0 = C_convert<F>(base0_f);
+        C_SolutionFullT<F> full1 = C_convert<F>(full1_f);
+        if (mixed) {
+            base0.u = full0.x;
+            base0.w = full0.y;
+            base0.T = full0.T;
+            base0.tn = full0.tn;
+
+            full1.x = full0.x;
+            full1.y = full0.y;
+            full1.T = full0.T;
+            compensated_add(full1.x, (F)full1_f.x, x_error);
+            compensated_add(full1.y, (F)full1_f.y, y_error);
+            compensated_add(full1.T, (F)full1_f.T, T_error);
+            full1.tn = C_rotate_basis(full0.tn, (F)full1_f.T);
+        }
+        elements[element_i].base = base0;
+        elements[element_i].corr = C_convert<F>(corr0_f);
 
-        elements[element_i + 1] = border_element(full1);
+        if (bounds.enabled && !internal_check_health(bounds, element_i, full1, status)) {
+            break;
+        }
+        elements[element_i + 1] = C_border_element(full1);
     }
+    return status;
 }
 
-C_Element C_Solver::get_solution_at(size_t element_i, C_float s) const {
-    C_Element el0 = elements[element_i];
+template<typename F>
+template<int corr_selector>
+typename C_SolverT<F>::Element C_SolverT<F>::internal_solution_at(const Params& up_el, size_t element_i, F s) const {
+    Element el0 = elements[element_i];
 
-    C_SolutionBase base_s = C_EQLINK_link_base(up, el0.full, el0.base, s);
-    C_SolutionCorr corr_s = C_EQLINK_link_corr(up, el0.full, el0.base, el0.corr, s);
-    C_SolutionFull full_s = C_EQLINK_link_full(up, el0.full, el0.base, base_s, corr_s, s);
+    C_SolutionBaseT<F> base_s = C_EQLINK_link_base(up_el, el0.full, el0.base, s);
+    C_SolutionCorrT<F> corr_s = C_EQLINK_link_corr_of<corr_selector>(up_el, el0.full, el0.base, el0.corr, s);
+    C_SolutionFullT<F> full_s = C_EQLINK_link_full(up_el, el0.full, el0.base, base_s, corr_s, s);
 
-    C_Element el_s { full_s, base_s, corr_s };
+    Element el_s { full_s, base_s, corr_s };
 
     return el_s;
 }
 
-void C_Solver::forget() {
+template<typename F>
+typename C_SolverT<F>::Params C_SolverT<F>::internal_element_params(size_t element_i) const {
+    Params up_el = up;
+    up_el.EI = element_EI(element_i);
+    return up_el;
+}
+
+template<typename F>
+F C_SolverT<F>::internal_left_reaction() const {
+    if (weight_profile.empty()) {
+        return up.total_weight / 2.0;
+    }
+
+    // Balance of moments about the right hinge, as if the beam were straight (exact for the uniform load)
+    F reaction = 0.0;
+    C_float count = (C_float)weight_profile.size();
+    for (size_t element_i = 0; element_i < weight_profile.size(); ++element_i) {
+        reaction += weight_profile[element_i] * (1.0 - ((C_float)element_i + 0.5) / count);
+    }
+    return reaction;
+}
+
+template<typename F>
+typename C_SolverT<F>::HealthBounds C_SolverT<F>::internal_health_bounds() const {
+    HealthBounds bounds;
+    bounds.enabled = health.enabled;
+    if (!bounds.enabled) {
+        return bounds;
+    }
+
+    C_float length = C_value(up.total_length), EI = fabs(C_value(up.EI));
+    C_float load = weight_profile.empty() ? fabs(C_value(up.total_weight)) : weight_profile_load;
+    bounds.each_length = length / (C_float)up.elements_count;
+    bounds.max_element_turn = health.max_element_turn;
+    bounds.max_moment = health.max_moment_factor * (load * length + EI / length);
+    bounds.max_force = health.max_force_factor * (load + EI / (length * length));
+    return bounds;
+}
+
+template<typename F>
+bool C_SolverT<F>::internal_check_health(const HealthBounds& bounds, size_t element_i, const C_SolutionFullT<F>& full1,
+                                         C_TraverseStatus& status) const {
+    C_float M = C_value(full1.M), Fx = C_value(full1.Fx), Fy = C_value(full1.Fy);
+    C_float t0 = C_value(full1.tn.t[0]), t1 = C_value(full1.tn.t[1]);
+
+    // Any inf or NaN makes the sum one as well (& a finite state can't overflow it without failing the bounds below)
+    C_float sum = C_value(full1.x) + C_value(full1.y) + C_value(full1.T) + M + Fx + Fy + t0 + t1;
+    if (!std::isfinite(sum)) {
+        status.value = sum;
+        status.reason = C_TRAVERSE_NON_FINITE;
+    }
+    else if (fabs(M) * bounds.each_length > bounds.max_element_turn * fabs(C_value(element_EI(element_i)))) {
+        status.value = fabs(M) * bounds.each_length / fabs(C_value(element_EI(element_i)));
+        status.reason = C_TRAVERSE_CURVATURE;
+    }
+    else if (fabs(M) > bounds.max_moment) {
+        status.value = fabs(M);
+        status.reason = C_TRAVERSE_MOMENT;
+    }
+    else {
+        // Axial & shear forces in the end's basis
+        C_float N = Fx * t0 + Fy * t1, Q = Fy * t0 - Fx * t1;
+        C_float force = std::max(fabs(N), fabs(Q));
+        if (!(force <= bounds.max_force)) {
+            status.value = force;
+            status.reason = C_TRAVERSE_FORCE;
+        }
+    }
+
+    if (status.ok()) {
+        return true;
+    }
+    status.element_i = element_i;
+    return false;
+}
+
+// Evaluates one element per lane (el0_l) at one position per lane (s_l), stores the first count lanes
+template<int corr_selector>
+static void sample_lanes(const C_UniformParamsT<C_SampleLanes>& up_l, const C_ElementT<C_SampleLanes>& el0_l,
+                  const C_SampleLanes& s_l, int count, C_Element* out) {
+    C_SolutionBaseT<C_SampleLanes> base_s = C_EQLINK_link_base(up_l, el0_l.full, el0_l.base, s_l);
+    C_SolutionCorrT<C_SampleLanes> corr_s = C_EQLINK_link_corr_of<corr_selector>(up_l, el0_l.full, el0_l.base, el0_l.corr, s_l);
+    C_SolutionFullT<C_SampleLanes> full_s = C_EQLINK_link_full(up_l, el0_l.full, el0_l.base, base_s, corr_s, s_l);
+
+    C_ElementT<C_SampleLanes> el_s { full_s, base_s, corr_s };
+    C_lane_scatter(el_s, out, count);
+}
+
+// Calls fn(begin, end) for chunks of [0, count), on the pool's threads if there's more than one chunk
+static void for_sample_chunks(size_t count, C_ThreadPool* pool, const std::function<void(size_t, size_t)>& fn) {
+    if (count <= SAMPLE_CHUNK) {
+        fn(0, count);
+        return;
+    }
+
+    if (pool == nullptr) {
+        pool = &C_ThreadPool::shared();
+    }
+    size_t chunks_count = (count + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK;
+    pool->parallel_for(0, chunks_count, 1, [&](size_t chunk_i, size_t) {
+        size_t begin = chunk_i * SAMPLE_CHUNK;
+        fn(begin, std::min(begin + SAMPLE_CHUNK, count));
+    });
+}
+
+template<typename F>
+void C_SolverT<F>::sample(size_t element_i, const C_float* s, size_t count, Element* out, C_ThreadPool* pool) const {
+    // Without vector lanes (or for dual numbers) the plain kernels are used
+    if constexpr (!std::is_same<F, C_float>::value || C_SampleLanes::width == 1) {
+        for_sample_chunks(count, pool, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                out[k] = get_solution_at(element_i, s[k]);
+            }
+        });
+    }
+    else {
+        // Parameters & the element are spread across lanes once, only the positions change between evaluations
+        C_UniformParamsT<C_SampleLanes> up_l {};
+        C_lane_broadcast_to(up_l, up);
+        up_l.corr_selector = up.corr_selector;
+        up_l.elements_count = up.elements_count;
+
+        up_l.EI = element_EI(element_i);
+
+        C_ElementT<C_SampleLanes> el0_l {};
+        C_lane_broadcast_to(el0_l, elements[element_i]);
+
+        auto sample_kernel = up.corr_selector == 0 ? &sample_lanes<0> : &sample_lanes<1>;
+
+        for_sample_chunks(count, pool, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k += C_SampleLanes::width) {
+                int lanes_count = (int)std::min(end - k, (size_t)C_SampleLanes::width);
+
+                // Unused lanes repeat the first position
+                C_SampleLanes s_l = s[k];
+                for (int lane = 1; lane < lanes_count; ++lane) {
+                    s_l.set(lane, s[k + lane]);
+                }
+
+                sample_kernel(up_l, el0_l, s_l, lanes_count, out + k);
+            }
+        });
+    }
+}
+
+template<typename F>
+void C_SolverT<F>::sample(const C_float* positions, size_t count, Element* out, C_ThreadPool* pool) const {
+    size_t last_element_i = (size_t)up.elements_count - 1;
+    F each_length = up.total_length / (C_float)up.elements_count;
+
+    // Positions outside of the beam are extrapolated from the end elements
+    auto element_of = [&](C_float position) {
+        C_float element_f = floor(position / C_value(each_length));
+        size_t element_i = element_f > 0 ? (element_f < (C_float)last_element_i ? (size_t)element_f : last_element_i) : 0;
+        return element_i;
+    };
+
+    if constexpr (!std::is_same<F, C_float>::value || C_SampleLanes::width == 1) {
+        for_sample_chunks(count, pool, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                size_t element_i = element_of(positions[k]);
+                out[k] = get_solution_at(element_i, positions[k] - (C_float)element_i * each_length);
+            }
+        });
+    }
+    else {
+        C_UniformParamsT<C_SampleLanes> up_l {};
+        C_lane_broadcast_to(up_l, up);
+        up_l.corr_selector = up.corr_selector;
+        up_l.elements_count = up.elements_count;
+
+        auto sample_kernel = up.corr_selector == 0 ? &sample_lanes<0> : &sample_lanes<1>;
+
+        for_sample_chunks(count, pool, [&](size_t begin, size_t end) {
+            // Consecutive positions mostly fall into the same element, so a lane is only reloaded when its element changes
+            C_UniformParamsT<C_SampleLanes> chunk_up_l = up_l;
+            C_ElementT<C_SampleLanes> el0_l {};
+            size_t lane_elements[C_SampleLanes::width];
+            std::fill(lane_elements, lane_elements + C_SampleLanes::width, (size_t)-1);
+
+            for (size_t k = begin; k < end; k += C_SampleLanes::width) {
+                int lanes_count = (int)std::min(end - k, (size_t)C_SampleLanes::width);
+
+                C_SampleLanes s_l;
+                for (int lane = 0; lane < C_SampleLanes::width; ++lane) {
+                    // Unused lanes repeat the last position
+                    C_float position = positions[k + std::min(lane, lanes_count - 1)];
+
+                    size_t element_i = element_of(position);
+
+                    if (lane_elements[lane] != element_i) {
+                        C_lane_set(el0_l, lane, elements[element_i]);
+                        chunk_up_l.EI.set(lane, element_EI(element_i));
+                        lane_elements[lane] = element_i;
+                    }
+                    s_l.set(lane, position - (C_float)element_i * each_length);
+                }
+
+                sample_kernel(chunk_up_l, el0_l, s_l, lanes_count, out + k);
+            }
+        });
+    }
+}
+
+template<typename F>
+F C_SolverT<F>::end_deviation() const {
+    return elements[up.elements_count].full.y;
+}
+
+template<typename F>
+C_FitResult C_SolverT<F>::fit_angle(C_FitParams fp) {
+    C_FitResult result;
+    C_AngleFitter fitter;
+    fitter.reset(C_value(up.total_length));
+
+    C_ShootingParams sp;
+    sp.chunks_count = (size_t)std::max(fp.shooting_chunks, 0);
+
+    result.slope = fp.initial_slope;
+    C_float previous_angle = 0.0, previous_residual = 0.0;
+
+    while (true) {
+        if (fp.shooting_chunks > 0) {
+            result.traverse_status = traverse_shooting(sp).status;
+        }
+        else {
+            result.traverse_status = traverse(up.elements_count);
+        }
+        if (cancelled()) {
+            result.cancelled = true;
+            break;
+        }
+        ++result.iterations;
+
+        // Diverged traversals stop short of the end, so there's no residual (the fitter retreats from NaN)
+        bool healthy = result.traverse_status.ok();
+        if (!healthy) {
+            ++result.diverged_traversals;
+        }
+        F residual = healthy ? end_deviation() : C_with_value(end_deviation(), (C_float)NAN);
+        result.residual = C_value(residual);
+        result.residual_history.push_back(result.residual);
+
+        C_float angle = C_value(up.initial_angle);
+        if constexpr (std::is_same<F, C_DualFloat>::value) {
+            if (healthy) {
+                result.slope = residual.d[C_D_INITIAL_ANGLE];
+            }
+        }
+        else if (result.iterations > 1 && angle != previous_angle) {
+            C_float slope = (result.residual - previous_residual) / (angle - previous_angle);
+            if (std::isfinite(slope)) {
+                result.slope = slope;
+            }
+        }
+        previous_angle = angle;
+        previous_residual = result.residual;
+
+        if (fabs(result.residual) < fp.threshold) {
+            result.converged = true;
+            break;
+        }
+
+        if (result.iterations >= fp.max_iterations) {
+            break;
+        }
+
+        if constexpr (std::is_same<F, C_DualFloat>::value) {
+            angle = fitter.next(angle, result.residual, residual.d[C_D_INITIAL_ANGLE]);
+        }
+        else if (result.iterations == 1 && fp.initial_slope != 0.0) {
+            angle = fitter.next(angle, result.residual, fp.initial_slope);
+        }
+        else {
+            angle = fitter.next(angle, result.residual);
+        }
+        up.initial_angle = C_with_value(up.initial_angle, angle);
+    }
+
+    return result;
+}
+
+template<typename F>
+void C_SolverT<F>::forget() {
     internal_ensure_free();
+    arena.release();
     _was_setup = false;
 }
 
-void C_Solver::internal_re_alloc(size_t new_elements_count) {
+template<typename F>
+void C_SolverT<F>::internal_re_alloc(size_t new_elements_count) {
     if (allocated && new_elements_count == elements_count) {
         return;
     }
 
-    internal_ensure_free();
+    // Elements are used as raw storage (as uninitialised as new[] left them)
+    static_assert(std::is_trivially_default_constructible<Element>::value && std::is_trivially_destructible<Element>::value);
+    static_assert(alignof(Element) <= C_ARENA_ALIGNMENT);
 
-    elements = new C_Element[new_elements_count + 1];
+    // Arena keeps its capacity, so sizes that fit into it cost nothing
+    elements = static_cast<Element*>(arena.reserve(sizeof(Element) * (new_elements_count + 1)));
     allocated = true;
     elements_count = new_elements_count;
 }
 
-void C_Solver::internal_ensure_free() {
-    if (!allocated) {
-        return;
-    }
-
-    delete[] elements;
+template<typename F>
+void C_SolverT<F>::internal_ensure_free() {
+    // External elements aren't owned, & owned ones stay in the arena
     elements = nullptr;
     elements_count = NULL;
 
     allocated = false;
-}
\ No newline at end of file
+}
+
+template class C_SolverT<C_float>;
+template class C_SolverT<C_DualFloat>;
+
+
+C_UniformParamsT<C_DualFloat> C_dual_params(const C_UniformParams& up) {
+    C_UniformParamsT<C_DualFloat> dual_up {};
+    dual_up.corr_selector = up.corr_selector;
+    dual_up.EI = C_DualFloat::variable(up.EI, C_D_EI);
+    dual_up.initial_angle = C_DualFloat::variable(up.initial_angle, C_D_INITIAL_ANGLE);
+    dual_up.total_weight = C_DualFloat::variable(up.total_weight, C_D_TOTAL_WEIGHT);
+    dual_up.total_length = C_DualFloat::variable(up.total_length, C_D_TOTAL_LENGTH);
+    dual_up.gap = up.gap;
+    dual_up.elements_count = up.elements_count;
+    return dual_up;
+}
+
+C_UniformParams C_plain_params(const C_UniformParamsT<C_DualFloat>& up) {
+    C_UniformParams plain_up {};
+    plain_up.corr_selector = up.corr_selector;
+    plain_up.EI = up.EI.v;
+    plain_up.initial_angle = up.initial_angle.v;
+    plain_up.total_weight = up.total_weight.v;
+    plain_up.total_length = up.total_length.v;
+    plain_up.gap = up.gap.v;
+    plain_up.elements_count = up.elements_count;
+    return plain_up;
+}
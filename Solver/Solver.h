@@ -1,6 +1,16 @@
 #ifndef SHADERBEAMS_SOLVER_H
 #define SHADERBEAMS_SOLVER_H
 
+#include "Equations.h"
+#include "Dual.h"
+#include "ElementArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
 
 #define C_USE_DOUBLE_PRECISION 1
 
@@ -11,98 +21,351 @@
 #endif
 
 
-#define C_Basis_FIELDS t, n
-struct C_Basis {
-    C_float t[2];
-    C_float n[2];
+using C_Basis = C_BasisT<C_float>;
+using C_SolutionFull = C_SolutionFullT<C_float>;
+using C_SolutionBase = C_SolutionBaseT<C_float>;
+using C_SolutionCorr = C_SolutionCorrT<C_float>;
+using C_Element = C_ElementT<C_float>;
+using C_UniformParams = C_UniformParamsT<C_float>;
+
+const C_float PI = 3.14159265358979f;
+
+class C_ThreadPool;
+
+// Largest difference between two states of the beam, made dimensionless:
+// positions over the length, moments over EI / length & forces over EI / length²
+template<typename F>
+C_float C_state_difference(const C_SolutionFullT<F>& a, const C_SolutionFullT<F>& b, C_float length, C_float EI) {
+    C_float position = std::max(fabs(C_value(a.x - b.x)), fabs(C_value(a.y - b.y))) / length;
+    C_float angle = fabs(C_value(a.T - b.T));
+    C_float moment = fabs(C_value(a.M - b.M)) * length / EI;
+    C_float force = std::max(fabs(C_value(a.Fx - b.Fx)), fabs(C_value(a.Fy - b.Fy))) * length * length / EI;
+    return std::max(std::max(position, angle), std::max(moment, force));
+}
+
+// Precision the element formulae are evaluated in (elements are stored in C_float either way)
+// Mixed: float formulae, each solved from its element's start, with positions & angles chained in C_float
+// by compensated summation, so that rounding doesn't build up along the beam
+const int C_PRECISION_DOUBLE = 0;
+const int C_PRECISION_FLOAT = 1;
+const int C_PRECISION_MIXED = 2;
+
+
+// Why a traversal stopped before its end (C_TRAVERSE_OK if it didn't), see C_HealthParams & C_Solver::set_cancel_flag()
+const int C_TRAVERSE_OK = 0;
+const int C_TRAVERSE_NON_FINITE = 1;
+const int C_TRAVERSE_CURVATURE = 2;
+const int C_TRAVERSE_MOMENT = 3;
+const int C_TRAVERSE_FORCE = 4;
+const int C_TRAVERSE_CANCELLED = 5;
+
+// Name of a C_TRAVERSE_* reason (e.g. "non-finite")
+const char* C_traverse_reason_name(int reason);
+
+// Bounds of the cheap checks made on each element's end state while traversing, so that a diverging traversal
+// stops at the first bad element instead of computing the rest of the beam from garbage
+// Statics bound |M| by the load times the length & |N|, |Q| by the load, so the factors only catch runaway values
+// (which grow exponentially once a traversal diverges, so they're crossed within a few elements anyway)
+#define C_HealthParams_FIELDS enabled, max_element_turn, max_moment_factor, max_force_factor
+struct C_HealthParams {
+    bool enabled = true;
+    // Largest angle an element may bend through (|M| / EI times its length, in radians)
+    C_float max_element_turn = 1e6;
+    // |M| over total_weight * total_length (+ EI / total_length, for unloaded beams)
+    C_float max_moment_factor = 1e6;
+    // |N| & |Q| over total_weight (+ EI / total_length²)
+    C_float max_force_factor = 1e3;
 };
 
-#define C_SolutionFull_FIELDS x, y, M, T, tn, Fx, Fy
-struct C_SolutionFull {
-    C_float x, y;
-    C_float M;
-    C_float T;
-    C_Basis tn;
-    C_float Fx, Fy;
+struct C_TraverseStatus {
+    int reason = C_TRAVERSE_OK;
+    // Element whose end state failed the check (or the first one a cancelled traversal didn't reach):
+    // it & the following ones are left dirty
+    size_t element_i = 0;
+    // Offending magnitude (as the bound measures it, NaN or inf for C_TRAVERSE_NON_FINITE, NaN for C_TRAVERSE_CANCELLED)
+    C_float value = 0.0;
+
+    [[nodiscard]] bool ok() const { return reason == C_TRAVERSE_OK; }
 };
 
-#define C_SolutionBase_FIELDS u, w, M, T, tn
-struct C_SolutionBase {
-    C_float u, w;
-    C_float M;
-    C_float T;
-    C_Basis tn;
+#define C_FitParams_FIELDS threshold, max_iterations
+struct C_FitParams {
+    C_float threshold = 1e-3;
+    int max_iterations = 100;
+    // Traversals by multiple shooting in this many chunks (see C_ShootingParams), 0 traverses serially
+    int shooting_chunks = 0;
+    // Estimate of d(residual)/d(angle) near the initial angle (e.g. a previous fit's C_FitResult::slope),
+    // which makes the first step a Newton one; 0 means unknown
+    C_float initial_slope = 0.0;
 };
 
-#define C_SolutionCorr_FIELDS u, w, M, T, N, Q, Pt, Pn
-struct C_SolutionCorr {
-    C_float u, w;
-    C_float M;
-    C_float T;
-    C_float N, Q;
-    C_float Pt, Pn;
+struct C_FitResult {
+    bool converged = false;
+    // Stopped by the solver's cancel flag (the elements don't hold a solution then)
+    bool cancelled = false;
+    int iterations = 0;
+    C_float residual = 0.0;
+    std::vector<C_float> residual_history;
+    // d(residual)/d(angle) at the last traversals (secant of the last two, exact for dual solvers),
+    // or C_FitParams::initial_slope after a single one
+    C_float slope = 0.0;
+    // Traversals that stopped at an unhealthy element (their residual is NaN, so the fitter retreats from them)
+    int diverged_traversals = 0;
+    // Of the last traversal (the elements from its element_i on don't hold a solution unless it's ok)
+    C_TraverseStatus traverse_status;
 };
 
-#define C_Element_FIELDS full, base, corr
-struct C_Element {
-    C_SolutionFull full;
-    C_SolutionBase base;
-    C_SolutionCorr corr;
+// Multiple shooting: the beam is split into chunks that are traversed in parallel from guessed starting states,
+// which are corrected (parareal) by a serial coarse traversal of the chunks until they join up
+// Each iteration makes at least one more chunk exact, so it takes at most chunks_count of them (a serial traversal's work)
+struct C_ShootingParams {
+    // 0 means one chunk per pool thread
+    size_t chunks_count = 0;
+    // Fine elements merged into each element of the coarse traversal
+    size_t coarse_factor = 32;
+    // Largest mismatch between a chunk's end & the next chunk's start (see C_state_difference)
+    C_float tolerance = 1e-9;
+    // 0 means chunks_count
+    int max_iterations = 0;
 };
 
-#define C_UniformParams_FIELDS corr_selector, EI, initial_angle, total_weight, total_length, gap, elements_count
-struct C_UniformParams {
-    int corr_selector;
-    C_float EI;
-    C_float initial_angle;
-    C_float total_weight;
-    C_float total_length;
-    C_float gap;
-    int elements_count;
+struct C_ShootingResult {
+    bool converged = false;
+    int iterations = 0;
+    C_float mismatch = 0.0;
+    // Chunks propagated from guessed starts may fail the checks & be corrected, only a chunk with an exact start stops it
+    C_TraverseStatus status;
 };
 
-#define UP_ARRAY_SIZE 7
+// Finds the initial angle at which the end deviation (residual) vanishes
+// Takes (clamped) secant steps until the root is bracketed, then switches to Illinois (modified regula falsi)
+class C_AngleFitter {
+public:
+    void reset(C_float new_scale);
+
+    // Accepts the residual obtained at the given angle & returns the angle to try next
+    C_float next(C_float angle, C_float residual);
 
-C_SolutionFull C_EQLINK_setup_initial_border(C_UniformParams up);
-C_SolutionBase C_EQLINK_setup_base(C_UniformParams up, C_SolutionFull full0);
-C_SolutionCorr C_EQLINK_setup_corr(C_UniformParams up, C_SolutionFull full0, C_SolutionBase base0);
-C_SolutionBase C_EQLINK_link_base(C_UniformParams up, C_SolutionFull full0, C_SolutionBase base0, C_float s);
-C_SolutionCorr C_EQLINK_link_corr(C_UniformParams up, [[maybe_unused]] C_SolutionFull full0, C_SolutionBase base0, C_SolutionCorr corr0, C_float s);
-C_SolutionCorr C_EQLINK_link_corr_linear(C_UniformParams up, [[maybe_unused]] C_SolutionFull full0, C_SolutionBase base0, C_SolutionCorr corr0, C_float s);
-C_SolutionCorr C_EQLINK_link_corr_exponential(C_UniformParams up, [[maybe_unused]] C_SolutionFull full0, C_SolutionBase base0, C_SolutionCorr corr0, C_float s);
-C_SolutionFull C_EQLINK_link_full([[maybe_unused]] C_UniformParams up, C_SolutionFull full0, C_SolutionBase base0, C_SolutionBase base_s, C_SolutionCorr corr_s,
-                                  [[maybe_unused]] C_float s);
+    // Same, with the exact slope d(residual)/d(angle): Newton steps replace the secant ones,
+    // & are taken within the bracket whenever they stay strictly inside it
+    C_float next(C_float angle, C_float residual, C_float slope);
 
-const C_float PI = 3.14159265358979f;
+    [[nodiscard]] bool bracketed() const { return _bracketed; }
+
+private:
+    C_float relaxation_step(C_float residual) const;
 
-class C_Solver {
+    C_float clamp_step(C_float step) const;
+
+    C_float scale = 1.0;
+
+    // (a, fa) - older point (opposite sign of fb when bracketed), (b, fb) - latest finite point
+    C_float a = 0.0, fa = 0.0;
+    C_float b = 0.0, fb = 0.0;
+    int points = 0;
+    bool _bracketed = false;
+};
+
+// Solver over the number type F: C_float for plain solutions, C_DualFloat for solutions together with their derivatives
+template<typename F>
+class C_SolverT {
 public:
-    void setup(C_UniformParams new_up);
+    using Params = C_UniformParamsT<F>;
+    using Element = C_ElementT<F>;
+
+    void setup(const Params& new_up);
+
+    // Same, with the elements kept in external storage of up.elements_count + 1 of them (e.g. a mapped file)
+    // instead of allocated ones; it must stay valid until the next setup() or forget()
+    void setup(const Params& new_up, Element* external_elements);
 
     [[nodiscard]] bool was_setup() const { return _was_setup; }
 
-    void traverse(size_t begin, size_t end) const;
+    // Solves elements up to end
+    // Elements before the lowest dirty one are kept from the previous traversal, so solving always resumes from it
+    // (mark_dirty(0) forces a whole re-solve)
+    // Stops at the first element whose end state fails the health checks (see set_health_params()), leaving it dirty
+    C_TraverseStatus traverse(size_t end) const;
+
+    // Solves the remaining elements (up to the end) by multiple shooting across the pool's threads
+    // Once converged, elements are as continuous as the tolerance (& exactly the serial ones if the chain became exact)
+    // Otherwise elements past the exact part of the chain are left dirty
+    // Precisions other than double traverse serially
+    C_ShootingResult traverse_shooting(const C_ShootingParams& sp, C_ThreadPool* pool = nullptr) const;
+
+    // Marks element_i & all the following ones as needing a re-solve
+    // Changes to up are detected by traverse() itself
+    void mark_dirty(size_t element_i);
+
+    [[nodiscard]] size_t dirty_begin() const { return _dirty_begin; }
+
+    // Lowest element written since the last call (or setup()), elements_count + 1 if none was
+    // Lets copies of the elements (e.g. GPU buffers) be updated from it on
+    size_t take_changed_begin();
+
+    // Takes the elements as they are (e.g. loaded from a file) as the solution for up & the current profiles,
+    // so that traversals don't recompute them
+    void mark_solved();
+
+    // Optional per-element stiffness & weight (tapered beams, local attachments)
+    // Override up.EI & the uniform share of up.total_weight for that element, dropped by setup()
+    void set_element_EI(size_t element_i, F EI);
+
+    void set_element_weight(size_t element_i, F weight);
+
+    // Same for the first count elements at once (nothing if count is 0), marking the beam dirty only once
+    void set_EI_profile(const C_float* EI, size_t count);
+
+    void set_weight_profile(const C_float* weights, size_t count);
+
+    [[nodiscard]] F element_EI(size_t element_i) const;
+
+    [[nodiscard]] F element_weight(size_t element_i) const;
 
-    C_Element get_solution_at(size_t element_i, C_float s) const;
+    [[nodiscard]] bool has_EI_profile() const { return !EI_profile.empty(); }
 
+    [[nodiscard]] bool has_weight_profile() const { return !weight_profile.empty(); }
+
+    // One of C_PRECISION_*, kept across setup() (plain solvers only, dual ones always use their own type)
+    // Float drops the exponential correction's accuracy (its terms cancel out), so it's evaluated in double anyway
+    void set_precision(int new_precision);
+
+    [[nodiscard]] int precision() const { return _precision; }
+
+    // Flag set from another thread to stop traversals (between chunks of elements) & fit_angle() (between traversals)
+    // Elements past the stop are left dirty; nullptr (default) traverses without any checks
+    void set_cancel_flag(const std::atomic<bool>* flag) { cancel_flag = flag; }
+
+    [[nodiscard]] bool cancelled() const { return cancel_flag != nullptr && cancel_flag->load(std::memory_order_relaxed); }
+
+    // Bounds of the per-element checks of traversals, which only stop the following ones
+    void set_health_params(const C_HealthParams& hp) { health = hp; }
+
+    [[nodiscard]] const C_HealthParams& health_params() const { return health; }
+
+    Element get_solution_at(size_t element_i, F s) const;
+
+    // Solution at count arc-length positions s of one element (measured from the element's start)
+    // Positions are evaluated several at a time across vector lanes, & split between the pool's threads when there are many
+    // pool defaults to C_ThreadPool::shared()
+    void sample(size_t element_i, const C_float* s, size_t count, Element* out, C_ThreadPool* pool = nullptr) const;
+
+    // Solution at count global positions along the whole beam (from 0 to up.total_length)
+    void sample(const C_float* positions, size_t count, Element* out, C_ThreadPool* pool = nullptr) const;
+
+    // Vertical offset of the beam's right end (should be zero for the right hinge)
+    [[nodiscard]] F end_deviation() const;
+
+    // Repeatedly traverses the whole beam, adjusting the initial angle until the end deviation is within threshold
+    // Elements are left holding the solution for the final angle
+    // With dual numbers, the exact slope (derivative with respect to C_D_INITIAL_ANGLE) replaces the secant's estimate
+    C_FitResult fit_angle(C_FitParams fp);
+
+    // Drops the solution & releases the elements' storage (which setup() otherwise keeps for any later size)
     void forget();
 
-    ~C_Solver() { forget(); }
+    ~C_SolverT() { forget(); }
 
-    C_UniformParams up {};
+    Params up {};
 
-    C_Element* elements = nullptr;
+    Element* elements = nullptr;
 
 private:
+    // Health bounds of a traversal, in the units of the element's end state
+    struct HealthBounds {
+        bool enabled = false;
+        C_float each_length = 0.0;
+        C_float max_element_turn = 0.0;
+        C_float max_moment = 0.0;
+        C_float max_force = 0.0;
+    };
+
+    template<int corr_selector>
+    C_TraverseStatus internal_traverse(size_t begin, size_t end) const;
+
+    // Traverses [begin, end) from start, writing the elements' starts & coefficients, & returns the end state
+    // (elements[end] isn't written, so neighbouring chunks can be traversed concurrently)
+    // With status, stops at the first element whose end state is unhealthy (its end isn't written) & returns that state
+    template<int corr_selector>
+    C_SolutionFullT<F> internal_traverse_chunk(size_t begin, size_t end, const C_SolutionFullT<F>& start,
+                                               C_TraverseStatus* status = nullptr) const;
+
+    // End state of [begin, end) traversed with coarse_factor elements merged into each one (nothing is written)
+    template<int corr_selector>
+    C_SolutionFullT<F> internal_coarse_chunk(size_t begin, size_t end, const C_SolutionFullT<F>& start,
+                                             size_t coarse_factor) const;
+
+    // Evaluates the formulae in float (from each element's start if mixed)
+    template<int corr_selector, bool mixed>
+    C_TraverseStatus internal_traverse_float(size_t begin, size_t end) const;
+
+    template<int corr_selector>
+    Element internal_solution_at(const Params& up_el, size_t element_i, F s) const;
+
+    // up as seen by one element (with its own stiffness)
+    Params internal_element_params(size_t element_i) const;
+
+    F internal_left_reaction() const;
+
+    HealthBounds internal_health_bounds() const;
+
+    // Checks element_i's end state, filling status (& returning false) if it's unhealthy
+    bool internal_check_health(const HealthBounds& bounds, size_t element_i, const C_SolutionFullT<F>& full1,
+                               C_TraverseStatus& status) const;
+
     void internal_re_alloc(size_t new_elements_count);
 
     void internal_ensure_free();
 
+    void internal_setup(const Params& new_up);
+
+    void internal_pick_kernels();
+
     bool _was_setup = false;
+    int _precision = C_PRECISION_DOUBLE;
+
+    // Instantiations for up.corr_selector & the precision, picked in setup()
+    C_TraverseStatus (C_SolverT::*traverse_kernel)(size_t, size_t) const = nullptr;
+    Element (C_SolverT::*solution_at_kernel)(const Params&, size_t, F) const = nullptr;
+
+    std::vector<F> EI_profile;
+    std::vector<F> weight_profile;
+    // Sum of |weight| over weight_profile (the load the health bounds scale with)
+    C_float weight_profile_load = 0.0;
 
+    const std::atomic<bool>* cancel_flag = nullptr;
+
+    C_HealthParams health;
+
+    // Elements before it are solved for solved_up & the current profiles
+    mutable size_t _dirty_begin = 0;
+    mutable Params solved_up {};
+    mutable size_t _changed_begin = 0;
+
+    // Owned elements live in the arena (external ones don't)
+    C_ElementArena arena;
     size_t elements_count = 0;
     bool allocated = false;
 };
 
+using C_Solver = C_SolverT<C_float>;
+
+// Parameters that dual solutions are differentiated with respect to (indices of C_DualFloat::d)
+const int C_D_INITIAL_ANGLE = 0;
+const int C_D_EI = 1;
+const int C_D_TOTAL_WEIGHT = 2;
+const int C_D_TOTAL_LENGTH = 3;
+const int C_D_COUNT = 4;
+
+using C_DualFloat = C_Dual<C_float, C_D_COUNT>;
+using C_DualSolver = C_SolverT<C_DualFloat>;
+
+// Seeds the parameters above, so that a single traversal of a C_DualSolver yields
+// the solution together with its whole Jacobian (e.g. elements[n].full.y.d[C_D_EI] is d(end deflection)/d(EI))
+C_UniformParamsT<C_DualFloat> C_dual_params(const C_UniformParams& up);
+
+// Plain parameters of a dual problem
+C_UniformParams C_plain_params(const C_UniformParamsT<C_DualFloat>& up);
+
 
 #endif //SHADERBEAMS_SOLVER_H
@@ -0,0 +1,292 @@
+#include "SolverC.h"
+#include "Solver.h"
+#include "Sweep.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+// Layouts the interface promises
+static_assert(sizeof(C_float) == sizeof(double));
+static_assert(sizeof(beams_state) == sizeof(C_SolutionFull));
+static_assert(offsetof(beams_state, t) == offsetof(C_SolutionFull, tn.t) && offsetof(beams_state, Fy) == offsetof(C_SolutionFull, Fy));
+static_assert(BEAMS_PRECISION_DOUBLE == C_PRECISION_DOUBLE && BEAMS_PRECISION_FLOAT == C_PRECISION_FLOAT &&
+              BEAMS_PRECISION_MIXED == C_PRECISION_MIXED);
+static_assert(BEAMS_TRAVERSE_OK == C_TRAVERSE_OK && BEAMS_TRAVERSE_NON_FINITE == C_TRAVERSE_NON_FINITE &&
+              BEAMS_TRAVERSE_CURVATURE == C_TRAVERSE_CURVATURE && BEAMS_TRAVERSE_MOMENT == C_TRAVERSE_MOMENT &&
+              BEAMS_TRAVERSE_FORCE == C_TRAVERSE_FORCE && BEAMS_TRAVERSE_CANCELLED == C_TRAVERSE_CANCELLED);
+
+struct beams_solver {
+    C_Solver solver;
+};
+
+struct ElementField {
+    const char* name;
+    size_t offset;
+};
+
+#define ELEMENT_FIELD(field) { #field, offsetof(C_Element, field) }
+#define ELEMENT_BASIS_FIELDS(prefix) { #prefix ".tn.t0", offsetof(C_Element, prefix.tn.t[0]) }, \
+                                     { #prefix ".tn.t1", offsetof(C_Element, prefix.tn.t[1]) }, \
+                                     { #prefix ".tn.n0", offsetof(C_Element, prefix.tn.n[0]) }, \
+                                     { #prefix ".tn.n1", offsetof(C_Element, prefix.tn.n[1]) }
+
+// In the order of the fields (& so of their offsets)
+static const ElementField ELEMENT_FIELDS[] = {
+    ELEMENT_FIELD(full.x), ELEMENT_FIELD(full.y), ELEMENT_FIELD(full.M), ELEMENT_FIELD(full.T),
+    ELEMENT_BASIS_FIELDS(full), ELEMENT_FIELD(full.Fx), ELEMENT_FIELD(full.Fy),
+    ELEMENT_FIELD(base.u), ELEMENT_FIELD(base.w), ELEMENT_FIELD(base.M), ELEMENT_FIELD(base.T),
+    ELEMENT_BASIS_FIELDS(base),
+    ELEMENT_FIELD(corr.u), ELEMENT_FIELD(corr.w), ELEMENT_FIELD(corr.M), ELEMENT_FIELD(corr.T),
+    ELEMENT_FIELD(corr.N), ELEMENT_FIELD(corr.Q), ELEMENT_FIELD(corr.Pt), ELEMENT_FIELD(corr.Pn),
+};
+static_assert(sizeof(ELEMENT_FIELDS) / sizeof(ELEMENT_FIELDS[0]) * sizeof(C_float) == sizeof(C_Element));
+
+static C_UniformParams from_beams_params(const beams_params& params) {
+    C_UniformParams up {};
+    up.corr_selector = params.corr_selector;
+    up.elements_count = params.elements_count;
+    up.EI = params.EI;
+    up.initial_angle = params.initial_angle;
+    up.total_weight = params.total_weight;
+    up.total_length = params.total_length;
+    up.gap = params.gap;
+    return up;
+}
+
+static bool valid_params(const beams_params* params) {
+    return params != nullptr && params->elements_count > 0 && (params->corr_selector == 0 || params->corr_selector == 1);
+}
+
+static C_FitParams from_beams_fit_params(const beams_fit_params* fit_params) {
+    C_FitParams fp;
+    if (fit_params != nullptr) {
+        fp.threshold = fit_params->threshold;
+        fp.max_iterations = fit_params->max_iterations;
+        fp.shooting_chunks = fit_params->shooting_chunks;
+    }
+    return fp;
+}
+
+static void to_beams_result(const C_FitResult& fit, const C_UniformParams& up, const C_SolutionFull& end, beams_result* result) {
+    if (result == nullptr) {
+        return;
+    }
+    result->converged = fit.converged;
+    result->iterations = fit.iterations;
+    result->residual = fit.residual;
+    result->initial_angle = up.initial_angle;
+    result->end = *(const beams_state*)&end;
+    if (!fit.traverse_status.ok()) {
+        // End element wasn't reached, so it holds an older traversal's state
+        double* values = (double*)&result->end;
+        for (size_t value_i = 0; value_i < sizeof(beams_state) / sizeof(double); ++value_i) {
+            values[value_i] = NAN;
+        }
+    }
+    result->diverged = fit.traverse_status.reason;
+    result->diverged_element = fit.traverse_status.ok() ? 0 : (int32_t)fit.traverse_status.element_i;
+}
+
+// Exceptions (e.g. bad_alloc) must not cross the interface
+template<typename Fn>
+static int guarded(Fn&& fn) {
+    try {
+        return fn();
+    }
+    catch (...) {
+        return BEAMS_ERROR_INTERNAL;
+    }
+}
+
+
+uint32_t beams_abi_version(void) {
+    return BEAMS_ABI_VERSION;
+}
+
+beams_solver* beams_solver_create(void) {
+    return new (std::nothrow) beams_solver();
+}
+
+void beams_solver_destroy(beams_solver* solver) {
+    delete solver;
+}
+
+int beams_solver_set_precision(beams_solver* solver, int precision) {
+    if (solver == nullptr || precision < BEAMS_PRECISION_DOUBLE || precision > BEAMS_PRECISION_MIXED) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    solver->solver.set_precision(precision);
+    return BEAMS_OK;
+}
+
+int beams_solver_setup(beams_solver* solver, const beams_params* params) {
+    if (solver == nullptr || !valid_params(params)) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    return guarded([&] {
+        solver->solver.setup(from_beams_params(*params));
+        return BEAMS_OK;
+    });
+}
+
+int beams_solver_set_profiles(beams_solver* solver, const double* EI, const double* weight) {
+    if (solver == nullptr) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    C_Solver& s = solver->solver;
+    if (!s.was_setup()) {
+        return BEAMS_ERROR_STATE;
+    }
+    return guarded([&] {
+        size_t elements_count = (size_t)s.up.elements_count;
+        if (EI != nullptr) {
+            s.set_EI_profile(EI, elements_count);
+        }
+        if (weight != nullptr) {
+            s.set_weight_profile(weight, elements_count);
+        }
+        return BEAMS_OK;
+    });
+}
+
+int beams_solver_get_params(const beams_solver* solver, beams_params* params) {
+    if (solver == nullptr || params == nullptr) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    const C_UniformParams& up = solver->solver.up;
+    params->corr_selector = up.corr_selector;
+    params->elements_count = up.elements_count;
+    params->EI = up.EI;
+    params->initial_angle = up.initial_angle;
+    params->total_weight = up.total_weight;
+    params->total_length = up.total_length;
+    params->gap = up.gap;
+    return BEAMS_OK;
+}
+
+int beams_solver_set_initial_angle(beams_solver* solver, double initial_angle) {
+    if (solver == nullptr) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    // Traversals notice the change themselves
+    solver->solver.up.initial_angle = initial_angle;
+    return BEAMS_OK;
+}
+
+int beams_solver_traverse(beams_solver* solver, beams_result* result) {
+    if (solver == nullptr) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    C_Solver& s = solver->solver;
+    if (!s.was_setup()) {
+        return BEAMS_ERROR_STATE;
+    }
+    return guarded([&] {
+        size_t elements_count = (size_t)s.up.elements_count;
+        C_FitResult fit;
+        fit.traverse_status = s.traverse(elements_count);
+        fit.converged = fit.traverse_status.ok();
+        fit.iterations = 1;
+        fit.residual = fit.converged ? s.end_deviation() : NAN;
+        to_beams_result(fit, s.up, s.elements[elements_count].full, result);
+        return BEAMS_OK;
+    });
+}
+
+int beams_solver_fit(beams_solver* solver, const beams_fit_params* fit_params, beams_result* result) {
+    if (solver == nullptr) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    C_Solver& s = solver->solver;
+    if (!s.was_setup()) {
+        return BEAMS_ERROR_STATE;
+    }
+    return guarded([&] {
+        C_FitResult fit = s.fit_angle(from_beams_fit_params(fit_params));
+        to_beams_result(fit, s.up, s.elements[s.up.elements_count].full, result);
+        return BEAMS_OK;
+    });
+}
+
+const void* beams_solver_elements(const beams_solver* solver, size_t* count, size_t* element_size) {
+    if (solver == nullptr || !solver->solver.was_setup()) {
+        return nullptr;
+    }
+    if (count != nullptr) {
+        *count = (size_t)solver->solver.up.elements_count + 1;
+    }
+    if (element_size != nullptr) {
+        *element_size = sizeof(C_Element);
+    }
+    return solver->solver.elements;
+}
+
+int beams_solver_sample(const beams_solver* solver, const double* positions, size_t count, void* out) {
+    if (solver == nullptr || (count > 0 && (positions == nullptr || out == nullptr))) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    const C_Solver& s = solver->solver;
+    if (!s.was_setup()) {
+        return BEAMS_ERROR_STATE;
+    }
+    return guarded([&] {
+        s.sample(positions, count, (C_Element*)out);
+        return BEAMS_OK;
+    });
+}
+
+size_t beams_element_size(void) {
+    return sizeof(C_Element);
+}
+
+size_t beams_element_fields_count(void) {
+    return sizeof(ELEMENT_FIELDS) / sizeof(ELEMENT_FIELDS[0]);
+}
+
+const char* beams_element_field_name(size_t field_i) {
+    return field_i < beams_element_fields_count() ? ELEMENT_FIELDS[field_i].name : nullptr;
+}
+
+size_t beams_element_field_offset(size_t field_i) {
+    return field_i < beams_element_fields_count() ? ELEMENT_FIELDS[field_i].offset : 0;
+}
+
+int beams_solve_batch(const beams_params* params, size_t count, int fit, const beams_fit_params* fit_params, int precision,
+                      size_t threads_count, beams_result* results) {
+    if ((count > 0 && (params == nullptr || results == nullptr)) ||
+        precision < BEAMS_PRECISION_DOUBLE || precision > BEAMS_PRECISION_MIXED) {
+        return BEAMS_ERROR_ARGUMENT;
+    }
+    for (size_t problem_i = 0; problem_i < count; ++problem_i) {
+        if (!valid_params(&params[problem_i])) {
+            return BEAMS_ERROR_ARGUMENT;
+        }
+    }
+
+    return guarded([&] {
+        std::vector<C_UniformParams> ups(count);
+        for (size_t problem_i = 0; problem_i < count; ++problem_i) {
+            ups[problem_i] = from_beams_params(params[problem_i]);
+        }
+
+        std::unique_ptr<C_ThreadPool> own_pool;
+        if (threads_count > 0) {
+            own_pool = std::make_unique<C_ThreadPool>(threads_count);
+        }
+        C_Sweep sweep(own_pool != nullptr ? *own_pool : C_ThreadPool::shared());
+        sweep.precision = precision;
+        // Results only need the end states
+        sweep.export_solutions = false;
+
+        // Each result has its own slot, so workers don't need to synchronise
+        sweep.run(ups, fit != 0, from_beams_fit_params(fit_params), [&](const C_SweepResult& result, const C_Solver&) {
+            to_beams_result(result.fit, result.up, result.end, &results[result.index]);
+        });
+        return BEAMS_OK;
+    });
+}
@@ -0,0 +1,142 @@
+#ifndef SHADERBEAMS_SOLVERC_H
+#define SHADERBEAMS_SOLVERC_H
+
+/*
+ * Stable C interface of the Solver library (for ctypes, cffi & other languages)
+ * Structures have fixed layouts of doubles & 32-bit integers; calls return BEAMS_OK or a negative status
+ * Arrays are provided by the caller, except for a solver's elements, which are exposed in place (see beams_solver_elements)
+ * Functions of different solvers may be called from different threads at once
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Incremented whenever a declaration below changes incompatibly */
+#define BEAMS_ABI_VERSION 2
+
+#define BEAMS_OK 0
+#define BEAMS_ERROR_ARGUMENT (-1)
+/* Solver wasn't set up yet */
+#define BEAMS_ERROR_STATE (-2)
+/* Out of memory & other failures inside the library */
+#define BEAMS_ERROR_INTERNAL (-3)
+
+/* Same as C_PRECISION_* */
+#define BEAMS_PRECISION_DOUBLE 0
+#define BEAMS_PRECISION_FLOAT 1
+#define BEAMS_PRECISION_MIXED 2
+
+/* Same as C_TRAVERSE_*: why the last traversal stopped at an unhealthy element (or was cancelled) */
+#define BEAMS_TRAVERSE_OK 0
+#define BEAMS_TRAVERSE_NON_FINITE 1
+#define BEAMS_TRAVERSE_CURVATURE 2
+#define BEAMS_TRAVERSE_MOMENT 3
+#define BEAMS_TRAVERSE_FORCE 4
+#define BEAMS_TRAVERSE_CANCELLED 5
+
+typedef struct beams_params {
+    int32_t corr_selector;
+    int32_t elements_count;
+    double EI;
+    double initial_angle;
+    double total_weight;
+    double total_length;
+    double gap;
+} beams_params;
+
+typedef struct beams_fit_params {
+    double threshold;
+    int32_t max_iterations;
+    /* Traversals by multiple shooting in this many chunks, 0 traverses serially */
+    int32_t shooting_chunks;
+} beams_fit_params;
+
+/* Same layout as C_SolutionFull */
+typedef struct beams_state {
+    double x, y;
+    double M;
+    double T;
+    double t[2];
+    double n[2];
+    double Fx, Fy;
+} beams_state;
+
+typedef struct beams_result {
+    int32_t converged;
+    int32_t iterations;
+    double residual;
+    /* Fitted (or given) initial angle */
+    double initial_angle;
+    /* State at the right end */
+    beams_state end;
+    /* One of BEAMS_TRAVERSE_* for the last traversal, & the element it stopped at (the residual is NaN then) */
+    int32_t diverged;
+    int32_t diverged_element;
+} beams_result;
+
+typedef struct beams_solver beams_solver;
+
+uint32_t beams_abi_version(void);
+
+/* NULL when out of memory */
+beams_solver* beams_solver_create(void);
+
+void beams_solver_destroy(beams_solver* solver);
+
+/* One of BEAMS_PRECISION_*, kept across setups */
+int beams_solver_set_precision(beams_solver* solver, int precision);
+
+/* Allocates params->elements_count + 1 elements (storage is reused by later setups that fit into it) */
+int beams_solver_setup(beams_solver* solver, const beams_params* params);
+
+/* Per-element stiffness & weight (either may be NULL), elements_count of each; dropped by the next setup */
+int beams_solver_set_profiles(beams_solver* solver, const double* EI, const double* weight);
+
+/* Current parameters (with the fitted angle after a fit) */
+int beams_solver_get_params(const beams_solver* solver, beams_params* params);
+
+int beams_solver_set_initial_angle(beams_solver* solver, double initial_angle);
+
+/* Single traversal at the current initial angle (result may be NULL) */
+int beams_solver_traverse(beams_solver* solver, beams_result* result);
+
+/* Fits the initial angle (fit_params may be NULL for the defaults) */
+int beams_solver_fit(beams_solver* solver, const beams_fit_params* fit_params, beams_result* result);
+
+/*
+ * Elements in place: elements_count + 1 of them, element_size bytes apart, each one made of the doubles
+ * listed by beams_element_field_*() (so NumPy can view them as a structured array without copying)
+ * Stays valid until the next setup or destroy
+ */
+const void* beams_solver_elements(const beams_solver* solver, size_t* count, size_t* element_size);
+
+/* Elements at count arc-length positions along the whole beam, written element_size bytes apart into out */
+int beams_solver_sample(const beams_solver* solver, const double* positions, size_t count, void* out);
+
+size_t beams_element_size(void);
+
+size_t beams_element_fields_count(void);
+
+/* Name (e.g. "full.x" or "base.tn.t0") & byte offset within an element of a field, NULL & 0 past the last one */
+const char* beams_element_field_name(size_t field_i);
+
+size_t beams_element_field_offset(size_t field_i);
+
+/*
+ * Solves count problems on the library's thread pool (one per vector lane where possible), fitting them if fit
+ * Results (count of them) are in the order of the problems; threads_count 0 uses the shared pool
+ */
+int beams_solve_batch(const beams_params* params, size_t count, int fit, const beams_fit_params* fit_params, int precision,
+                      size_t threads_count, beams_result* results);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SHADERBEAMS_SOLVERC_H
@@ -0,0 +1,189 @@
+#include "SolverWorker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+C_SolverWorker::C_SolverWorker() {
+    solver.set_cancel_flag(&cancel);
+    thread = std::thread(&C_SolverWorker::worker_loop, this);
+}
+
+C_SolverWorker::~C_SolverWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel = true;
+    }
+    request_cv.notify_all();
+    thread.join();
+}
+
+uint64_t C_SolverWorker::submit(C_SolveRequest request) {
+    uint64_t request_generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(request);
+        has_pending = true;
+        request_generation = ++generation;
+        // The solve in flight is stale now
+        if (solving) {
+            cancel = true;
+        }
+    }
+    request_cv.notify_all();
+    return request_generation;
+}
+
+void C_SolverWorker::cancel_all() {
+    std::lock_guard<std::mutex> lock(mutex);
+    has_pending = false;
+    if (solving) {
+        cancel = true;
+    }
+    if (middle_fresh) {
+        dropped_changed_begin = std::min(dropped_changed_begin, snapshots[middle].changed_begin);
+        middle_fresh = false;
+    }
+}
+
+const C_SolveSnapshot* C_SolverWorker::take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!middle_fresh) {
+        return nullptr;
+    }
+    std::swap(front, middle);
+    middle_fresh = false;
+    return &snapshots[front];
+}
+
+bool C_SolverWorker::busy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return has_pending || solving;
+}
+
+void C_SolverWorker::worker_loop() {
+    C_SolveRequest request;
+
+    while (true) {
+        uint64_t request_generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            request_cv.wait(lock, [this] { return stopping || has_pending; });
+            if (stopping) {
+                return;
+            }
+            request = std::move(pending);
+            has_pending = false;
+            request_generation = generation;
+            solving = true;
+            cancel = false;
+        }
+
+        C_SolveSnapshot& snapshot = snapshots[back];
+        internal_solve(request, snapshot);
+        snapshot.generation = request_generation;
+
+        // Publishing checks the flag under the lock, so that cancel_all() can't miss a snapshot
+        std::lock_guard<std::mutex> lock(mutex);
+        solving = false;
+        if (!cancel && !snapshot.fit.cancelled) {
+            // Changes of dropped snapshots & of a snapshot that wasn't taken are passed on
+            snapshot.changed_begin = std::min(snapshot.changed_begin, dropped_changed_begin);
+            dropped_changed_begin = SIZE_MAX;
+            if (middle_fresh) {
+                snapshot.changed_begin = std::min(snapshot.changed_begin, snapshots[middle].changed_begin);
+            }
+            std::swap(back, middle);
+            middle_fresh = true;
+        }
+        else {
+            dropped_changed_begin = std::min(dropped_changed_begin, snapshot.changed_begin);
+        }
+    }
+}
+
+void C_SolverWorker::internal_solve(const C_SolveRequest& request, C_SolveSnapshot& snapshot) {
+    const C_UniformParams& up = request.up;
+
+    if (request.auto_elements) {
+        if (solver.precision() != request.precision) {
+            solver.set_precision(request.precision);
+        }
+        C_ConvergenceResult convergence = C_converge_mesh(solver, up, request.cp, request.auto_fit_angle, request.fp);
+        C_FitResult fit;
+        if (convergence.cancelled) {
+            fit.cancelled = true;
+        }
+        else {
+            fit = convergence.last().fit;
+        }
+        internal_publish(request, std::move(fit), std::move(convergence), snapshot);
+        return;
+    }
+
+    // The workspace is kept between requests, so changes that keep its layout re-solve incrementally
+    bool has_profiles = !request.EI_profile.empty() || !request.weight_profile.empty();
+    if (!solver.was_setup() || up.elements_count != solver.up.elements_count || up.corr_selector != solver.up.corr_selector ||
+        has_profiles || solver.has_EI_profile() || solver.has_weight_profile()) {
+        solver.set_precision(request.precision);
+        solver.setup(up);
+        solver.set_EI_profile(request.EI_profile.data(), request.EI_profile.size());
+        solver.set_weight_profile(request.weight_profile.data(), request.weight_profile.size());
+    }
+    else {
+        if (solver.precision() != request.precision) {
+            solver.set_precision(request.precision);
+        }
+        solver.up = up;
+    }
+
+    // Problems solved before are published without a traversal
+    C_SolutionKey key;
+    C_FitResult fit;
+    if (request.use_cache) {
+        key = C_SolutionCache::key_of(solver, request.auto_fit_angle, request.fp);
+        if (_cache.load(key, solver, fit)) {
+            internal_publish(request, std::move(fit), C_ConvergenceResult(), snapshot);
+            return;
+        }
+    }
+
+    if (request.auto_fit_angle) {
+        fit = solver.fit_angle(request.fp);
+    }
+    else {
+        fit.traverse_status = solver.traverse((size_t)up.elements_count);
+        fit.cancelled = solver.cancelled();
+        fit.converged = !fit.cancelled && fit.traverse_status.ok();
+        fit.iterations = 1;
+        fit.residual = fit.traverse_status.ok() ? solver.end_deviation() : NAN;
+    }
+    if (request.use_cache) {
+        _cache.store(key, solver, fit);
+    }
+    internal_publish(request, std::move(fit), C_ConvergenceResult(), snapshot);
+}
+
+void C_SolverWorker::internal_publish(const C_SolveRequest& request, C_FitResult fit, C_ConvergenceResult convergence,
+                                      C_SolveSnapshot& snapshot) {
+    size_t elements_count = (size_t)solver.up.elements_count;
+    snapshot.up = solver.up;
+    snapshot.fit = std::move(fit);
+    snapshot.convergence = std::move(convergence);
+    if (!snapshot.fit.cancelled) {
+        // Changes of cancelled solves are kept by the solver, those of dropped snapshots are merged when publishing
+        snapshot.changed_begin = solver.take_changed_begin();
+        // The back snapshot is the worker's own, so it's filled without the lock (which the caller takes every frame)
+        // Storage is reused between snapshots of the same size
+        if (request.compact_snapshot) {
+            snapshot.compact.store(solver, request.compact);
+            std::vector<C_Element>().swap(snapshot.elements);
+        }
+        else {
+            snapshot.elements.assign(solver.elements, solver.elements + elements_count + 1);
+            snapshot.compact.forget();
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef SHADERBEAMS_SOLVERWORKER_H
+#define SHADERBEAMS_SOLVERWORKER_H
+
+#include "CompactSolution.h"
+#include "Convergence.h"
+#include "SolutionCache.h"
+#include "Solver.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Everything a background solve depends on
+struct C_SolveRequest {
+    C_UniformParams up {};
+    int precision = C_PRECISION_DOUBLE;
+    // Per-element profiles (empty for uniform ones)
+    std::vector<C_float> EI_profile, weight_profile;
+    bool auto_fit_angle = true;
+    C_FitParams fp;
+    // Picks the elements count by mesh refinement (up.elements_count & the profiles are ignored then)
+    bool auto_elements = false;
+    C_ConvergenceParams cp;
+    // Publishes the solution as kept borders (C_SolveSnapshot::compact) instead of whole elements
+    bool compact_snapshot = false;
+    C_CompactParams compact;
+    // Takes problems solved before from the worker's cache (& keeps new solutions there), except for auto_elements ones
+    bool use_cache = false;
+};
+
+// Finished solve of a request
+struct C_SolveSnapshot {
+    uint64_t generation = 0;
+    // Request's up, with the fitted angle (& the picked elements count)
+    C_UniformParams up {};
+    C_FitResult fit;
+    // Levels of the mesh refinement (none unless auto_elements was requested)
+    C_ConvergenceResult convergence;
+    // Either whole elements, or (for compact_snapshot requests) their kept borders
+    std::vector<C_Element> elements;
+    C_CompactSolution compact;
+    // Elements before it are the same as in the previously taken snapshot (of the same elements count)
+    size_t changed_begin = 0;
+};
+
+// Solves requests on its own thread with its own solver, so that the caller never waits for a solve
+// Requests are coalesced (only the latest pending one is solved) & a new one cancels the solve in flight
+// Finished solves are published through a triple buffer: the worker always has a snapshot to fill,
+// & the caller keeps reading the one it took until it takes another
+class C_SolverWorker {
+public:
+    C_SolverWorker();
+
+    C_SolverWorker(const C_SolverWorker&) = delete;
+    C_SolverWorker& operator=(const C_SolverWorker&) = delete;
+
+    ~C_SolverWorker();
+
+    // Replaces the pending request (if any) & returns the generation its snapshot will have
+    uint64_t submit(C_SolveRequest request);
+
+    // Drops the pending request, the solve in flight & the snapshot not taken yet
+    void cancel_all();
+
+    // Latest snapshot published since the last call (nullptr if there's none)
+    // Stays valid until the next call
+    const C_SolveSnapshot* take();
+
+    // Whether a request is pending or being solved
+    [[nodiscard]] bool busy();
+
+    // Solutions of use_cache requests (may be configured at any time)
+    C_SolutionCache& cache() { return _cache; }
+
+private:
+    void worker_loop();
+
+    void internal_solve(const C_SolveRequest& request, C_SolveSnapshot& snapshot);
+
+    // Fills the snapshot from the solver's solution
+    void internal_publish(const C_SolveRequest& request, C_FitResult fit, C_ConvergenceResult convergence,
+                          C_SolveSnapshot& snapshot);
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable request_cv;
+    bool stopping = false;
+
+    C_SolveRequest pending;
+    bool has_pending = false;
+    uint64_t generation = 0;
+    bool solving = false;
+    std::atomic<bool> cancel {false};
+
+    // Used by the worker only
+    C_Solver solver;
+
+    C_SolutionCache _cache;
+
+    // Worker fills snapshots[back], the caller reads snapshots[front], snapshots[middle] holds the latest published one
+    C_SolveSnapshot snapshots[3];
+    int back = 0, middle = 1, front = 2;
+    bool middle_fresh = false;
+    // Lowest changed element of snapshots that were never taken
+    size_t dropped_changed_begin = SIZE_MAX;
+};
+
+
+#endif //SHADERBEAMS_SOLVERWORKER_H
@@ -0,0 +1,232 @@
+#include "Sweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+template<typename T>
+size_t axis_size(const std::vector<T>& axis) {
+    return axis.empty() ? 1 : axis.size();
+}
+
+template<typename T>
+T axis_at(const std::vector<T>& axis, size_t& i, T base_value) {
+    if (axis.empty()) {
+        return base_value;
+    }
+    T value = axis[i % axis.size()];
+    i /= axis.size();
+    return value;
+}
+
+size_t C_SweepGrid::size() const {
+    return axis_size(corr_selector) * axis_size(EI) * axis_size(total_weight)
+           * axis_size(total_length) * axis_size(elements_count);
+}
+
+C_UniformParams C_SweepGrid::at(size_t i) const {
+    C_UniformParams up = base;
+    up.elements_count = axis_at(elements_count, i, base.elements_count);
+    up.total_length = axis_at(total_length, i, base.total_length);
+    up.total_weight = axis_at(total_weight, i, base.total_weight);
+    up.EI = axis_at(EI, i, base.EI);
+    up.corr_selector = axis_at(corr_selector, i, base.corr_selector);
+    return up;
+}
+
+
+C_Sweep::C_Sweep(C_ThreadPool& new_pool) : pool(new_pool), workers(new_pool.size()) {
+}
+
+// End state of a problem whose traversal stopped at an unhealthy element (its end element holds an older one)
+static C_SolutionFull diverged_end() {
+    C_SolutionFull end {};
+    end.x = end.y = end.M = end.T = end.Fx = end.Fy = NAN;
+    end.tn.t[0] = end.tn.t[1] = end.tn.n[0] = end.tn.n[1] = NAN;
+    return end;
+}
+
+void C_Sweep::run(const C_SweepGrid& grid, bool fit, C_FitParams fp, const ResultCallback& on_result) {
+    std::vector<C_UniformParams> ups(grid.size());
+    for (size_t point_i = 0; point_i < ups.size(); ++point_i) {
+        ups[point_i] = grid.at(point_i);
+    }
+    run(ups, fit, fp, on_result);
+}
+
+void C_Sweep::run(const std::vector<C_UniformParams>& ups, bool fit, C_FitParams fp, const ResultCallback& on_result) {
+    if (use_lanes && C_BatchSolver::lanes > 1 && precision != C_PRECISION_MIXED) {
+        internal_run_lanes(ups, fit, fp, on_result);
+    }
+    else {
+        internal_run_points(ups, fit, fp, on_result);
+    }
+}
+
+void C_Sweep::internal_run_points(const std::vector<C_UniformParams>& ups, bool fit, C_FitParams fp, const ResultCallback& on_result) {
+    // One grid point per task: solve times vary a lot, so idle workers should steal single points
+    pool.parallel_for(0, ups.size(), 1, [&](size_t point_i, size_t worker_i) {
+        auto start = std::chrono::steady_clock::now();
+
+        C_Solver& solver = workers[worker_i].solver;
+        C_SweepResult result;
+        result.index = point_i;
+
+        solver.set_precision(precision);
+        solver.setup(ups[point_i]);
+        if (fit) {
+            result.fit = solver.fit_angle(fp);
+        }
+        else {
+            result.fit.traverse_status = solver.traverse(solver.up.elements_count);
+            result.fit.converged = result.fit.traverse_status.ok();
+            result.fit.iterations = 1;
+            result.fit.residual = result.fit.converged ? solver.end_deviation() : NAN;
+        }
+
+        result.up = solver.up;
+        result.end = result.fit.traverse_status.ok() ? solver.elements[solver.up.elements_count].full : diverged_end();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        on_result(result, solver);
+    });
+}
+
+void C_Sweep::internal_run_lanes(const std::vector<C_UniformParams>& ups, bool fit, C_FitParams fp, const ResultCallback& on_result) {
+    // Points can only share lanes if their traversals have the same shape
+    std::vector<size_t> order(ups.size());
+    for (size_t point_i = 0; point_i < order.size(); ++point_i) {
+        order[point_i] = point_i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (ups[a].corr_selector != ups[b].corr_selector) {
+            return ups[a].corr_selector < ups[b].corr_selector;
+        }
+        return ups[a].elements_count < ups[b].elements_count;
+    });
+
+    // Chunks of several lanes' worth of points of the same shape, so that lanes can be refilled within a chunk
+    const size_t chunk_size = 4 * (size_t)(precision == C_PRECISION_FLOAT ? C_BatchSolverFloat::lanes : C_BatchSolver::lanes);
+    std::vector<size_t> chunk_begins;
+    for (size_t order_i = 0; order_i < order.size(); ++order_i) {
+        if (chunk_begins.empty() || order_i - chunk_begins.back() == chunk_size) {
+            chunk_begins.push_back(order_i);
+            continue;
+        }
+        const C_UniformParams& up = ups[order[order_i]];
+        const C_UniformParams& up_first = ups[order[chunk_begins.back()]];
+        if (up.corr_selector != up_first.corr_selector || up.elements_count != up_first.elements_count) {
+            chunk_begins.push_back(order_i);
+        }
+    }
+    chunk_begins.push_back(order.size());
+
+    pool.parallel_for(0, chunk_begins.size() - 1, 1, [&](size_t chunk_i, size_t worker_i) {
+        Worker& worker = workers[worker_i];
+        size_t begin = chunk_begins[chunk_i], end = chunk_begins[chunk_i + 1];
+
+        // Float lanes only run the linear correction
+        if (precision == C_PRECISION_FLOAT && ups[order[begin]].corr_selector == 0) {
+            internal_run_chunk(worker.batch_float, worker.solver, order, ups, begin, end, fit, fp, on_result);
+        }
+        else {
+            internal_run_chunk(worker.batch, worker.solver, order, ups, begin, end, fit, fp, on_result);
+        }
+    });
+}
+
+template<typename Batch>
+void C_Sweep::internal_run_chunk(Batch& batch, C_Solver& solver, const std::vector<size_t>& order, const std::vector<C_UniformParams>& ups,
+                                 size_t next, size_t end, bool fit, C_FitParams fp, const ResultCallback& on_result) {
+    size_t lane_points[Batch::lanes];
+    std::chrono::steady_clock::time_point lane_starts[Batch::lanes];
+
+    auto report = [&](int lane, const C_FitResult& lane_fit) {
+        C_SweepResult result;
+        result.index = lane_points[lane];
+        result.up = batch.lane_params(lane);
+        result.fit = lane_fit;
+        result.end = lane_fit.traverse_status.ok() ? batch.get_element(lane, result.up.elements_count).full : diverged_end();
+        // Wall time of the lane (shared with the other lanes, so it's not comparable with the single-problem times)
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lane_starts[lane]).count();
+
+        if (export_solutions) {
+            batch.export_lane(lane, &solver);
+        }
+        on_result(result, solver);
+    };
+
+    if (fit) {
+        batch.fit_angle_stream(fp, [&](int lane, C_UniformParams& lane_up) {
+            if (next == end) {
+                return false;
+            }
+            lane_points[lane] = order[next++];
+            lane_starts[lane] = std::chrono::steady_clock::now();
+            lane_up = ups[lane_points[lane]];
+            return true;
+        }, report);
+        return;
+    }
+
+    // Without the fit, every problem takes exactly one traversal
+    while (next < end) {
+        int count = (int)std::min(end - next, (size_t)Batch::lanes);
+        C_UniformParams batch_ups[Batch::lanes];
+        for (int lane = 0; lane < count; ++lane) {
+            lane_points[lane] = order[next++];
+            lane_starts[lane] = std::chrono::steady_clock::now();
+            batch_ups[lane] = ups[lane_points[lane]];
+        }
+
+        batch.setup(batch_ups, count);
+        batch.traverse(0, batch_ups[0].elements_count);
+
+        for (int lane = 0; lane < count; ++lane) {
+            C_FitResult lane_fit;
+            lane_fit.traverse_status = batch.lane_status(lane);
+            lane_fit.converged = lane_fit.traverse_status.ok();
+            lane_fit.iterations = 1;
+            lane_fit.residual = lane_fit.converged ? batch.end_deviation(lane) : NAN;
+            report(lane, lane_fit);
+        }
+    }
+}
+
+
+C_SweepWriter::C_SweepWriter(const char* path) {
+    file = fopen(path, "w");
+    if (file == nullptr) {
+        return;
+    }
+
+    fprintf(file, "index,corr_selector,EI,total_weight,total_length,elements_count,"
+                  "initial_angle,converged,iterations,residual,"
+                  "x,y,M,T,Fx,Fy,seconds,diverged,diverged_element\n");
+    fflush(file);
+}
+
+C_SweepWriter::~C_SweepWriter() {
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+void C_SweepWriter::write(const C_SweepResult& result) {
+    if (file == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const C_TraverseStatus& status = result.fit.traverse_status;
+    fprintf(file, "%zu,%d,%.17g,%.17g,%.17g,%d,%.17g,%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.6g,%s,%zu\n",
+            result.index, result.up.corr_selector, (double)result.up.EI, (double)result.up.total_weight,
+            (double)result.up.total_length, result.up.elements_count,
+            (double)result.up.initial_angle, result.fit.converged ? 1 : 0, result.fit.iterations, (double)result.fit.residual,
+            (double)result.end.x, (double)result.end.y, (double)result.end.M, (double)result.end.T,
+            (double)result.end.Fx, (double)result.end.Fy, result.seconds,
+            status.ok() ? "" : C_traverse_reason_name(status.reason), status.ok() ? (size_t)0 : status.element_i);
+    // Results are made durable as they complete, so a long sweep can be inspected midway
+    fflush(file);
+}
@@ -0,0 +1,102 @@
+#ifndef SHADERBEAMS_SWEEP_H
+#define SHADERBEAMS_SWEEP_H
+
+#include "BatchSolver.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+
+// Cartesian product of parameter values
+// Empty axes keep the value from base
+#define C_SweepGrid_FIELDS base, corr_selector, EI, total_weight, total_length, elements_count
+struct C_SweepGrid {
+    C_UniformParams base {};
+    std::vector<int> corr_selector;
+    std::vector<C_float> EI;
+    std::vector<C_float> total_weight;
+    std::vector<C_float> total_length;
+    std::vector<int> elements_count;
+
+    [[nodiscard]] size_t size() const;
+
+    // Parameters of the i-th grid point (last axis varies fastest)
+    [[nodiscard]] C_UniformParams at(size_t i) const;
+};
+
+struct C_SweepResult {
+    size_t index = 0;
+    C_UniformParams up {};
+    C_FitResult fit;
+    C_SolutionFull end {};
+    double seconds = 0.0;
+};
+
+class C_Sweep {
+public:
+    // Called from the worker threads as soon as each grid point is solved
+    // solver holds the solution (if export_solutions) & is reused for the next grid point once the callback returns
+    using ResultCallback = std::function<void(const C_SweepResult& result, const C_Solver& solver)>;
+
+    explicit C_Sweep(C_ThreadPool& new_pool = C_ThreadPool::shared());
+
+    void run(const C_SweepGrid& grid, bool fit, C_FitParams fp, const ResultCallback& on_result);
+
+    // Same, for a list of problems (results are indexed into it)
+    void run(const std::vector<C_UniformParams>& ups, bool fit, C_FitParams fp, const ResultCallback& on_result);
+
+    // Solve grid points with matching corr_selector & elements_count together, one per vector lane
+    bool use_lanes = true;
+
+    // One of C_PRECISION_*: float lanes are twice as many, mixed precision solves each grid point on its own
+    int precision = C_PRECISION_DOUBLE;
+
+    // Whether the callback's solver must hold the solution (lanes' ones are copied into it, one per grid point)
+    bool export_solutions = true;
+
+private:
+    void internal_run_points(const std::vector<C_UniformParams>& ups, bool fit, C_FitParams fp, const ResultCallback& on_result);
+
+    void internal_run_lanes(const std::vector<C_UniformParams>& ups, bool fit, C_FitParams fp, const ResultCallback& on_result);
+
+    // Solves grid points order[next], ..., order[end - 1] (of the same shape) in the batch's lanes
+    template<typename Batch>
+    void internal_run_chunk(Batch& batch, C_Solver& solver, const std::vector<size_t>& order, const std::vector<C_UniformParams>& ups,
+                            size_t next, size_t end, bool fit, C_FitParams fp, const ResultCallback& on_result);
+
+    // Padded to a cache line, so that solvers of different workers don't share one
+    struct alignas(64) Worker {
+        C_Solver solver;
+        C_BatchSolver batch;
+        C_BatchSolverFloat batch_float;
+    };
+
+    C_ThreadPool& pool;
+    std::vector<Worker> workers;
+};
+
+// Appends results to a CSV file as they arrive (safe to call from several threads)
+class C_SweepWriter {
+public:
+    explicit C_SweepWriter(const char* path);
+
+    C_SweepWriter(const C_SweepWriter&) = delete;
+    C_SweepWriter& operator=(const C_SweepWriter&) = delete;
+
+    ~C_SweepWriter();
+
+    [[nodiscard]] bool is_open() const { return file != nullptr; }
+
+    void write(const C_SweepResult& result);
+
+private:
+    std::mutex mutex;
+    FILE* file = nullptr;
+};
+
+
+#endif //SHADERBEAMS_SWEEP_H
@@ -0,0 +1,146 @@
+#include "ThreadPool.h"
+
+
+namespace {
+    thread_local const C_ThreadPool* current_pool = nullptr;
+    thread_local size_t current_pool_worker = 0;
+}
+
+C_ThreadPool::C_ThreadPool(size_t threads_count) {
+    if (threads_count == 0) {
+        threads_count = std::thread::hardware_concurrency();
+    }
+    if (threads_count == 0) {
+        threads_count = 1;
+    }
+
+    for (size_t worker_i = 0; worker_i < threads_count; ++worker_i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t worker_i = 0; worker_i < threads_count; ++worker_i) {
+        workers.emplace_back(&C_ThreadPool::worker_loop, this, worker_i);
+    }
+}
+
+C_ThreadPool::~C_ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t C_ThreadPool::current_worker() const {
+    return (current_pool == this) ? current_pool_worker : size();
+}
+
+C_ThreadPool& C_ThreadPool::shared() {
+    static C_ThreadPool pool;
+    return pool;
+}
+
+void C_ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (begin >= end) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    // Nested call from a worker: waiting here could starve the pool, so just run it
+    size_t worker_i = current_worker();
+    if (worker_i < size()) {
+        for (size_t i = begin; i < end; ++i) {
+            fn(i, worker_i);
+        }
+        return;
+    }
+
+    size_t chunks_count = (end - begin + grain - 1) / grain;
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t chunks_left = chunks_count;
+
+    for (size_t chunk_i = 0; chunk_i < chunks_count; ++chunk_i) {
+        size_t chunk_begin = begin + chunk_i * grain;
+        size_t chunk_end = (chunk_begin + grain < end) ? chunk_begin + grain : end;
+
+        push(chunk_i % size(), [&, chunk_begin, chunk_end](size_t task_worker_i) {
+            for (size_t i = chunk_begin; i < chunk_end; ++i) {
+                fn(i, task_worker_i);
+            }
+
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--chunks_left == 0) {
+                done_cv.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&] { return chunks_left == 0; });
+}
+
+void C_ThreadPool::push(size_t worker_i, Task task) {
+    {
+        // Counter is raised under the sleep mutex (& before the task becomes visible),
+        // so that a worker can neither miss the wakeup nor take the counter below zero
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++queued;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[worker_i]->mutex);
+        queues[worker_i]->tasks.push_back(std::move(task));
+    }
+    sleep_cv.notify_one();
+}
+
+bool C_ThreadPool::try_pop(size_t worker_i, Task& task) {
+    {
+        Queue& own = *queues[worker_i];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        Queue& victim = *queues[(worker_i + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void C_ThreadPool::worker_loop(size_t worker_i) {
+    current_pool = this;
+    current_pool_worker = worker_i;
+
+    while (true) {
+        Task task;
+        if (try_pop(worker_i, task)) {
+            task(worker_i);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [&] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SHADERBEAMS_THREADPOOL_H
+#define SHADERBEAMS_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fixed set of worker threads, each owning a task queue
+// Workers pop from the back of their own queue & steal from the front of the others' when idle
+class C_ThreadPool {
+public:
+    // 0 means one worker per hardware thread
+    explicit C_ThreadPool(size_t threads_count = 0);
+
+    C_ThreadPool(const C_ThreadPool&) = delete;
+    C_ThreadPool& operator=(const C_ThreadPool&) = delete;
+
+    ~C_ThreadPool();
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+    // Calls fn(i, worker_i) for every i in [begin, end), in chunks of grain indices, & waits for all of them
+    // worker_i < size() identifies the calling worker, so it can be used to index per-thread state
+    // When called from one of the pool's own workers, runs inline on that worker
+    void parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // Index of the pool worker running the calling thread (or size() for outside threads)
+    [[nodiscard]] size_t current_worker() const;
+
+    // Process-wide pool sized to the hardware
+    static C_ThreadPool& shared();
+
+private:
+    using Task = std::function<void(size_t)>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(size_t worker_i, Task task);
+
+    bool try_pop(size_t worker_i, Task& task);
+
+    void worker_loop(size_t worker_i);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    std::atomic<size_t> queued {0};
+    bool stopping = false;
+};
+
+
+#endif //SHADERBEAMS_THREADPOOL_H
@@ -0,0 +1,483 @@
+#include "Continuation.h"
+#include "Convergence.h"
+#include "Solver.h"
+#include "SolutionCache.h"
+#include "SolutionFile.h"
+#include "Sweep.h"
+#include "ThreadPool.h"
+#include "offscreen_render.h"
+#include "solution_io.h"
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using json = nlohmann::json;
+
+// Of the --cache directory
+const size_t CACHE_DISK_BUDGET = (size_t)4 << 30;
+
+
+void print_usage() {
+    fprintf(stderr,
+            "Usage: BeamsBatch <input> <output> [options]\n"
+            "       BeamsBatch --sweep <grid> <results.csv> [options]\n"
+            "       BeamsBatch --path <input> <path.csv> --to <V> [options]\n"
+            "  <input>                 ShaderBeams problem file (same format as \"Load from file\")\n"
+            "  <output>                where to write the solved problem\n"
+            "                          (either may be a binary .bsol solution file instead)\n"
+            "  <grid>                  problem file with an additional \"sweep\" object of swept fields,\n"
+            "                          each is an array of values or {\"from\", \"to\", \"count\", \"log\"}\n"
+            "  <results.csv>           where to stream one line per solved grid point\n"
+            "  <path.csv>              where to write one line per point of the equilibrium path, traced by load stepping\n"
+            "Options:\n"
+            "  --max-iterations <N>    limit for the angle fit traversals (default: \"fit_max_iterations\" or 100)\n"
+            "  --segments <N>          also write each element sampled at N segments (\"solution_seg\")\n"
+            "  --tolerance <T>         double the elements (from the problem's count) until the estimated discretisation\n"
+            "                          error is within T, & write the levels & the extrapolated end (\"convergence\")\n"
+            "  --threads <N>           sweep worker threads (default: one per hardware thread)\n"
+            "  --shooting-chunks <N>   traverse long beams in N chunks solved in parallel (multiple shooting)\n"
+            "  --png <path>            also draw the solved beam to a PNG image\n"
+            "  --thumbnails <dir>      draw each solved grid point of a sweep to <dir>/<index>.png\n"
+            "  --image-size <N>        side of the images in pixels (default: 1024, or 256 for thumbnails)\n"
+            "  --precision <P>         double (default), float (twice the sweep lanes, exponential correction stays double)\n"
+            "                          or mixed (float elements chained in double)\n"
+            "  --parameter <P>         parameter the path is traced along: total_weight (default), EI or total_length\n"
+            "  --from <V>              where the path starts (default: the input's value)\n"
+            "  --to <V>                where the path ends\n"
+            "  --step <H>              first step of the path (default: 1/16 of it, adapted to the fit iterations)\n"
+            "  --cache <dir>           take problems solved before from <dir> (& keep new solutions there, up to 4 GiB)\n"
+            "  --verbose               print the deviation after each fit traversal\n");
+}
+
+struct BatchOptions {
+    int max_iterations = 0;
+    int segments_count = 0;
+    int threads_count = 0;
+    int shooting_chunks = 0;
+    C_float tolerance = 0.0;
+    const char* png_path = nullptr;
+    const char* thumbnails_dir = nullptr;
+    int image_size = 0;
+    // C_PRECISION_*, or -1 for the input's own (double for problem files)
+    int precision = -1;
+    // C_CONTINUATION_*, & the range (NAN for the input's own value)
+    int parameter = C_CONTINUATION_TOTAL_WEIGHT;
+    C_float path_from = NAN;
+    C_float path_to = NAN;
+    C_float path_step = 0.0;
+    const char* cache_dir = nullptr;
+    bool verbose = false;
+};
+
+// C_PRECISION_* by its name, or -1 for an unknown one
+int precision_from_name(const char* name) {
+    if (strcmp(name, "double") == 0) {
+        return C_PRECISION_DOUBLE;
+    }
+    if (strcmp(name, "float") == 0) {
+        return C_PRECISION_FLOAT;
+    }
+    if (strcmp(name, "mixed") == 0) {
+        return C_PRECISION_MIXED;
+    }
+    return -1;
+}
+
+// C_CONTINUATION_* by its name, or -1 for an unknown one
+int parameter_from_name(const char* name) {
+    if (strcmp(name, "total_weight") == 0) {
+        return C_CONTINUATION_TOTAL_WEIGHT;
+    }
+    if (strcmp(name, "EI") == 0) {
+        return C_CONTINUATION_EI;
+    }
+    if (strcmp(name, "total_length") == 0) {
+        return C_CONTINUATION_TOTAL_LENGTH;
+    }
+    return -1;
+}
+
+bool read_json(const char* path, json& j) {
+    std::ifstream i(path);
+    if (!i.is_open()) {
+        fprintf(stderr, "Error reading file '%s'!\n", path);
+        return false;
+    }
+    i >> j;
+    return true;
+}
+
+bool has_extension(const char* path, const char* extension) {
+    size_t path_length = strlen(path), extension_length = strlen(extension);
+    return path_length >= extension_length && strcmp(path + path_length - extension_length, extension) == 0;
+}
+
+C_FitParams fit_params_from_json(const json& sp_j, const BatchOptions& options) {
+    C_FitParams fp;
+    fp.threshold = sp_j.value("fit_threshold", fp.threshold);
+    fp.max_iterations = options.max_iterations > 0 ? options.max_iterations : sp_j.value("fit_max_iterations", fp.max_iterations);
+    fp.shooting_chunks = options.shooting_chunks;
+    return fp;
+}
+
+int run_single(const char* input_path, const char* output_path, const BatchOptions& options) {
+    json j;
+    C_Solver solver;
+
+    // Binary files are solved in place (the mapping is private, so the input isn't changed)
+    C_SolutionFile solution_file;
+    if (has_extension(input_path, ".bsol")) {
+        if (!solution_file.open(input_path)) {
+            fprintf(stderr, "Error reading solution file '%s'!\n", input_path);
+            return 1;
+        }
+        solution_file.attach(&solver);
+        if (options.precision >= 0 && options.precision != solver.precision()) {
+            solver.set_precision(options.precision);
+        }
+        j["solver_params"] = {
+            {"fit_threshold", solution_file.fit_params().threshold},
+            {"fit_max_iterations", solution_file.fit_params().max_iterations},
+        };
+    }
+    else {
+        // JSON files are streamed into the solver
+        std::ifstream i(input_path);
+        if (!i.is_open()) {
+            fprintf(stderr, "Error reading file '%s'!\n", input_path);
+            return 1;
+        }
+        solver.set_precision(options.precision >= 0 ? options.precision : C_PRECISION_DOUBLE);
+        solution_read_json(i, j, &solver);
+        if (!j.contains("problem")) {
+            fprintf(stderr, "Error reading problem from '%s'!\n", input_path);
+            return 1;
+        }
+    }
+
+    json sp_j = j.value("solver_params", json::object());
+    bool auto_fit_angle = sp_j.value("auto_fit_angle", true);
+    C_FitParams fp = fit_params_from_json(sp_j, options);
+
+    size_t elements_count = solver.up.elements_count;
+
+    // Solutions of the same problem & fit parameters are taken from the cache (mesh refinement isn't cached)
+    C_SolutionCache cache;
+    C_SolutionKey cache_key;
+    bool use_cache = options.cache_dir != nullptr && options.tolerance <= 0.0;
+    bool cached = false;
+
+    // Traverse & fit the angle until the right end hits the hinge
+    C_FitResult fit;
+    C_ConvergenceResult convergence;
+    if (use_cache) {
+        cache.set_memory_budget(0);
+        cache.set_disk_tier(options.cache_dir, CACHE_DISK_BUDGET);
+        cache_key = C_SolutionCache::key_of(solver, auto_fit_angle, fp);
+        cached = cache.load(cache_key, solver, fit);
+    }
+
+    if (cached) {
+        // Nothing to solve
+    }
+    else if (options.tolerance > 0.0) {
+        if (solver.has_EI_profile() || solver.has_weight_profile()) {
+            fprintf(stderr, "--tolerance needs a beam without per-element profiles!\n");
+            return 1;
+        }
+        C_ConvergenceParams cp;
+        cp.tolerance = options.tolerance;
+        cp.initial_elements_count = (int)elements_count;
+        convergence = C_converge_mesh(solver, solver.up, cp, auto_fit_angle, fp);
+        fit = convergence.last().fit;
+        elements_count = solver.up.elements_count;
+
+        for (size_t level_i = 0; level_i < convergence.levels.size(); ++level_i) {
+            const C_ConvergenceLevel& level = convergence.levels[level_i];
+            if (level_i == 0) {
+                printf("%d elements: %.3g s\n", level.elements_count, level.seconds);
+            }
+            else {
+                printf("%d elements: difference = %.3e, error = %.3e, %.3g s\n",
+                       level.elements_count, level.difference, level.error, level.seconds);
+            }
+        }
+        printf("order = %.3f, error %s the tolerance\n", convergence.order, convergence.converged ? "within" : "NOT within");
+    }
+    else if (auto_fit_angle) {
+        fit = solver.fit_angle(fp);
+    }
+    else if (fp.shooting_chunks > 0) {
+        C_ShootingParams shooting;
+        shooting.chunks_count = fp.shooting_chunks;
+        C_ShootingResult shot = solver.traverse_shooting(shooting);
+        fit.converged = shot.converged;
+        fit.traverse_status = shot.status;
+        fit.iterations = 1;
+        fit.residual = shot.status.ok() ? solver.end_deviation() : NAN;
+        fit.residual_history.push_back(fit.residual);
+    }
+    else {
+        fit.traverse_status = solver.traverse(elements_count);
+        fit.converged = fit.traverse_status.ok();
+        fit.iterations = 1;
+        fit.residual = fit.converged ? solver.end_deviation() : NAN;
+        fit.residual_history.push_back(fit.residual);
+    }
+
+    if (use_cache && !cached) {
+        cache.store(cache_key, solver, fit);
+    }
+
+    if (options.verbose) {
+        for (size_t iteration_i = 0; iteration_i < fit.residual_history.size(); ++iteration_i) {
+            printf("iteration %zu: deviation = % .6e\n", iteration_i + 1, fit.residual_history[iteration_i]);
+        }
+    }
+
+    if (has_extension(output_path, ".bsol")) {
+        if (!C_save_solution_file(output_path, solver, fp, &fit)) {
+            fprintf(stderr, "Error writing file '%s'!\n", output_path);
+            return 1;
+        }
+    }
+    else {
+        sp_j["solved"] = true;
+        sp_j["fit_deviation"] = fit.residual;
+        sp_j["fit_iterations"] = fit.iterations;
+        j["solver_params"] = sp_j;
+        if (!convergence.levels.empty()) {
+            j["convergence"] = convergence_to_json(convergence);
+        }
+
+        std::ofstream o(output_path);
+        if (!o.is_open()) {
+            fprintf(stderr, "Error writing file '%s'!\n", output_path);
+            return 1;
+        }
+        solution_write_json(o, j, &solver, options.segments_count);
+    }
+
+    if (options.png_path != nullptr) {
+        RenderParams rp;
+        rp.width = rp.height = options.image_size > 0 ? options.image_size : 1024;
+        rp.line_width = 2.0;
+        if (!render_png(options.png_path, solver, rp)) {
+            fprintf(stderr, "Error writing file '%s'!\n", options.png_path);
+            return 1;
+        }
+    }
+
+    printf("%s: %zu elements, %d iterations, theta = %.10g, deviation = %.3g%s%s\n",
+           input_path, elements_count, fit.iterations, solver.up.initial_angle, fit.residual,
+           fit.converged ? "" : " (fit did not converge)", cached ? " (cached)" : "");
+    if (!fit.traverse_status.ok()) {
+        printf("traversal diverged at element %zu (%s = %.3g)\n", fit.traverse_status.element_i,
+               C_traverse_reason_name(fit.traverse_status.reason), fit.traverse_status.value);
+    }
+
+    bool mesh_converged = options.tolerance <= 0.0 || convergence.converged;
+    return fit.converged && mesh_converged ? 0 : 2;
+}
+
+int run_sweep(const char* grid_path, const char* results_path, const BatchOptions& options) {
+    json j;
+    if (!read_json(grid_path, j)) {
+        return 1;
+    }
+
+    json sp_j = j.value("solver_params", json::object());
+    bool auto_fit_angle = sp_j.value("auto_fit_angle", true);
+    C_FitParams fp = fit_params_from_json(sp_j, options);
+    C_SweepGrid grid = sweep_grid_from_json(j);
+
+    C_SweepWriter writer(results_path);
+    if (!writer.is_open()) {
+        fprintf(stderr, "Error writing file '%s'!\n", results_path);
+        return 1;
+    }
+
+    C_ThreadPool pool((size_t)options.threads_count);
+    C_Sweep sweep(pool);
+    sweep.precision = options.precision >= 0 ? options.precision : C_PRECISION_DOUBLE;
+    // Solutions are only drawn as thumbnails
+    sweep.export_solutions = options.thumbnails_dir != nullptr;
+
+    RenderParams rp;
+    if (options.thumbnails_dir != nullptr) {
+        std::error_code error;
+        std::filesystem::create_directories(options.thumbnails_dir, error);
+        rp.width = rp.height = options.image_size > 0 ? options.image_size : 256;
+    }
+
+    std::atomic<size_t> solved_count {0}, failed_count {0}, diverged_count {0};
+    size_t points_count = grid.size();
+
+    sweep.run(grid, auto_fit_angle, fp, [&](const C_SweepResult& result, const C_Solver& solver) {
+        writer.write(result);
+        // Drawn on the sweep's own worker (the pool runs nested work inline), so images are parallel to each other
+        if (options.thumbnails_dir != nullptr) {
+            std::string path = std::string(options.thumbnails_dir) + "/" + std::to_string(result.index) + ".png";
+            if (!render_png(path.c_str(), solver, rp, &pool)) {
+                fprintf(stderr, "Error writing file '%s'!\n", path.c_str());
+            }
+        }
+        if (!result.fit.converged) {
+            ++failed_count;
+        }
+        if (!result.fit.traverse_status.ok()) {
+            ++diverged_count;
+        }
+        size_t solved = ++solved_count;
+        if (options.verbose) {
+            printf("%zu/%zu: point %zu, %d iterations, %.3g s\n", solved, points_count, result.index, result.fit.iterations, result.seconds);
+        }
+    });
+
+    printf("%s: %zu points on %zu threads, %zu did not converge (%zu diverged)\n",
+           grid_path, points_count, pool.size(), failed_count.load(), diverged_count.load());
+
+    return failed_count == 0 ? 0 : 2;
+}
+
+int run_path(const char* input_path, const char* path_csv, const BatchOptions& options) {
+    json j;
+    if (!read_json(input_path, j) || !j.contains("problem")) {
+        fprintf(stderr, "Error reading problem from '%s'!\n", input_path);
+        return 1;
+    }
+    if (std::isnan(options.path_to)) {
+        fprintf(stderr, "--path needs --to!\n");
+        return 1;
+    }
+
+    C_UniformParams up = j["problem"].get<C_UniformParams>();
+    json sp_j = j.value("solver_params", json::object());
+    C_FitParams fp = fit_params_from_json(sp_j, options);
+
+    C_ContinuationParams cp;
+    cp.parameter = options.parameter;
+    cp.begin = std::isnan(options.path_from) ? C_continuation_value(up, cp.parameter) : options.path_from;
+    cp.end = options.path_to;
+    cp.initial_step = options.path_step;
+
+    FILE* file = fopen(path_csv, "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Error writing file '%s'!\n", path_csv);
+        return 1;
+    }
+
+    C_Solver solver;
+    solver.set_precision(options.precision >= 0 ? options.precision : C_PRECISION_DOUBLE);
+    C_ContinuationResult result = C_continue_path(solver, up, cp, fp);
+
+    fprintf(file, "index,value,initial_angle,predicted_angle,converged,iterations,residual,x,y,M,T,Fx,Fy\n");
+    for (size_t point_i = 0; point_i < result.path.size(); ++point_i) {
+        const C_ContinuationPoint& point = result.path[point_i];
+        fprintf(file, "%zu,%.17g,%.17g,%.17g,%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+                point_i, point.value, point.initial_angle, point.predicted_angle, point.fit.converged ? 1 : 0,
+                point.fit.iterations, point.fit.residual,
+                point.end.x, point.end.y, point.end.M, point.end.T, point.end.Fx, point.end.Fy);
+        if (options.verbose) {
+            printf("%zu: %.6g, theta = %.10g (predicted %.10g), %d iterations\n",
+                   point_i, point.value, point.initial_angle, point.predicted_angle, point.fit.iterations);
+        }
+    }
+    fclose(file);
+
+    printf("%s: %zu points, %d traversals, %d rejected steps, %.3g s%s\n",
+           input_path, result.path.size(), result.traversals, result.rejected_steps, result.seconds,
+           result.completed ? "" : " (path did not reach the end)");
+
+    return result.completed ? 0 : 2;
+}
+
+int main(int argc, char** argv) {
+    bool sweep = argc > 1 && strcmp(argv[1], "--sweep") == 0;
+    bool path = argc > 1 && strcmp(argv[1], "--path") == 0;
+    int first_arg_i = sweep || path ? 2 : 1;
+
+    if (argc < first_arg_i + 2) {
+        print_usage();
+        return 1;
+    }
+
+    const char* input_path = argv[first_arg_i];
+    const char* output_path = argv[first_arg_i + 1];
+    BatchOptions options;
+
+    for (int arg_i = first_arg_i + 2; arg_i < argc; ++arg_i) {
+        if (strcmp(argv[arg_i], "--max-iterations") == 0 && arg_i + 1 < argc) {
+            options.max_iterations = atoi(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--segments") == 0 && arg_i + 1 < argc) {
+            options.segments_count = atoi(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--tolerance") == 0 && arg_i + 1 < argc) {
+            options.tolerance = atof(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--threads") == 0 && arg_i + 1 < argc) {
+            options.threads_count = atoi(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--shooting-chunks") == 0 && arg_i + 1 < argc) {
+            options.shooting_chunks = atoi(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--png") == 0 && arg_i + 1 < argc) {
+            options.png_path = argv[++arg_i];
+        }
+        else if (strcmp(argv[arg_i], "--thumbnails") == 0 && arg_i + 1 < argc) {
+            options.thumbnails_dir = argv[++arg_i];
+        }
+        else if (strcmp(argv[arg_i], "--image-size") == 0 && arg_i + 1 < argc) {
+            options.image_size = atoi(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--precision") == 0 && arg_i + 1 < argc) {
+            options.precision = precision_from_name(argv[++arg_i]);
+            if (options.precision < 0) {
+                print_usage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg_i], "--parameter") == 0 && arg_i + 1 < argc) {
+            options.parameter = parameter_from_name(argv[++arg_i]);
+            if (options.parameter < 0) {
+                print_usage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg_i], "--from") == 0 && arg_i + 1 < argc) {
+            options.path_from = atof(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--to") == 0 && arg_i + 1 < argc) {
+            options.path_to = atof(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--step") == 0 && arg_i + 1 < argc) {
+            options.path_step = atof(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--cache") == 0 && arg_i + 1 < argc) {
+            options.cache_dir = argv[++arg_i];
+        }
+        else if (strcmp(argv[arg_i], "--verbose") == 0) {
+            options.verbose = true;
+        }
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (sweep) {
+        return run_sweep(input_path, output_path, options);
+    }
+    if (path) {
+        return run_path(input_path, output_path, options);
+    }
+    return run_single(input_path, output_path, options);
+}
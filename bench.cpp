@@ -0,0 +1,400 @@
+#include "CompactSolution.h"
+#include "Solver.h"
+#include "SolutionFile.h"
+#include "solution_io.h"
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using json = nlohmann::json;
+
+
+void print_usage() {
+    fprintf(stderr,
+            "Usage: SolverBench [options]\n"
+            "Times the solver's kernels & data paths, writing one CSV line per benchmark\n"
+            "Options:\n"
+            "  --output <results.csv>  where to write the results (default: standard output)\n"
+            "  --repetitions <N>       timed repetitions of each benchmark (default: 5)\n"
+            "  --max-elements <N>      largest beam to traverse (default: 10000000, sizes go up by 10x from 10)\n"
+            "  --max-file-elements <N> largest beam to save & load (default: 100000)\n"
+            "  --scratch <path>        file used by the save & load benchmarks (default: SolverBench.tmp)\n"
+            "  --filter <text>         only run the benchmarks whose names contain it\n");
+}
+
+struct BenchOptions {
+    const char* output_path = nullptr;
+    int repetitions = 5;
+    size_t max_elements = 10000000;
+    size_t max_file_elements = 100000;
+    std::string scratch_path = "SolverBench.tmp";
+    const char* filter = nullptr;
+};
+
+// Peak resident set size of the process so far, in KiB
+long peak_rss_kb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Keeps results alive, so that the timed code isn't optimized away
+volatile C_float sink;
+
+void consume(const C_Element& el) {
+    sink = el.full.x + el.full.y + el.corr.u;
+}
+
+class BenchRunner {
+public:
+    BenchRunner(FILE* new_output, const BenchOptions& new_options) : output(new_output), options(new_options) {
+        fprintf(output, "benchmark,elements,repetitions,items,ns_per_item,ns_per_item_stddev,ns_per_item_min,"
+                        "items_per_second,peak_rss_kb\n");
+    }
+
+    [[nodiscard]] bool enabled(const char* name) const {
+        return options.filter == nullptr || strstr(name, options.filter) != nullptr;
+    }
+
+    // Times body (which processes items items) once per repetition, after an untimed warm-up run
+    // Short bodies are repeated within a repetition until it lasts long enough to be timed reliably
+    void run(const char* name, size_t elements_count, size_t items, const std::function<void()>& body,
+             const std::function<void()>& before_each = nullptr) {
+        if (!enabled(name)) {
+            return;
+        }
+
+        if (before_each) {
+            before_each();
+        }
+        auto warm_up_start = std::chrono::steady_clock::now();
+        body();
+        double warm_up_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - warm_up_start).count();
+
+        const double min_seconds = 0.05;
+        size_t calls = 1;
+        if (warm_up_seconds < min_seconds) {
+            calls = (size_t)std::ceil(min_seconds / std::max(warm_up_seconds, 1e-9));
+        }
+
+        std::vector<double> ns_per_item(options.repetitions);
+        for (int repetition_i = 0; repetition_i < options.repetitions; ++repetition_i) {
+            double seconds = 0.0;
+            for (size_t call_i = 0; call_i < calls; ++call_i) {
+                // Preparation (e.g. marking the elements dirty) is left out of the timing
+                if (before_each) {
+                    before_each();
+                }
+                auto start = std::chrono::steady_clock::now();
+                body();
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            ns_per_item[repetition_i] = seconds * 1e9 / ((double)calls * (double)items);
+        }
+
+        double mean = 0.0;
+        for (double value : ns_per_item) {
+            mean += value;
+        }
+        mean /= (double)ns_per_item.size();
+        double variance = 0.0;
+        for (double value : ns_per_item) {
+            variance += (value - mean) * (value - mean);
+        }
+        variance /= ns_per_item.size() > 1 ? (double)(ns_per_item.size() - 1) : 1.0;
+        double min = *std::min_element(ns_per_item.begin(), ns_per_item.end());
+
+        fprintf(output, "%s,%zu,%d,%zu,%.6g,%.6g,%.6g,%.6g,%ld\n",
+                name, elements_count, options.repetitions, items, mean, std::sqrt(variance), min,
+                1e9 / mean, peak_rss_kb());
+        fflush(output);
+        fprintf(stderr, "%-24s %10zu elements: %10.4g ns/item\n", name, elements_count, mean);
+    }
+
+private:
+    FILE* output;
+    const BenchOptions& options;
+};
+
+C_UniformParams bench_params(int corr_selector, size_t elements_count) {
+    C_UniformParams up {};
+    up.corr_selector = corr_selector;
+    up.EI = 1000.0;
+    up.initial_angle = -1.37;
+    up.total_weight = 1256.6370614359173;
+    up.total_length = 10.0;
+    up.gap = 6.0;
+    up.elements_count = (int)elements_count;
+    return up;
+}
+
+// Per-call cost of the correction formulae, on a mid-beam element of a solved beam
+void bench_kernels(BenchRunner& runner) {
+    const size_t elements_count = 100;
+    const size_t calls = 4096;
+
+    for (int corr_selector = 0; corr_selector < 2; ++corr_selector) {
+        const char* name = corr_selector == 0 ? "link_corr_linear" : "link_corr_exponential";
+        if (!runner.enabled(name)) {
+            continue;
+        }
+
+        C_Solver solver;
+        solver.setup(bench_params(corr_selector, elements_count));
+        solver.traverse(elements_count);
+
+        C_UniformParams up = solver.up;
+        C_float each_length = up.total_length / (C_float)elements_count;
+        C_SolutionFull full0 = solver.elements[elements_count / 2].full;
+        C_SolutionBase base0 = C_EQLINK_setup_base(up, full0);
+        C_SolutionCorr corr0 = C_EQLINK_setup_corr(up, full0, base0);
+
+        runner.run(name, 1, calls, [&]() {
+            C_float acc = 0.0;
+            for (size_t call_i = 0; call_i < calls; ++call_i) {
+                // Positions vary, so that the calls can't be hoisted out of the loop
+                C_float s = each_length * (C_float)(call_i + 1) / (C_float)calls;
+                C_SolutionCorr corr = corr_selector == 0 ? C_EQLINK_link_corr_linear(up, full0, base0, corr0, s)
+                                                         : C_EQLINK_link_corr_exponential(up, full0, base0, corr0, s);
+                acc += corr.u + corr.M;
+            }
+            sink = acc;
+        });
+    }
+}
+
+// Whole-beam traversals (every element re-solved each time)
+void bench_traverse(BenchRunner& runner, const BenchOptions& options) {
+    for (int corr_selector = 0; corr_selector < 2; ++corr_selector) {
+        const char* name = corr_selector == 0 ? "traverse_linear" : "traverse_exponential";
+        if (!runner.enabled(name)) {
+            continue;
+        }
+
+        for (size_t elements_count = 10; elements_count <= options.max_elements; elements_count *= 10) {
+            C_Solver solver;
+            solver.setup(bench_params(corr_selector, elements_count));
+
+            runner.run(name, elements_count, elements_count, [&]() {
+                solver.traverse(elements_count);
+                consume(solver.elements[elements_count]);
+            }, [&]() {
+                solver.mark_dirty(0);
+            });
+        }
+    }
+}
+
+// Sampling within elements: one position at a time, & many at once (lane-batched & threaded)
+void bench_sampling(BenchRunner& runner) {
+    const size_t elements_count = 1000;
+    const size_t samples_count = 1024;
+
+    C_Solver solver;
+    solver.setup(bench_params(0, elements_count));
+    solver.traverse(elements_count);
+    C_float each_length = solver.up.total_length / (C_float)elements_count;
+
+    std::vector<C_float> s(samples_count);
+    for (size_t sample_i = 0; sample_i < samples_count; ++sample_i) {
+        s[sample_i] = each_length * (C_float)sample_i / (C_float)(samples_count - 1);
+    }
+    std::vector<C_Element> samples(samples_count);
+
+    runner.run("get_solution_at", elements_count, samples_count, [&]() {
+        for (size_t sample_i = 0; sample_i < samples_count; ++sample_i) {
+            samples[sample_i] = solver.get_solution_at(sample_i % elements_count, s[sample_i]);
+        }
+        consume(samples.back());
+    });
+
+    runner.run("sample", elements_count, samples_count, [&]() {
+        solver.sample(elements_count / 2, s.data(), samples_count, samples.data());
+        consume(samples.back());
+    });
+}
+
+// Conversion of the elements to the GPU's (float) layout, as done before each upload to the shaders
+// GLSL_Element mirrors C_ElementT<float>, which keeps the benchmark free of any GL dependencies
+void bench_gpu_conversion(BenchRunner& runner) {
+    const size_t elements_count = 100000;
+    if (!runner.enabled("C2GLSL_Element")) {
+        return;
+    }
+
+    C_Solver solver;
+    solver.setup(bench_params(0, elements_count));
+    solver.traverse(elements_count);
+    std::vector<C_ElementT<float>> gpu_elements(elements_count + 1);
+
+    runner.run("C2GLSL_Element", elements_count, elements_count + 1, [&]() {
+        for (size_t element_i = 0; element_i <= elements_count; ++element_i) {
+            gpu_elements[element_i] = C_convert<float>(solver.elements[element_i]);
+        }
+        sink = gpu_elements[elements_count].full.x;
+    });
+}
+
+// Compact storage: traversals keeping every 4th border, & elements recomputed from them (as uploaded to the shaders)
+void bench_compact(BenchRunner& runner, const BenchOptions& options) {
+    C_CompactParams cp;
+    cp.stride = 4;
+
+    for (size_t elements_count = 10; elements_count <= options.max_elements; elements_count *= 10) {
+        C_CompactSolution compact;
+        runner.run("compact_traverse", elements_count, elements_count, [&]() {
+            compact.solve(bench_params(0, elements_count), cp, false, C_FitParams());
+            sink = compact.end_deviation();
+        });
+    }
+
+    const size_t elements_count = 100000;
+    if (!runner.enabled("compact_expand")) {
+        return;
+    }
+    C_CompactSolution compact;
+    compact.solve(bench_params(0, elements_count), cp, false, C_FitParams());
+    std::vector<C_Element> elements(elements_count + 1);
+    runner.run("compact_expand", elements_count, elements_count + 1, [&]() {
+        compact.expand(0, elements_count + 1, elements.data());
+        consume(elements[elements_count / 2]);
+    });
+    fprintf(stderr, "compact storage: %.1f bytes per element (elements take %zu)\n",
+            (double)compact.memory_bytes() / (double)(elements_count + 1), sizeof(C_Element));
+}
+
+// Saving & loading solved beams, as JSON (streamed) & as binary files
+void bench_files(BenchRunner& runner, const BenchOptions& options) {
+    std::string json_path = options.scratch_path + ".json";
+    std::string bsol_path = options.scratch_path + ".bsol";
+
+    for (size_t elements_count = 10; elements_count <= options.max_file_elements; elements_count *= 10) {
+        C_Solver solver;
+        solver.setup(bench_params(0, elements_count));
+        solver.traverse(elements_count);
+        json j;
+
+        runner.run("json_save", elements_count, elements_count + 1, [&]() {
+            std::ofstream o(json_path);
+            solution_write_json(o, j, &solver);
+        });
+
+        runner.run("json_load", elements_count, elements_count + 1, [&]() {
+            C_Solver loaded;
+            json loaded_j;
+            std::ifstream i(json_path);
+            solution_read_json(i, loaded_j, &loaded);
+            consume(loaded.elements[elements_count]);
+        }, [&]() {
+            // Loads need a saved file, even if saves were filtered out
+            if (!runner.enabled("json_save")) {
+                std::ofstream o(json_path);
+                solution_write_json(o, j, &solver);
+            }
+        });
+
+        runner.run("bsol_save", elements_count, elements_count + 1, [&]() {
+            C_save_solution_file(bsol_path.c_str(), solver, C_FitParams(), nullptr);
+        });
+
+        runner.run("bsol_load", elements_count, elements_count + 1, [&]() {
+            C_SolutionFile file;
+            C_Solver loaded;
+            if (file.open(bsol_path.c_str())) {
+                file.attach(&loaded);
+                consume(loaded.elements[elements_count]);
+                loaded.forget();
+            }
+        }, [&]() {
+            if (!runner.enabled("bsol_save")) {
+                C_save_solution_file(bsol_path.c_str(), solver, C_FitParams(), nullptr);
+            }
+        });
+    }
+
+    remove(json_path.c_str());
+    remove(bsol_path.c_str());
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+
+    for (int arg_i = 1; arg_i < argc; ++arg_i) {
+        if (strcmp(argv[arg_i], "--output") == 0 && arg_i + 1 < argc) {
+            options.output_path = argv[++arg_i];
+        }
+        else if (strcmp(argv[arg_i], "--repetitions") == 0 && arg_i + 1 < argc) {
+            options.repetitions = std::max(1, atoi(argv[++arg_i]));
+        }
+        else if (strcmp(argv[arg_i], "--max-elements") == 0 && arg_i + 1 < argc) {
+            options.max_elements = (size_t)atoll(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--max-file-elements") == 0 && arg_i + 1 < argc) {
+            options.max_file_elements = (size_t)atoll(argv[++arg_i]);
+        }
+        else if (strcmp(argv[arg_i], "--scratch") == 0 && arg_i + 1 < argc) {
+            options.scratch_path = argv[++arg_i];
+        }
+        else if (strcmp(argv[arg_i], "--filter") == 0 && arg_i + 1 < argc) {
+            options.filter = argv[++arg_i];
+        }
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    FILE* output = stdout;
+    if (options.output_path != nullptr) {
+        output = fopen(options.output_path, "w");
+        if (output == nullptr) {
+            fprintf(stderr, "Error writing file '%s'!\n", options.output_path);
+            return 1;
+        }
+    }
+
+    BenchRunner runner(output, options);
+    bench_kernels(runner);
+    bench_traverse(runner, options);
+    bench_sampling(runner);
+    bench_gpu_conversion(runner);
+    bench_compact(runner, options);
+    bench_files(runner, options);
+
+    if (output != stdout) {
+        fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "frame_trace.h"
+
+#include <imgui.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+FrameTrace& frame_trace() {
+    static FrameTrace trace;
+    return trace;
+}
+
+void FrameTrace::begin_frame() {
+    if (!enabled) {
+        return;
+    }
+
+    // Events' storage is reused, so steady frames don't allocate
+    Frame& frame = frames[frames_count % KEPT_FRAMES];
+    frame.events.clear();
+    frame.start_ns = now_ns();
+    in_frame = true;
+}
+
+void FrameTrace::end_frame() {
+    // Frames are only finished if they were begun while enabled
+    if (!in_frame) {
+        return;
+    }
+    in_frame = false;
+
+    Frame& frame = frames[frames_count % KEPT_FRAMES];
+    frame.end_ns = now_ns();
+    ++frames_count;
+
+    internal_scope("Frame").frame_ms += (float)(frame.end_ns - frame.start_ns) * 1e-6f;
+    for (ScopeHistory& scope : scopes) {
+        scope.history[history_offset] = scope.frame_ms;
+        scope.frame_ms = 0.0f;
+    }
+    history_offset = (history_offset + 1) % HISTORY_FRAMES;
+}
+
+void FrameTrace::record(const char* name, int64_t start_ns, int64_t end_ns) {
+    if (!in_frame) {
+        return;
+    }
+
+    frames[frames_count % KEPT_FRAMES].events.push_back({name, start_ns, end_ns});
+    ScopeHistory& scope = internal_scope(name);
+    scope.frame_ms += (float)(end_ns - start_ns) * 1e-6f;
+}
+
+FrameTrace::ScopeHistory& FrameTrace::internal_scope(const char* name) {
+    // There are few scopes, & their names are mostly told apart by pointer (the same literal may still differ between files)
+    for (ScopeHistory& scope : scopes) {
+        if (scope.name == name || strcmp(scope.name, name) == 0) {
+            return scope;
+        }
+    }
+    scopes.push_back(ScopeHistory {name});
+    return scopes.back();
+}
+
+bool FrameTrace::dump(const char* path, int frames_count_to_dump) const {
+    // The current frame's slot is the oldest kept one's
+    int64_t kept_count = std::min<int64_t>(frames_count, KEPT_FRAMES - 1);
+    int64_t dump_count = std::min<int64_t>(kept_count, frames_count_to_dump);
+    if (dump_count <= 0) {
+        return false;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    // Complete ("X") events in microseconds from the first dumped frame, nesting is implied by their times
+    int64_t first_frame_i = frames_count - dump_count;
+    int64_t origin_ns = frames[first_frame_i % KEPT_FRAMES].start_ns;
+    auto write_event = [&](const char* name, int64_t start_ns, int64_t end_ns) {
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                name, (double)(start_ns - origin_ns) * 1e-3, (double)(end_ns - start_ns) * 1e-3);
+    };
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    fprintf(file, "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+    for (int64_t frame_i = first_frame_i; frame_i < frames_count; ++frame_i) {
+        const Frame& frame = frames[frame_i % KEPT_FRAMES];
+        write_event("Frame", frame.start_ns, frame.end_ns);
+        for (const Event& event : frame.events) {
+            write_event(event.name, event.start_ns, event.end_ns);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
+
+void FrameTrace::process_gui() {
+    if (!ImGui::CollapsingHeader("Tracing")) {
+        return;
+    }
+
+    ImGui::Checkbox("Trace frames", &enabled);
+
+    ImGui::SliderInt("Frames to dump", &dump_frames_count, 1, KEPT_FRAMES);
+    if (ImGui::Button("Dump frames")) {
+        if (dump(dump_path.c_str(), dump_frames_count)) {
+            fprintf(stderr, "Trace of %d frames written to '%s'\n", dump_frames_count, dump_path.c_str());
+        }
+        else {
+            fprintf(stderr, "Error writing trace to '%s'!\n", dump_path.c_str());
+        }
+    }
+
+    // Histograms start from the oldest frame
+    for (ScopeHistory& scope : scopes) {
+        float max_ms = 0.0f, total_ms = 0.0f;
+        for (float ms : scope.history) {
+            max_ms = std::max(max_ms, ms);
+            total_ms += ms;
+        }
+
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "avg %.3f ms, max %.3f ms", total_ms / HISTORY_FRAMES, max_ms);
+        ImGui::PlotHistogram(scope.name, scope.history, HISTORY_FRAMES, history_offset, overlay,
+                             0.0f, max_ms > 0.0f ? max_ms : 1.0f, ImVec2(0, 40));
+    }
+}
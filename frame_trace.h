@@ -0,0 +1,102 @@
+#ifndef SHADERBEAMS_FRAME_TRACE_H
+#define SHADERBEAMS_FRAME_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Per-frame timings of the GUI's main loop (main thread only)
+// Scopes are timed with TRACE_SCOPE("name") (a string literal, it's kept by pointer) & collected per frame
+// Times are the CPU's (GL calls may return before the GPU is done with them)
+// While disabled, a scope costs a single flag check
+class FrameTrace {
+public:
+    // Frames kept for dumping, & frames shown in the histograms
+    static const int KEPT_FRAMES = 600;
+    static const int HISTORY_FRAMES = 120;
+
+    static inline bool enabled = false;
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void begin_frame();
+
+    void end_frame();
+
+    void record(const char* name, int64_t start_ns, int64_t end_ns);
+
+    // Writes the last frames_count kept frames in Chrome's trace_event format (chrome://tracing, Perfetto)
+    bool dump(const char* path, int frames_count) const;
+
+    // Toggle, per-scope histograms of the last frames & the dump action
+    void process_gui();
+
+private:
+    struct Event {
+        const char* name;
+        int64_t start_ns, end_ns;
+    };
+
+    struct Frame {
+        int64_t start_ns = 0, end_ns = 0;
+        std::vector<Event> events;
+    };
+
+    // Milliseconds spent in a scope in each of the last frames (several calls are added up)
+    struct ScopeHistory {
+        const char* name;
+        float history[HISTORY_FRAMES] {};
+        float frame_ms = 0.0f;
+    };
+
+    ScopeHistory& internal_scope(const char* name);
+
+    Frame frames[KEPT_FRAMES];
+    // Frames recorded so far (the current one is frames[frames_count % KEPT_FRAMES])
+    int64_t frames_count = 0;
+    bool in_frame = false;
+
+    std::vector<ScopeHistory> scopes;
+    int history_offset = 0;
+
+    int dump_frames_count = 120;
+    std::string dump_path = "trace.json";
+};
+
+FrameTrace& frame_trace();
+
+// Times the enclosing scope into frame_trace() (if enabled when the scope was entered)
+class TraceScope {
+public:
+    explicit TraceScope(const char* new_name) : name(new_name) {
+        if (FrameTrace::enabled) {
+            start_ns = FrameTrace::now_ns();
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope() {
+        if (start_ns >= 0) {
+            frame_trace().record(name, start_ns, FrameTrace::now_ns());
+        }
+    }
+
+private:
+    const char* name;
+    int64_t start_ns = -1;
+};
+
+#define TRACE_SCOPE_CONCAT_(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_CONCAT(trace_scope_, __LINE__)(name)
+
+
+#endif //SHADERBEAMS_FRAME_TRACE_H
@@ -4,6 +4,7 @@
 #include <imgui-SFML.h>
 
 #include "shader_drawer.h"
+#include "frame_trace.h"
 
 
 int main() {
@@ -29,45 +30,67 @@ int main() {
 
     sf::Clock deltaClock;
     while (sd.running) {
+        frame_trace().begin_frame();
 
         // Check all the window's events that were triggered since the last iteration of the loop
-        sf::Event event{};
-        while (window.pollEvent(event)) {
+        {
+            TRACE_SCOPE("Events");
+            sf::Event event{};
+            while (window.pollEvent(event)) {
 
-            // Pass events to ImGui
-            ImGui::SFML::ProcessEvent(window, event);
+                // Pass events to ImGui
+                ImGui::SFML::ProcessEvent(window, event);
 
-            // "Close requested" event: we close the window
-            if (event.type == sf::Event::Closed)
-                sd.running = false;
-            // Window was resized
-            else if (event.type == sf::Event::Resized)
-                glViewport(0, 0, (GLsizei) event.size.width, (GLsizei) event.size.height);
+                // "Close requested" event: we close the window
+                if (event.type == sf::Event::Closed)
+                    sd.running = false;
+                // Window was resized
+                else if (event.type == sf::Event::Resized)
+                    glViewport(0, 0, (GLsizei) event.size.width, (GLsizei) event.size.height);
 
-            sd.process_event(event);
+                sd.process_event(event);
 
+            }
         }
 
         // Pass mouse & display_size & time to ImGui
-        ImGui::SFML::Update(window, deltaClock.restart());
+        {
+            TRACE_SCOPE("ImGui::SFML::Update");
+            ImGui::SFML::Update(window, deltaClock.restart());
+        }
 
         // Process ImGui & generate draw lists
         // Also calculate the solution
-        sd.process_gui();
+        {
+            TRACE_SCOPE("ShaderDrawer::process_gui");
+            sd.process_gui();
+        }
 
         // Clear the window with black color
         window.clear(sf::Color::Black);
 
         // Draw frame
-        window.setActive(true);
-        sd.draw();
-        window.setActive(false);
+        {
+            TRACE_SCOPE("ShaderDrawer::draw");
+            window.setActive(true);
+            sd.draw();
+            window.setActive(false);
+        }
 
         // Draw ImGui lists
-        ImGui::SFML::Render(window);
+        {
+            TRACE_SCOPE("ImGui::SFML::Render");
+            ImGui::SFML::Render(window);
+        }
 
         // End the current frame (swap buffers)
-        window.display();
+        // Includes waiting for the vertical sync
+        {
+            TRACE_SCOPE("display");
+            window.display();
+        }
+
+        frame_trace().end_frame();
     }
 
     // Shutdown ImGui
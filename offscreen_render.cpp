@@ -0,0 +1,481 @@
+#include "offscreen_render.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+// Rows of pixels drawn together by one task
+static const int TILE_ROWS = 32;
+
+// Grid lines closer than this (in pixels) are left out
+static const C_float MIN_GRID_SPACING_PX = 4.0;
+
+Rgb beam_color(size_t beam_i) {
+    static const Rgb colors[] = { {214, 39, 40}, {31, 119, 180}, {44, 160, 44}, {255, 127, 14}, {148, 103, 189}, {140, 86, 75} };
+    return colors[beam_i % (sizeof(colors) / sizeof(colors[0]))];
+}
+
+Polyline beam_polyline(const C_Solver& solver, const RenderParams& rp, Rgb color, C_ThreadPool* pool) {
+    int max_samples = rp.max_samples > 0 ? rp.max_samples : 2 * std::max(rp.width, rp.height);
+    size_t segments_count = std::min((size_t)solver.up.elements_count * (size_t)std::max(rp.samples_per_element, 1),
+                                     (size_t)std::max(max_samples, 1));
+
+    std::vector<C_float> positions(segments_count + 1);
+    for (size_t point_i = 0; point_i <= segments_count; ++point_i) {
+        positions[point_i] = solver.up.total_length * (C_float)point_i / (C_float)segments_count;
+    }
+    std::vector<C_Element> samples(positions.size());
+    solver.sample(positions.data(), positions.size(), samples.data(), pool);
+
+    Polyline polyline;
+    polyline.color = color;
+    polyline.points.reserve(samples.size());
+    for (const C_Element& sample : samples) {
+        polyline.points.push_back({sample.full.x, sample.full.y});
+    }
+    return polyline;
+}
+
+
+// Maps units to pixels (y up, pixel centres at integer + 0.5)
+struct View {
+    C_float center_x, center_y;
+    C_float pixels_per_unit;
+    C_float half_width, half_height;
+
+    [[nodiscard]] std::array<C_float, 2> to_pixels(const std::array<C_float, 2>& point) const {
+        return { half_width + (point[0] - center_x) * pixels_per_unit, half_height - (point[1] - center_y) * pixels_per_unit };
+    }
+
+    [[nodiscard]] C_float to_units_x(C_float x_px) const { return center_x + (x_px - half_width) / pixels_per_unit; }
+
+    [[nodiscard]] C_float to_units_y(C_float y_px) const { return center_y - (y_px - half_height) / pixels_per_unit; }
+};
+
+static View fit_view(const std::vector<Polyline>& polylines, const RenderParams& rp) {
+    View view {};
+    view.half_width = (C_float)rp.width / 2;
+    view.half_height = (C_float)rp.height / 2;
+    C_float half_size = std::max(view.half_width, view.half_height);
+
+    if (rp.view_size > 0.0) {
+        view.center_x = rp.look_at[0];
+        view.center_y = rp.look_at[1];
+        view.pixels_per_unit = half_size / rp.view_size;
+        return view;
+    }
+
+    C_float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    for (const Polyline& polyline : polylines) {
+        for (const auto& point : polyline.points) {
+            if (std::isfinite(point[0]) && std::isfinite(point[1])) {
+                min_x = std::min(min_x, point[0]);
+                max_x = std::max(max_x, point[0]);
+                min_y = std::min(min_y, point[1]);
+                max_y = std::max(max_y, point[1]);
+            }
+        }
+    }
+    if (min_x > max_x) {
+        min_x = max_x = min_y = max_y = 0.0;
+    }
+
+    view.center_x = (min_x + max_x) / 2;
+    view.center_y = (min_y + max_y) / 2;
+    C_float usable = std::max(1.0 - 2.0 * rp.margin, 0.1);
+    C_float extent = std::max((max_x - min_x) / (2 * view.half_width), (max_y - min_y) / (2 * view.half_height));
+    view.pixels_per_unit = extent > 0.0 ? usable / extent : half_size;
+    return view;
+}
+
+// Rows [begin_y, end_y) of the image, with a coverage buffer for the line being drawn
+struct Tile {
+    Image& image;
+    int begin_y, end_y;
+    std::vector<float> coverage;
+    // Part of the coverage buffer written since the last composite: [min_x, max_x] x [min_y, max_y]
+    int min_x, max_x, min_y, max_y;
+
+    Tile(Image& new_image, int new_begin_y, int new_end_y)
+            : image(new_image), begin_y(new_begin_y), end_y(new_end_y),
+              coverage((size_t)new_image.width * (new_end_y - new_begin_y), 0.0f) {
+        reset_bounds();
+    }
+
+    void reset_bounds() {
+        min_x = image.width;
+        max_x = -1;
+        min_y = end_y;
+        max_y = begin_y - 1;
+    }
+
+    // Coverage of a pixel is the share of it within the line (approximated from the distance of its centre),
+    // maxed over the line's segments, so that their joints aren't drawn twice
+    void add_segment(const std::array<C_float, 2>& a, const std::array<C_float, 2>& b, C_float half_width) {
+        if (!std::isfinite(a[0]) || !std::isfinite(a[1]) || !std::isfinite(b[0]) || !std::isfinite(b[1])) {
+            return;
+        }
+        C_float reach = half_width + 1.0;
+        C_float seg_min_x = std::min(a[0], b[0]) - reach, seg_max_x = std::max(a[0], b[0]) + reach;
+        C_float seg_min_y = std::min(a[1], b[1]) - reach, seg_max_y = std::max(a[1], b[1]) + reach;
+        if (seg_max_x < 0.0 || seg_min_x > image.width || seg_max_y < begin_y || seg_min_y > end_y) {
+            return;
+        }
+        int x0 = (int)std::max(floor(seg_min_x), 0.0), x1 = (int)std::min(ceil(seg_max_x), (C_float)image.width - 1);
+        int y0 = (int)std::max(floor(seg_min_y), (C_float)begin_y), y1 = (int)std::min(ceil(seg_max_y), (C_float)end_y - 1);
+
+        C_float dx = b[0] - a[0], dy = b[1] - a[1];
+        C_float length_sq = dx * dx + dy * dy;
+        for (int y = y0; y <= y1; ++y) {
+            float* coverage_row = coverage.data() + (size_t)(y - begin_y) * image.width;
+            C_float py = y + 0.5 - a[1];
+            for (int x = x0; x <= x1; ++x) {
+                C_float px = x + 0.5 - a[0];
+                C_float t = length_sq > 0.0 ? std::clamp((px * dx + py * dy) / length_sq, 0.0, 1.0) : 0.0;
+                C_float ex = px - t * dx, ey = py - t * dy;
+                C_float pixel_coverage = half_width + 0.5 - sqrt(ex * ex + ey * ey);
+                if (pixel_coverage > 0.0) {
+                    coverage_row[x] = std::max(coverage_row[x], (float)std::min(pixel_coverage, 1.0));
+                }
+            }
+        }
+        min_x = std::min(min_x, x0);
+        max_x = std::max(max_x, x1);
+        min_y = std::min(min_y, y0);
+        max_y = std::max(max_y, y1);
+    }
+
+    // Blends the line's colour over the image by its coverage, & clears the coverage for the next line
+    void composite(Rgb color) {
+        for (int y = min_y; y <= max_y; ++y) {
+            float* coverage_row = coverage.data() + (size_t)(y - begin_y) * image.width;
+            uint8_t* pixel = image.row(y) + (size_t)min_x * 3;
+            for (int x = min_x; x <= max_x; ++x, pixel += 3) {
+                float alpha = coverage_row[x];
+                if (alpha > 0.0f) {
+                    pixel[0] = (uint8_t)lround(pixel[0] + (color.r - pixel[0]) * alpha);
+                    pixel[1] = (uint8_t)lround(pixel[1] + (color.g - pixel[1]) * alpha);
+                    pixel[2] = (uint8_t)lround(pixel[2] + (color.b - pixel[2]) * alpha);
+                    coverage_row[x] = 0.0f;
+                }
+            }
+        }
+        reset_bounds();
+    }
+};
+
+static void draw_tile(Tile& tile, const std::vector<Polyline>& polylines, const View& view, const RenderParams& rp) {
+    Image& image = tile.image;
+    for (int y = tile.begin_y; y < tile.end_y; ++y) {
+        uint8_t* pixel = image.row(y);
+        for (int x = 0; x < image.width; ++x, pixel += 3) {
+            pixel[0] = rp.background.r;
+            pixel[1] = rp.background.g;
+            pixel[2] = rp.background.b;
+        }
+    }
+
+    C_float left = view.to_units_x(0.0), right = view.to_units_x(image.width);
+    C_float top = view.to_units_y(0.0), bottom = view.to_units_y(image.height);
+
+    // Grid, then axes (as the GUI draws them), each a hairline
+    if (rp.grid_step > 0.0 && rp.grid_step * view.pixels_per_unit >= MIN_GRID_SPACING_PX) {
+        for (C_float x = ceil(left / rp.grid_step) * rp.grid_step; x <= right; x += rp.grid_step) {
+            tile.add_segment(view.to_pixels({x, top}), view.to_pixels({x, bottom}), 0.5);
+        }
+        for (C_float y = ceil(bottom / rp.grid_step) * rp.grid_step; y <= top; y += rp.grid_step) {
+            tile.add_segment(view.to_pixels({left, y}), view.to_pixels({right, y}), 0.5);
+        }
+        tile.composite(rp.grid_color);
+    }
+    tile.add_segment(view.to_pixels({0.0, top}), view.to_pixels({0.0, bottom}), 0.5);
+    tile.add_segment(view.to_pixels({left, 0.0}), view.to_pixels({right, 0.0}), 0.5);
+    tile.composite(rp.axes_color);
+
+    C_float half_width = rp.line_width / 2;
+    for (const Polyline& polyline : polylines) {
+        std::array<C_float, 2> previous {};
+        for (size_t point_i = 0; point_i < polyline.points.size(); ++point_i) {
+            std::array<C_float, 2> point = view.to_pixels(polyline.points[point_i]);
+            if (point_i > 0) {
+                tile.add_segment(previous, point, half_width);
+            }
+            previous = point;
+        }
+        tile.composite(polyline.color);
+    }
+}
+
+void render_image(const std::vector<Polyline>& polylines, const RenderParams& rp, Image& image, C_ThreadPool* pool) {
+    image.width = std::max(rp.width, 1);
+    image.height = std::max(rp.height, 1);
+    image.pixels.resize((size_t)image.width * image.height * 3);
+
+    View view = fit_view(polylines, rp);
+
+    if (pool == nullptr) {
+        pool = &C_ThreadPool::shared();
+    }
+    size_t tiles_count = (image.height + TILE_ROWS - 1) / TILE_ROWS;
+    pool->parallel_for(0, tiles_count, 1, [&](size_t tile_i, size_t) {
+        int begin_y = (int)tile_i * TILE_ROWS;
+        Tile tile(image, begin_y, std::min(begin_y + TILE_ROWS, image.height));
+        draw_tile(tile, polylines, view, rp);
+    });
+}
+
+
+// PNG writing: the image data is compressed by deflate with its fixed Huffman codes (RFC 1951) & LZ77 matching,
+// which suits plots (mostly flat colour) well enough without an external zlib
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t {};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        // Sums can't overflow within this many bytes
+        size_t block = std::min(size, (size_t)5552);
+        for (size_t i = 0; i < block; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+// Packs bits from the least significant one, as deflate streams are
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint32_t bits = 0;
+    int bits_count = 0;
+
+    void put(uint32_t value, int count) {
+        bits |= value << bits_count;
+        bits_count += count;
+        while (bits_count >= 8) {
+            out.push_back((uint8_t)(bits & 0xFF));
+            bits >>= 8;
+            bits_count -= 8;
+        }
+    }
+
+    // Huffman codes are packed from their most significant bit
+    void put_code(uint32_t code, int count) {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < count; ++bit) {
+            reversed = (reversed << 1) | ((code >> bit) & 1);
+        }
+        put(reversed, count);
+    }
+
+    void flush() {
+        if (bits_count > 0) {
+            out.push_back((uint8_t)(bits & 0xFF));
+            bits = 0;
+            bits_count = 0;
+        }
+    }
+};
+
+static const int LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+                                    67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                      1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const int DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8,
+                                       9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void put_literal(BitWriter& w, int symbol) {
+    if (symbol < 144) {
+        w.put_code(0x30 + symbol, 8);
+    }
+    else if (symbol < 256) {
+        w.put_code(0x190 + symbol - 144, 9);
+    }
+    else if (symbol < 280) {
+        w.put_code(symbol - 256, 7);
+    }
+    else {
+        w.put_code(0xC0 + symbol - 280, 8);
+    }
+}
+
+static void put_match(BitWriter& w, int length, int distance) {
+    int length_code = (int)(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, length) - LENGTH_BASE) - 1;
+    put_literal(w, 257 + length_code);
+    w.put(length - LENGTH_BASE[length_code], LENGTH_EXTRA[length_code]);
+
+    int distance_code = (int)(std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, distance) - DISTANCE_BASE) - 1;
+    w.put_code(distance_code, 5);
+    w.put(distance - DISTANCE_BASE[distance_code], DISTANCE_EXTRA[distance_code]);
+}
+
+// Length of the common prefix of a & b, compared 8 bytes at a time
+static int match_length(const uint8_t* a, const uint8_t* b, int max_length) {
+    int length = 0;
+    while (length + 8 <= max_length) {
+        uint64_t a_word, b_word;
+        memcpy(&a_word, a + length, 8);
+        memcpy(&b_word, b + length, 8);
+        if (a_word != b_word) {
+            break;
+        }
+        length += 8;
+    }
+    while (length < max_length && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+// zlib stream (RFC 1950) of a single fixed-Huffman deflate block
+static void zlib_compress(const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+    const int WINDOW = 32768, MIN_MATCH = 3, MAX_MATCH = 258, MAX_CHAIN = 16;
+    const int HASH_BITS = 15, MAX_INSERT_LENGTH = 32;
+
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter w {out};
+    // Final block, fixed codes
+    w.put(1, 1);
+    w.put(1, 2);
+
+    // Last position of each 3-byte hash, & the previous position with the same hash of each position in the window
+    std::vector<int> head(1 << HASH_BITS, -1);
+    std::vector<int> previous(WINDOW, -1);
+    int size = (int)data.size();
+    auto insert = [&](int i) {
+        uint32_t hash = ((uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2]) * 2654435761u >> (32 - HASH_BITS);
+        previous[i & (WINDOW - 1)] = head[hash];
+        head[hash] = i;
+        return previous[i & (WINDOW - 1)];
+    };
+
+    int i = 0;
+    while (i < size) {
+        int best_length = 0, best_distance = 0;
+        if (i + MIN_MATCH <= size) {
+            int candidate = insert(i);
+            int max_length = std::min(MAX_MATCH, size - i);
+            for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && i - candidate <= WINDOW; ++chain) {
+                int length = match_length(&data[candidate], &data[i], max_length);
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = i - candidate;
+                    if (length == max_length) {
+                        break;
+                    }
+                }
+                // Entries overwritten by newer positions don't lead further back
+                int next = previous[candidate & (WINDOW - 1)];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+
+        if (best_length >= MIN_MATCH) {
+            put_match(w, best_length, best_distance);
+            // Long matches are mostly runs of one colour, whose positions aren't worth hashing
+            if (best_length <= MAX_INSERT_LENGTH) {
+                for (int k = 1; k < best_length && i + k + MIN_MATCH <= size; ++k) {
+                    insert(i + k);
+                }
+            }
+            i += best_length;
+        }
+        else {
+            put_literal(w, data[i]);
+            ++i;
+        }
+    }
+    put_literal(w, 256);
+    w.flush();
+
+    uint32_t adler = adler32(data.data(), data.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(adler >> shift));
+    }
+}
+
+static void put_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(value >> shift));
+    }
+}
+
+static void put_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    put_u32_be(out, (uint32_t)data.size());
+    size_t type_at = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32_be(out, crc32(0, out.data() + type_at, 4 + data.size()));
+}
+
+bool write_png(const char* path, const Image& image) {
+    std::vector<uint8_t> header;
+    put_u32_be(header, (uint32_t)image.width);
+    put_u32_be(header, (uint32_t)image.height);
+    // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    // Each row is stored as its difference from the row above ("Up" filter), so that repeated rows compress to nothing
+    size_t row_size = (size_t)image.width * 3;
+    std::vector<uint8_t> filtered((row_size + 1) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        const uint8_t* row = image.row(y);
+        const uint8_t* row_above = y > 0 ? image.row(y - 1) : nullptr;
+        uint8_t* filtered_row = filtered.data() + (row_size + 1) * y;
+        filtered_row[0] = 2;
+        for (size_t x = 0; x < row_size; ++x) {
+            filtered_row[x + 1] = (uint8_t)(row_above != nullptr ? row[x] - row_above[x] : row[x]);
+        }
+    }
+    std::vector<uint8_t> compressed;
+    zlib_compress(filtered, compressed);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    put_chunk(png, "IHDR", header);
+    put_chunk(png, "IDAT", compressed);
+    put_chunk(png, "IEND", {});
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && written;
+}
+
+bool render_png(const char* path, const C_Solver& solver, const RenderParams& rp, C_ThreadPool* pool) {
+    std::vector<Polyline> polylines = { beam_polyline(solver, rp, beam_color(0), pool) };
+    Image image;
+    render_image(polylines, rp, image, pool);
+    return write_png(path, image);
+}
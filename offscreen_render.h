@@ -0,0 +1,72 @@
+#ifndef SHADERBEAMS_OFFSCREEN_RENDER_H
+#define SHADERBEAMS_OFFSCREEN_RENDER_H
+
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// Headless rendering of solutions to images (no display or GPU needed), e.g. thumbnails of a whole sweep
+
+struct Rgb {
+    uint8_t r, g, b;
+};
+
+struct Image {
+    int width = 0, height = 0;
+    // Rows from the top, 3 bytes (RGB) per pixel
+    std::vector<uint8_t> pixels;
+
+    uint8_t* row(int y) { return pixels.data() + (size_t)y * width * 3; }
+
+    [[nodiscard]] const uint8_t* row(int y) const { return pixels.data() + (size_t)y * width * 3; }
+};
+
+struct Polyline {
+    std::vector<std::array<C_float, 2>> points;
+    Rgb color {};
+};
+
+struct RenderParams {
+    int width = 256, height = 256;
+    // View centre & the units shown across half of the larger side (as the GUI's look_at & 1 / zoom)
+    // A non-positive view_size fits the polylines in, leaving margin (a share of the image) around them
+    std::array<C_float, 2> look_at = {0.0, 0.0};
+    C_float view_size = 0.0;
+    C_float margin = 0.05;
+    // In pixels
+    C_float line_width = 1.5;
+    // Grid lines' spacing (in units, dropped when they would be closer than a few pixels), 0 for none
+    C_float grid_step = 0.1;
+    // Points along each beam: samples_per_element per element, at most max_samples
+    // (0 for twice the image's larger side, more than the pixels can show)
+    int samples_per_element = 8;
+    int max_samples = 0;
+    Rgb background {255, 255, 255};
+    Rgb grid_color {228, 228, 228};
+    Rgb axes_color {150, 150, 150};
+};
+
+// Colours cycled through when drawing several beams together
+Rgb beam_color(size_t beam_i);
+
+// The beam's centre line, sampled at evenly spaced points along it
+Polyline beam_polyline(const C_Solver& solver, const RenderParams& rp, Rgb color, C_ThreadPool* pool = nullptr);
+
+// Draws the grid, the axes & the polylines (in order, antialiased) into image, resized to rp's size
+// Rows are drawn in tiles split between the pool's threads (inline when called from one of its workers,
+// so that images rendered from parallel tasks are parallel across images instead)
+// pool defaults to C_ThreadPool::shared()
+void render_image(const std::vector<Polyline>& polylines, const RenderParams& rp, Image& image, C_ThreadPool* pool = nullptr);
+
+// 8-bit RGB PNG, returns whether it was written
+bool write_png(const char* path, const Image& image);
+
+// All of the above for a single solver's beam
+bool render_png(const char* path, const C_Solver& solver, const RenderParams& rp, C_ThreadPool* pool = nullptr);
+
+
+#endif //SHADERBEAMS_OFFSCREEN_RENDER_H
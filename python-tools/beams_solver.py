@@ -0,0 +1,271 @@
+"""Bindings of the Solver library's C interface (Solver/SolverC.h) over ctypes & NumPy
+
+    solver = Solver()
+    solver.setup(params(EI=1000, total_weight=1256.6, total_length=10, gap=6, elements_count=1000))
+    result = solver.fit()
+    elements = solver.elements()  # structured array over the solver's own memory (no copy)
+    plt.plot(elements['full.x'], elements['full.y'])
+
+    problems = np.repeat(params(elements_count=100), 100000)  # one problem per row
+    problems['total_weight'] = np.linspace(100, 3000, problems.size)
+    results = solve_batch(problems)  # fitted angles & end states, solved across all cores
+
+The library is looked up in $BEAMS_SOLVER_LIB, next to this file, in the usual build directories & on the system path.
+"""
+
+import ctypes
+import ctypes.util
+import os
+import sys
+
+import numpy as np
+
+
+ABI_VERSION = 2
+
+OK = 0
+ERROR_ARGUMENT = -1
+ERROR_STATE = -2
+ERROR_INTERNAL = -3
+
+PRECISION_DOUBLE = 0
+PRECISION_FLOAT = 1
+PRECISION_MIXED = 2
+
+# Why a traversal stopped at an unhealthy element or was cancelled (RESULT_DTYPE's 'diverged', its element in 'diverged_element')
+TRAVERSE_OK = 0
+TRAVERSE_NON_FINITE = 1
+TRAVERSE_CURVATURE = 2
+TRAVERSE_MOMENT = 3
+TRAVERSE_FORCE = 4
+TRAVERSE_CANCELLED = 5
+
+# Same layouts as the C structures
+PARAMS_DTYPE = np.dtype([
+    ('corr_selector', np.int32),
+    ('elements_count', np.int32),
+    ('EI', np.float64),
+    ('initial_angle', np.float64),
+    ('total_weight', np.float64),
+    ('total_length', np.float64),
+    ('gap', np.float64),
+], align=True)
+
+STATE_DTYPE = np.dtype([
+    ('x', np.float64), ('y', np.float64),
+    ('M', np.float64),
+    ('T', np.float64),
+    ('t', np.float64, 2),
+    ('n', np.float64, 2),
+    ('Fx', np.float64), ('Fy', np.float64),
+], align=True)
+
+RESULT_DTYPE = np.dtype([
+    ('converged', np.int32),
+    ('iterations', np.int32),
+    ('residual', np.float64),
+    ('initial_angle', np.float64),
+    ('end', STATE_DTYPE),
+    ('diverged', np.int32),
+    ('diverged_element', np.int32),
+], align=True)
+
+
+class FitParams(ctypes.Structure):
+    _fields_ = [
+        ('threshold', ctypes.c_double),
+        ('max_iterations', ctypes.c_int32),
+        ('shooting_chunks', ctypes.c_int32),
+    ]
+
+
+class SolverError(RuntimeError):
+    pass
+
+
+def _library_names():
+    if sys.platform == 'win32':
+        return ['Solver.dll', 'libSolver.dll']
+    if sys.platform == 'darwin':
+        return ['libSolver.dylib']
+    return ['libSolver.so']
+
+
+def _find_library():
+    path = os.environ.get('BEAMS_SOLVER_LIB')
+    if path:
+        return path
+
+    here = os.path.dirname(os.path.abspath(__file__))
+    root = os.path.dirname(here)
+    dirs = [here]
+    for build_dir in ['build', 'cmake-build-release', 'cmake-build-debug', 'cmake-build-relwithdebinfo']:
+        dirs += [os.path.join(root, build_dir, 'Solver'), os.path.join(root, build_dir, 'bin')]
+    for directory in dirs:
+        for name in _library_names():
+            path = os.path.join(directory, name)
+            if os.path.exists(path):
+                return path
+
+    path = ctypes.util.find_library('Solver')
+    if path:
+        return path
+    raise SolverError('Solver library not found (set BEAMS_SOLVER_LIB to its path)')
+
+
+def _load_library():
+    lib = ctypes.CDLL(_find_library())
+
+    c_size_p = ctypes.POINTER(ctypes.c_size_t)
+    signatures = {
+        'beams_abi_version': (ctypes.c_uint32, []),
+        'beams_solver_create': (ctypes.c_void_p, []),
+        'beams_solver_destroy': (None, [ctypes.c_void_p]),
+        'beams_solver_set_precision': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_int]),
+        'beams_solver_setup': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_void_p]),
+        'beams_solver_set_profiles': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]),
+        'beams_solver_get_params': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_void_p]),
+        'beams_solver_set_initial_angle': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_double]),
+        'beams_solver_traverse': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_void_p]),
+        'beams_solver_fit': (ctypes.c_int, [ctypes.c_void_p, ctypes.POINTER(FitParams), ctypes.c_void_p]),
+        'beams_solver_elements': (ctypes.c_void_p, [ctypes.c_void_p, c_size_p, c_size_p]),
+        'beams_solver_sample': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p]),
+        'beams_element_size': (ctypes.c_size_t, []),
+        'beams_element_fields_count': (ctypes.c_size_t, []),
+        'beams_element_field_name': (ctypes.c_char_p, [ctypes.c_size_t]),
+        'beams_element_field_offset': (ctypes.c_size_t, [ctypes.c_size_t]),
+        'beams_solve_batch': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_int, ctypes.POINTER(FitParams),
+                                             ctypes.c_int, ctypes.c_size_t, ctypes.c_void_p]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        function = getattr(lib, name)
+        function.restype = restype
+        function.argtypes = argtypes
+
+    version = lib.beams_abi_version()
+    if version != ABI_VERSION:
+        raise SolverError(f'Solver library has ABI version {version}, these bindings need {ABI_VERSION}')
+    return lib
+
+
+_lib = _load_library()
+
+
+def _element_dtype():
+    count = _lib.beams_element_fields_count()
+    names = [_lib.beams_element_field_name(i).decode() for i in range(count)]
+    offsets = [_lib.beams_element_field_offset(i) for i in range(count)]
+    return np.dtype({'names': names, 'formats': [np.float64] * count, 'offsets': offsets,
+                     'itemsize': _lib.beams_element_size()})
+
+
+# Fields are named like 'full.x' or 'base.tn.t0'
+ELEMENT_DTYPE = _element_dtype()
+
+
+def _check(status):
+    if status != OK:
+        raise SolverError({ERROR_ARGUMENT: 'invalid argument', ERROR_STATE: 'solver is not set up',
+                           ERROR_INTERNAL: 'internal error'}.get(status, f'status {status}'))
+
+
+def _fit_params(threshold=None, max_iterations=None, shooting_chunks=0):
+    fp = FitParams(1e-3, 100, shooting_chunks)
+    if threshold is not None:
+        fp.threshold = threshold
+    if max_iterations is not None:
+        fp.max_iterations = max_iterations
+    return fp
+
+
+def params(corr_selector=0, elements_count=10, EI=1000.0, initial_angle=0.0, total_weight=1256.6, total_length=10.0, gap=6.0):
+    """Single problem as a PARAMS_DTYPE record"""
+    p = np.zeros((), dtype=PARAMS_DTYPE)
+    p['corr_selector'] = corr_selector
+    p['elements_count'] = elements_count
+    p['EI'] = EI
+    p['initial_angle'] = initial_angle
+    p['total_weight'] = total_weight
+    p['total_length'] = total_length
+    p['gap'] = gap
+    return p
+
+
+class Solver:
+    def __init__(self, precision=PRECISION_DOUBLE):
+        self._handle = _lib.beams_solver_create()
+        if not self._handle:
+            raise MemoryError()
+        _check(_lib.beams_solver_set_precision(self._handle, precision))
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            _lib.beams_solver_destroy(self._handle)
+            self._handle = None
+
+    def setup(self, problem, EI_profile=None, weight_profile=None):
+        problem = np.array(problem, dtype=PARAMS_DTYPE).reshape(())
+        _check(_lib.beams_solver_setup(self._handle, problem.ctypes.data))
+        if EI_profile is not None or weight_profile is not None:
+            count = int(problem['elements_count'])
+            EI_profile = None if EI_profile is None else np.ascontiguousarray(EI_profile, dtype=np.float64)
+            weight_profile = None if weight_profile is None else np.ascontiguousarray(weight_profile, dtype=np.float64)
+            for profile in (EI_profile, weight_profile):
+                if profile is not None and profile.shape != (count,):
+                    raise ValueError(f'profiles need {count} values')
+            _check(_lib.beams_solver_set_profiles(
+                self._handle,
+                None if EI_profile is None else EI_profile.ctypes.data,
+                None if weight_profile is None else weight_profile.ctypes.data))
+
+    def params(self):
+        p = np.zeros((), dtype=PARAMS_DTYPE)
+        _check(_lib.beams_solver_get_params(self._handle, p.ctypes.data))
+        return p
+
+    def set_initial_angle(self, initial_angle):
+        _check(_lib.beams_solver_set_initial_angle(self._handle, initial_angle))
+
+    def traverse(self):
+        result = np.zeros((), dtype=RESULT_DTYPE)
+        _check(_lib.beams_solver_traverse(self._handle, result.ctypes.data))
+        return result
+
+    def fit(self, threshold=None, max_iterations=None, shooting_chunks=0):
+        result = np.zeros((), dtype=RESULT_DTYPE)
+        fp = _fit_params(threshold, max_iterations, shooting_chunks)
+        _check(_lib.beams_solver_fit(self._handle, ctypes.byref(fp), result.ctypes.data))
+        return result
+
+    def elements(self):
+        """Elements as an ELEMENT_DTYPE array viewing the solver's memory (valid until the next setup())"""
+        count, element_size = ctypes.c_size_t(), ctypes.c_size_t()
+        address = _lib.beams_solver_elements(self._handle, ctypes.byref(count), ctypes.byref(element_size))
+        if not address:
+            raise SolverError('solver is not set up')
+        buffer = (ctypes.c_char * (count.value * element_size.value)).from_address(address)
+        # Keeps the solver alive for as long as the view is
+        buffer.solver = self
+        view = np.frombuffer(buffer, dtype=ELEMENT_DTYPE, count=count.value)
+        view.flags.writeable = False
+        return view
+
+    def sample(self, positions, out=None):
+        """Elements at arc-length positions along the whole beam (into out, an ELEMENT_DTYPE array, if given)"""
+        positions = np.ascontiguousarray(positions, dtype=np.float64)
+        if out is None:
+            out = np.empty(positions.shape, dtype=ELEMENT_DTYPE)
+        elif out.dtype != ELEMENT_DTYPE or out.shape != positions.shape or not out.flags.c_contiguous:
+            raise ValueError('out must be a contiguous ELEMENT_DTYPE array shaped as positions')
+        _check(_lib.beams_solver_sample(self._handle, positions.ctypes.data, positions.size, out.ctypes.data))
+        return out
+
+
+def solve_batch(problems, fit=True, threshold=None, max_iterations=None, precision=PRECISION_DOUBLE, threads=0):
+    """Solves a PARAMS_DTYPE array of problems in one call (across all cores), returning a RESULT_DTYPE array"""
+    problems = np.ascontiguousarray(problems, dtype=PARAMS_DTYPE)
+    results = np.zeros(problems.shape, dtype=RESULT_DTYPE)
+    fp = _fit_params(threshold, max_iterations)
+    _check(_lib.beams_solve_batch(problems.ctypes.data, problems.size, int(fit), ctypes.byref(fp), precision, threads,
+                                  results.ctypes.data))
+    return results
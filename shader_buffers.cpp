@@ -1,5 +1,9 @@
 #include "shader_buffers.h"
+#include "frame_trace.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 
@@ -26,21 +30,6 @@ ShaderBuffers::ShaderBuffers() {
     }
 }
 
-void* alloc_buffer(GLuint* index, GLenum target, GLsizeiptr size_bytes) {
-    // Generate & bind buffer
-    glGenBuffers(1, index);
-    glBindBuffer(target, *index);
-
-    // Allocate buffer (uninitialized)
-    GLenum usage = (target == GL_SHADER_STORAGE_BUFFER) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
-    glBufferData(target, size_bytes, nullptr, usage);
-
-    // Map buffer to memory
-    void* ptr = glMapBufferRange(target, 0, size_bytes, GL_MAP_WRITE_BIT);
-
-    return ptr;
-}
-
 void unmap_buffer(GLenum target) {
     glUnmapBuffer(target);
 }
@@ -50,39 +39,136 @@ void free_buffer(GLuint* index) {
 }
 
 void ShaderBuffers::re_alloc(size_t new_elements_count, size_t new_segments_count) {
-    internal_re_alloc_VBO(new_elements_count, new_segments_count);
+    if (!vbo_allocated) {
+        glGenBuffers(1, &vbo_index);
+        vbo_vertices_capacity = 0;
+        vbo_allocated = true;
+    }
+    segments_count = new_segments_count;
+    vbo_stale = true;
+
+    internal_re_alloc_SSBO(new_elements_count);
 }
 
-void ShaderBuffers::internal_re_alloc_VBO(size_t new_elements_count, size_t new_segments_count) {
-    if (vbo_allocated && (new_elements_count == elements_count && new_segments_count == segments_count)) {
-        return;
+void ShaderBuffers::set_adaptive_segments(bool adaptive, GLSL_float max_error_px) {
+    if (adaptive != adaptive_segments || max_error_px != segment_error_px) {
+        adaptive_segments = adaptive;
+        segment_error_px = max_error_px;
+        vbo_stale = true;
     }
+}
 
-    internal_ensure_free_VBO();
+void ShaderBuffers::set_element_EI(std::vector<GLSL_float> new_element_EI) {
+    element_EI = std::move(new_element_EI);
+    vbo_stale |= adaptive_segments;
+}
+
+void ShaderBuffers::internal_re_alloc_VBO(size_t new_vertices_capacity) {
+    // VBO buffer is left with uninitialized data, vertices are uploaded by internal_update_VBO()
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_index);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (sizeof(VBO_vertex) * new_vertices_capacity), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vbo_vertices_capacity = new_vertices_capacity;
+}
+
+size_t ShaderBuffers::internal_pick_segments(const GLSL_UniformParams& up, GLSL_float pixels_per_unit) {
+    size_t first_changed = vbo_element_vertices.size() == elements_count ? elements_count : 0;
+    vbo_element_vertices.resize(elements_count);
+    auto set_vertices = [&](size_t element, uint32_t vertices) {
+        if (vbo_element_vertices[element] != vertices) {
+            vbo_element_vertices[element] = vertices;
+            first_changed = std::min(first_changed, element);
+        }
+    };
 
-    // Generate VBO buffer
-    vbo_vertices_count = (GLsizei) (new_elements_count * (new_segments_count + 1));
-    auto vbo_size_bytes = (GLsizeiptr) (sizeof(VBO_vertex) * vbo_vertices_count);
-    void* vbo_void_ptr = alloc_buffer(&vbo_index, GL_ARRAY_BUFFER, vbo_size_bytes);
-    auto vbo_mapped_ptr = static_cast<VBO_vertex*>(vbo_void_ptr);
-
-    // Fill VBO buffer
-    auto _ptr = vbo_mapped_ptr;
-    for (size_t element = 0; element < new_elements_count; ++element) {
-        for (size_t si = 0; si <= new_segments_count; ++si) {
-            _ptr->element = (float)element;
-            _ptr->s = (float)si / (float)new_segments_count;
-            ++_ptr;
+    if (pixels_per_unit == 0.0f) {
+        for (size_t element = 0; element < elements_count; ++element) {
+            set_vertices(element, (uint32_t) segments_count + 1);
         }
+        return first_changed;
     }
 
-    // Unmap VBO buffer
-    unmap_buffer(GL_ARRAY_BUFFER);
+    GLSL_float element_px = up.total_length / (GLSL_float) up.elements_count * pixels_per_unit;
+    // Pixels since the last vertex, & the longest segment the elements since it allow
+    GLSL_float run_px = 0.0f, run_limit_px = MAX_SEGMENT_PX;
+    for (size_t element = 0; element < elements_count; ++element) {
+        // Chord of an arc of curvature K & length h deviates from it by K h² / 8
+        GLSL_float EI = element < element_EI.size() ? element_EI[element] : up.EI;
+        GLSL_float K_px = std::fabs(ssbo_elements[element].base.M / EI) / pixels_per_unit;
+        GLSL_float segment_px = MAX_SEGMENT_PX;
+        if (K_px * MAX_SEGMENT_PX * MAX_SEGMENT_PX > 8.0f * segment_error_px) {
+            segment_px = std::max(std::sqrt(8.0f * segment_error_px / K_px), MIN_SEGMENT_PX);
+        }
 
-    vbo_allocated = true;
-    segments_count = new_segments_count;
+        // The last element always ends the line
+        if (element_px > segment_px || element + 1 == elements_count) {
+            auto segments = (uint32_t) std::min(std::ceil(element_px / segment_px), (GLSL_float) MAX_SEGMENTS);
+            set_vertices(element, std::max(segments, 1u) + 1);
+            run_px = 0.0f;
+            run_limit_px = MAX_SEGMENT_PX;
+            continue;
+        }
 
-    internal_re_alloc_SSBO(new_elements_count);
+        run_limit_px = std::min(run_limit_px, segment_px);
+        if (element == 0 || run_px + element_px > run_limit_px) {
+            set_vertices(element, 1);
+            run_px = element_px;
+            run_limit_px = segment_px;
+        }
+        else {
+            set_vertices(element, 0);
+            run_px += element_px;
+        }
+    }
+    return first_changed;
+}
+
+void ShaderBuffers::internal_update_VBO(const GLSL_UniformParams& up, GLSL_float zoom, bool dashed) {
+    GLSL_float pixels_per_unit = 0.0f;
+    // Dashes are drawn per segment, so they're only even along fixed segments
+    if (adaptive_segments && !dashed) {
+        // Zoom is taken in half-octave steps, so that zooming only re-picks the segments now & then
+        GLint viewport[4] {};
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLSL_float zoom_step = std::exp2(std::round(std::log2(zoom) * 2.0f) / 2.0f);
+        pixels_per_unit = zoom_step * (GLSL_float) std::max(viewport[2], viewport[3]) / 2.0f;
+    }
+    if (!vbo_stale && pixels_per_unit == vbo_pixels_per_unit) {
+        return;
+    }
+    TRACE_SCOPE("ShaderBuffers::update_VBO");
+    vbo_stale = false;
+    vbo_pixels_per_unit = pixels_per_unit;
+
+    size_t first_changed = internal_pick_segments(up, pixels_per_unit);
+    if (first_changed >= elements_count) {
+        return;
+    }
+
+    // Vertices before the first changed element are kept
+    size_t first_vertex = 0;
+    for (size_t element = 0; element < first_changed; ++element) {
+        first_vertex += vbo_element_vertices[element];
+    }
+    vbo_vertices.resize(first_vertex);
+    for (size_t element = first_changed; element < elements_count; ++element) {
+        uint32_t vertices = vbo_element_vertices[element];
+        for (uint32_t vertex = 0; vertex < vertices; ++vertex) {
+            GLSL_float s = vertices > 1 ? (GLSL_float) vertex / (GLSL_float) (vertices - 1) : 0.0f;
+            vbo_vertices.push_back(VBO_vertex { s, (GLSL_float) element });
+        }
+    }
+    vbo_vertices_count = (GLsizei) vbo_vertices.size();
+
+    // Storage grows geometrically, & the whole of it is uploaded when it does
+    if (vbo_vertices.size() > vbo_vertices_capacity) {
+        internal_re_alloc_VBO(vbo_vertices.size() + vbo_vertices.size() / 2);
+        first_vertex = 0;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_index);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) (sizeof(VBO_vertex) * first_vertex),
+                    (GLsizeiptr) (sizeof(VBO_vertex) * (vbo_vertices.size() - first_vertex)), &vbo_vertices[first_vertex]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void ShaderBuffers::internal_re_alloc_SSBO(size_t new_elements_count) {
@@ -92,13 +178,35 @@ void ShaderBuffers::internal_re_alloc_SSBO(size_t new_elements_count) {
 
     internal_ensure_free_SSBO();
 
-    // Generate SSBO buffer (+1 element)
-    auto ssbo_size_bytes = (GLsizeiptr) (sizeof(GLSL_Element) * (new_elements_count + 1));
-    void* ssbo_void_ptr = alloc_buffer(&ssbo_index, GL_SHADER_STORAGE_BUFFER, ssbo_size_bytes);
-    ssbo_mapped_ptr = static_cast<GLSL_Element*>(ssbo_void_ptr);
+    // Each region holds all elements (+1 element), & starts at an offset the SSBO can be bound at
+    GLint offset_alignment = 1;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+    offset_alignment = offset_alignment > 0 ? offset_alignment : 1;
+    ssbo_region_size = (GLsizeiptr) (sizeof(GLSL_Element) * (new_elements_count + 1));
+    ssbo_region_stride = (ssbo_region_size + offset_alignment - 1) / offset_alignment * offset_alignment;
+
+    glGenBuffers(1, &ssbo_index);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_index);
+
+    ssbo_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (ssbo_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, ssbo_region_stride * SSBO_REGIONS, nullptr, flags);
+        ssbo_mapped_ptr = static_cast<unsigned char*>(
+                glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, ssbo_region_stride * SSBO_REGIONS, flags));
+    }
+    else {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, ssbo_region_size, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     // SSBO buffer is left with uninitialized data
     // It will be written during ElementParams computation
+    ssbo_elements.assign(new_elements_count + 1, GLSL_Element {});
+    ssbo_region = 0;
+    for (int region = 0; region < SSBO_REGIONS; ++region) {
+        ssbo_pending_begin[region] = ssbo_pending_end[region] = 0;
+    }
 
     ssbo_allocated = true;
     elements_count = new_elements_count;
@@ -117,6 +225,10 @@ void ShaderBuffers::internal_ensure_free_VBO() {
     free_buffer(&vbo_index);
     vbo_index = NULL;
     vbo_vertices_count = NULL;
+    vbo_vertices_capacity = 0;
+    vbo_element_vertices.clear();
+    vbo_vertices.clear();
+    vbo_vertices.shrink_to_fit();
 
     vbo_allocated = false;
 }
@@ -126,23 +238,101 @@ void ShaderBuffers::internal_ensure_free_SSBO() {
         return;
     }
 
-    unmap_buffer(GL_SHADER_STORAGE_BUFFER);
+    for (GLsync& fence : ssbo_fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (ssbo_persistent) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_index);
+        unmap_buffer(GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
     ssbo_mapped_ptr = nullptr;
     free_buffer(&ssbo_index);
     ssbo_index = NULL;
+    ssbo_elements.clear();
+    ssbo_elements.shrink_to_fit();
 
     ssbo_allocated = false;
 }
 
 GLSL_Element *ShaderBuffers::get_buffer_ptr() {
-    return (vbo_allocated && ssbo_allocated) ? ssbo_mapped_ptr : nullptr;
+    return (vbo_allocated && ssbo_allocated) ? ssbo_elements.data() : nullptr;
+}
+
+void ShaderBuffers::commit(size_t begin, size_t end) {
+    end = std::min(end, ssbo_elements.size());
+    if (begin >= end) {
+        return;
+    }
+
+    // Curvatures may have changed
+    vbo_stale |= adaptive_segments;
+
+    // Every region misses the range now
+    for (int region = 0; region < SSBO_REGIONS; ++region) {
+        if (ssbo_pending_begin[region] >= ssbo_pending_end[region]) {
+            ssbo_pending_begin[region] = begin;
+            ssbo_pending_end[region] = end;
+        }
+        else {
+            ssbo_pending_begin[region] = std::min(ssbo_pending_begin[region], begin);
+            ssbo_pending_end[region] = std::max(ssbo_pending_end[region], end);
+        }
+    }
+}
+
+void ShaderBuffers::internal_upload() {
+    if (ssbo_pending_begin[ssbo_region] >= ssbo_pending_end[ssbo_region]) {
+        return;
+    }
+
+    int region = ssbo_region;
+    if (ssbo_persistent) {
+        // The current region may still be read by the frames in flight, so the next one is written instead
+        region = (ssbo_region + 1) % SSBO_REGIONS;
+        GLsync& fence = ssbo_fences[region];
+        if (fence != nullptr) {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                return;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    size_t begin = ssbo_pending_begin[region], end = ssbo_pending_end[region];
+    if (begin < end) {
+        auto offset = (GLsizeiptr) (sizeof(GLSL_Element) * begin);
+        auto size = (GLsizeiptr) (sizeof(GLSL_Element) * (end - begin));
+        if (ssbo_persistent) {
+            memcpy(ssbo_mapped_ptr + ssbo_region_stride * region + offset, &ssbo_elements[begin], size);
+        }
+        else {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_index);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, &ssbo_elements[begin]);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+    }
+    ssbo_pending_begin[region] = ssbo_pending_end[region] = 0;
+    ssbo_region = region;
 }
 
 void ShaderBuffers::draw(GLSL_UniformParams up, GLSL_float zoom, std::array<GLSL_float, 2> look_at, bool dashed) {
+    TRACE_SCOPE("ShaderBuffers::draw");
     if (!vbo_allocated || !ssbo_allocated) {
         return;
     }
 
+    internal_upload();
+    internal_update_VBO(up, zoom, dashed);
+    if (vbo_vertices_count == 0) {
+        return;
+    }
+
     sf::Shader::bind(&shader);
 
     GLSL_PACK_UP(up_array, up);
@@ -154,9 +344,17 @@ void ShaderBuffers::draw(GLSL_UniformParams up, GLSL_float zoom, std::array<GLSL
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, OpenGLDataType, GL_FALSE, 0, nullptr);
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo_index);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, ssbo_index, ssbo_region_stride * ssbo_region, ssbo_region_size);
     glDrawArrays(dashed ? GL_LINES : GL_LINE_STRIP, 0, vbo_vertices_count);
 
+    // The region may be written again once this frame's commands are done with it
+    if (ssbo_persistent) {
+        if (ssbo_fences[ssbo_region] != nullptr) {
+            glDeleteSync(ssbo_fences[ssbo_region]);
+        }
+        ssbo_fences[ssbo_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
     glDisableVertexAttribArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
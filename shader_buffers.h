@@ -4,6 +4,8 @@
 #include <SFML/Graphics/Shader.hpp>
 #include <GL/glew.h>
 #include <array>
+#include <cstdint>
+#include <vector>
 
 
 #define GLSL_USE_DOUBLE_PRECISION 0
@@ -76,8 +78,21 @@ public:
 
     void re_alloc(size_t new_elements_count, size_t new_segments_count);
 
+    // Segments of each element: new_segments_count (of re_alloc()) for all of them, or when adaptive, as many as keep
+    // the chords within max_error_px of the arcs on screen (from each element's curvature, the zoom & the viewport)
+    // Adaptive elements shorter than a segment share one with their neighbours, so the vertices follow the screen length
+    // Dashed lines are drawn with the fixed segments
+    void set_adaptive_segments(bool adaptive, GLSL_float max_error_px);
+
+    // Per-element EI the adaptive segments take the curvatures with (empty for a uniform one, up.EI of draw())
+    void set_element_EI(std::vector<GLSL_float> new_element_EI);
+
+    // Elements as the shaders will see them (a CPU-side copy, nullptr if not allocated)
+    // Written ranges are uploaded by draw() once they are committed
     GLSL_Element* get_buffer_ptr();
 
+    void commit(size_t begin, size_t end);
+
     void draw(GLSL_UniformParams up, GLSL_float zoom = 1.0f, std::array<GLSL_float, 2> look_at = {0.0, 0.0}, bool dashed = false);
 
     void free();
@@ -85,7 +100,18 @@ public:
     ~ShaderBuffers() { free(); }
 
 private:
-    void internal_re_alloc_VBO(size_t new_elements_count, size_t new_segments_count);
+    // Segments' limits on screen (in pixels) & per element
+    static constexpr GLSL_float MIN_SEGMENT_PX = 2.0f;
+    static constexpr GLSL_float MAX_SEGMENT_PX = 32.0f;
+    static const int MAX_SEGMENTS = 64;
+
+    void internal_re_alloc_VBO(size_t new_vertices_capacity);
+
+    // Regenerates the vertices if the elements' segments changed (from the first element whose did)
+    void internal_update_VBO(const GLSL_UniformParams& up, GLSL_float zoom, bool dashed);
+
+    // Vertices of each element for the given scale (0 for none), returns the first element whose count changed
+    size_t internal_pick_segments(const GLSL_UniformParams& up, GLSL_float pixels_per_unit);
 
     void internal_re_alloc_SSBO(size_t new_elements_count);
 
@@ -93,15 +119,42 @@ private:
 
     void internal_ensure_free_SSBO();
 
+    // Brings a region up to date with the committed elements, unless the GPU may still be reading it
+    void internal_upload();
+
     sf::Shader shader;
 
     bool vbo_allocated = false;
     GLuint vbo_index = NULL;
     GLsizei vbo_vertices_count = NULL;
+    size_t vbo_vertices_capacity = 0;
+
+    // Each element's vertices are at s = 0 (a single one), or at s = 0, 1 / k, ... 1 (k + 1 of them)
+    std::vector<uint32_t> vbo_element_vertices;
+    std::vector<VBO_vertex> vbo_vertices;
+    // Whether the segments need picking again (the elements or their count changed), & the scale they were picked for
+    bool vbo_stale = true;
+    GLSL_float vbo_pixels_per_unit = 0.0f;
+    bool adaptive_segments = false;
+    GLSL_float segment_error_px = 0.25f;
+    std::vector<GLSL_float> element_EI;
+
+    // SSBO is a ring of regions, each a whole copy of the elements, persistently & coherently mapped
+    // Each frame draws from the latest complete region & fences it; the next one is only written once its fence
+    // has passed (otherwise the current one is drawn again), so uploads never wait for the GPU
+    // Without buffer storage (OpenGL < 4.4) there's a single region, written with glBufferSubData
+    static const int SSBO_REGIONS = 3;
 
     bool ssbo_allocated = false;
     GLuint ssbo_index = NULL;
-    GLSL_Element* ssbo_mapped_ptr = nullptr;
+    bool ssbo_persistent = false;
+    unsigned char* ssbo_mapped_ptr = nullptr;
+    GLsizeiptr ssbo_region_size = 0, ssbo_region_stride = 0;
+    int ssbo_region = 0;
+    GLsync ssbo_fences[SSBO_REGIONS] {};
+    // Elements each region is missing: [begin, end)
+    size_t ssbo_pending_begin[SSBO_REGIONS] {}, ssbo_pending_end[SSBO_REGIONS] {};
+    std::vector<GLSL_Element> ssbo_elements;
 
     size_t elements_count = NULL, segments_count = NULL;
 };
@@ -1,20 +1,22 @@
 #include "shader_drawer.h"
+#include "solution_io.h"
+#include "frame_trace.h"
 
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <fstream>
+#include <cstdio>
 #include <cstdlib>
 
 using json = nlohmann::json;
 
+// Disk tier of the solution cache (in the temporary directory)
+const char* SOLUTION_CACHE_DIR = "ShaderBeams-cache";
+const size_t SOLUTION_CACHE_DISK_BUDGET = (size_t)1 << 30;
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(VisualParams, VisualParams_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SolverParams, SolverParams_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_UniformParams, C_UniformParams_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_Basis, C_Basis_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_SolutionFull, C_SolutionFull_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_SolutionBase, C_SolutionBase_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_SolutionCorr, C_SolutionCorr_FIELDS)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_Element, C_Element_FIELDS)
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(VisualParams, VisualParams_FIELDS)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(SolverParams, SolverParams_FIELDS)
 
 GLSL_Basis C2GLSL_Basis(C_Basis c_basis) {
     return GLSL_Basis {
@@ -66,6 +68,20 @@ GLSL_Element C2GLSL_Element(C_Element c_element) {
     };
 }
 
+// Same as C2GLSL_Element over count elements: both are flat arrays of numbers in the same order,
+// so the whole range is converted in a single (vectorizable) loop
+void C2GLSL_Elements(const C_Element* c_elements, size_t count, GLSL_Element* glsl_elements) {
+    const size_t numbers_per_element = sizeof(C_Element) / sizeof(C_float);
+    static_assert(sizeof(C_Element) == numbers_per_element * sizeof(C_float), "C_Element must only hold C_float");
+    static_assert(sizeof(GLSL_Element) == numbers_per_element * sizeof(GLSL_float), "GLSL_Element must mirror C_Element");
+
+    const C_float* c_numbers = reinterpret_cast<const C_float*>(c_elements);
+    GLSL_float* glsl_numbers = reinterpret_cast<GLSL_float*>(glsl_elements);
+    for (size_t number_i = 0; number_i < count * numbers_per_element; ++number_i) {
+        glsl_numbers[number_i] = GLSL_float(c_numbers[number_i]);
+    }
+}
+
 GLSL_UniformParams C2GLSL_UniformParams(C_UniformParams c_up) {
     return GLSL_UniformParams {
             c_up.corr_selector,
@@ -109,6 +125,7 @@ void VisualParams::process_event(sf::Event event, sf::RenderWindow *window) {
 }
 
 bool SolverParams::should_compute(C_Solver *solver) {
+    TRACE_SCOPE("SolverParams::should_compute");
     bool force_solve = false;
     bool was_fit = fabs(fit_deviation) < fit_threshold;
 
@@ -118,17 +135,23 @@ bool SolverParams::should_compute(C_Solver *solver) {
 
         ImGui::Spacing();
 
-        if (ImGui::Checkbox("AutoFit angle", &auto_fit_angle)) {
-            was_fit = false;
+        // Each request runs a whole fit, so it's only requested again when its parameters change
+        bool fit_changed = ImGui::Checkbox("AutoFit angle", &auto_fit_angle);
+        fit_changed |= ImGui_Slider("Fit threshold", &fit_threshold, solver->up.total_length * 1e-5, solver->up.total_length / 10.0, "%.3g", ImGuiSliderFlags_Logarithmic);
+        fit_changed |= ImGui::SliderInt("Fit max iterations", &fit_max_iterations, 1, 1000, "%d", ImGuiSliderFlags_Logarithmic);
+        if (fit_changed) {
+            solved = false;
         }
-        ImGui_Slider("Fit threshold", &fit_threshold, solver->up.total_length * 1e-5, solver->up.total_length / 10.0, "%.3g", ImGuiSliderFlags_Logarithmic);
-        ImGui_Slider("Fit rate", &fit_rate, 0.01, 1.0, "%.3g", ImGuiSliderFlags_Logarithmic);
         if (auto_fit_angle) {
-            ImGui::Text("Fitting%s", was_fit ? " finished" : "...");
+            ImGui::Text("Fit %s", was_fit ? "converged" : "not converged");
             ImGui::Text("Theta: %f"
                         "\nVertical deviation: % f"
-                        "\nThreshold:           %f",
-                        solver->up.initial_angle, fit_deviation, fit_threshold);
+                        "\nThreshold:           %f"
+                        "\nIterations: %d",
+                        solver->up.initial_angle, fit_deviation, fit_threshold, fit_iterations);
+        }
+        if (!traverse_status.ok()) {
+            ImGui::Text("Diverged at element %zu (%s)", traverse_status.element_i, C_traverse_reason_name(traverse_status.reason));
         }
     }
 
@@ -138,25 +161,22 @@ bool SolverParams::should_compute(C_Solver *solver) {
     if (!auto_solve)
         return false;
 
-    if (!solved)
-        return true;
-
-    if (auto_fit_angle && !was_fit)
-        return true;
+    return !solved;
+}
 
-    return false;
+C_FitParams SolverParams::fit_params() const {
+    C_FitParams fp;
+    fp.threshold = fit_threshold;
+    fp.max_iterations = fit_max_iterations;
+    return fp;
 }
 
-void SolverParams::accept_solution(C_Solver *solver) {
-    if (auto_fit_angle) {
-        fit_deviation = solver->elements[solver->up.elements_count].full.y;
-        C_float deviation_factor = fit_deviation / solver->up.total_length;
-        C_float angle_factor = (PI / 2.0) * deviation_factor;
-        C_float angle_delta = angle_factor * fit_rate;
-        solver->up.initial_angle -= angle_delta;
-        if (isinf(solver->up.initial_angle) || isnan(solver->up.initial_angle)) {
-            solver->up.initial_angle = 2.0 * PI;
-        }
+void SolverParams::accept_solution(C_Solver *solver, const C_FitResult& fit) {
+    fit_deviation = fit.residual;
+    fit_iterations = fit.iterations;
+    traverse_status = fit.traverse_status;
+    if (!std::isfinite(solver->up.initial_angle)) {
+        solver->up.initial_angle = 0.0;
     }
 }
 
@@ -165,14 +185,18 @@ ShaderDrawer::ShaderDrawer(sf::RenderWindow* new_window, int new_segments_count)
     window = new_window;
     file_load_dialog = ImGui::FileBrowser(ImGuiFileBrowserFlags_CloseOnEsc | ImGuiFileBrowserFlags_ConfirmOnEnter);
     file_load_dialog.SetTitle("Load ShaderBeams problem from file");
-    file_load_dialog.SetTypeFilters({ ".txt" });
+    file_load_dialog.SetTypeFilters({ ".txt", ".bsol" });
     file_save_dialog = ImGui::FileBrowser(ImGuiFileBrowserFlags_EnterNewFilename | ImGuiFileBrowserFlags_CreateNewDir | ImGuiFileBrowserFlags_CloseOnEsc | ImGuiFileBrowserFlags_ConfirmOnEnter);
     file_save_dialog.SetTitle("Save ShaderBeams problem to file");
-    file_save_dialog.SetTypeFilters({ ".txt" });
+    file_save_dialog.SetTypeFilters({ ".txt", ".bsol" });
+    configure_cache();
 }
 
 void ShaderDrawer::setup(C_UniformParams new_up) {
     sp.solved = false;
+    solver_worker.cancel_all();
+    solution_shown = false;
+    solver_elements_pending = false;
     solver.setup(new_up);
     ensure_sb();
 }
@@ -183,8 +207,18 @@ void ShaderDrawer::tweak(int new_segments_count) {
 }
 
 void ShaderDrawer::ensure_sb() {
+    shaders_stale = true;
     if (solver.was_setup() && !vp.disabled) {
         sb.re_alloc(solver.up.elements_count, vp.segments_count);
+        // Profiles only change along with the problem, so the picker gets them here
+        std::vector<GLSL_float> element_EI;
+        if (solver.has_EI_profile()) {
+            size_t elements_count = solver.up.elements_count;
+            for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+                element_EI.push_back(GLSL_float(solver.element_EI(element_i)));
+            }
+        }
+        sb.set_element_EI(std::move(element_EI));
     }
     else {
         free_sb();
@@ -197,71 +231,79 @@ void ShaderDrawer::free_sb() {
 
 void ShaderDrawer::forget() {
     sp.solved = false;
+    solver_worker.cancel_all();
+    solution_shown = false;
     solver.forget();
     free_sb();
 }
 
 void ShaderDrawer::load_from_file(const std::filesystem::path& file_path) {
+    // Binary files are used in place
+    if (file_path.extension() == ".bsol") {
+        auto file = std::make_unique<C_SolutionFile>();
+        if (!file->open(file_path.string().c_str())) {
+            fprintf(stderr, "Error reading solution file '%s'!\n", file_path.string().c_str());
+            return;
+        }
+        solver_worker.cancel_all();
+        solver_elements_pending = false;
+        file->attach(&solver);
+        solution_file = std::move(file);
+
+        const C_SolutionFileHeader& header = solution_file->header();
+        sp.fit_threshold = header.fit_threshold;
+        sp.fit_max_iterations = header.fit_max_iterations;
+        sp.solved = header.solved != 0;
+        sp.fit_deviation = header.fit_residual;
+        sp.fit_iterations = header.fit_iterations;
+
+        ensure_sb();
+        copy_to_shaders(solver.elements, 0, solver.up.elements_count);
+        solution_shown = sp.solved;
+        shown_up = solver.up;
+        return;
+    }
+
     std::ifstream i(file_path);
     json j;
-    i >> j;
+    solver_worker.cancel_all();
+    solver_elements_pending = false;
+    solution_read_json(i, j, &solver);
+    if (!j.contains("problem")) {
+        fprintf(stderr, "Error reading solution file '%s'!\n", file_path.string().c_str());
+        return;
+    }
 
     vp = j["visual_params"];
     sp = j["solver_params"];
-    C_UniformParams up = j["problem"];
-    json el_j = j["solution"];
-
-    assert(el_j.size() == up.elements_count + 1);
-
-    solver.setup(up);
+    configure_cache();
 
     ensure_sb();
 
-    C_Element *c_elements = solver.elements;
-
-    for (auto& element : el_j) {
-        C_Element c_el = element.template get<C_Element>();
-        *c_elements++ = c_el;
-    }
-
-    copy_to_shaders(0, up.elements_count);
+    copy_to_shaders(solver.elements, 0, solver.up.elements_count);
+    solution_shown = sp.solved;
+    shown_up = solver.up;
 }
 
 void ShaderDrawer::save_to_file(const std::filesystem::path& file_path) {
+    ensure_solver_elements();
+
+    if (file_path.extension() == ".bsol") {
+        C_FitResult fit;
+        fit.residual = sp.fit_deviation;
+        fit.iterations = sp.fit_iterations;
+        if (!C_save_solution_file(file_path.string().c_str(), solver, sp.fit_params(), sp.solved ? &fit : nullptr)) {
+            fprintf(stderr, "Error writing solution file '%s'!\n", file_path.string().c_str());
+        }
+        return;
+    }
+
     json j;
     j["visual_params"] = vp;
     j["solver_params"] = sp;
-    j["problem"] = solver.up;
-
-    auto j_elements = nlohmann::json::array();
-    C_Element *c_elements = solver.elements;
-    for (size_t element_i = 0; element_i <= solver.up.elements_count; ++element_i) {
-        C_Element c_el = c_elements[element_i];
-        j_elements.push_back(c_el);
-    }
-    j["solution"] = j_elements;
-
-    if (matplotlib) {
-        auto j_elements_seg_outer = nlohmann::json::array();
-        C_float each_length = solver.up.total_length / (C_float)solver.up.elements_count;
-
-        for (size_t element_i = 0; element_i <= solver.up.elements_count; ++element_i) {
-            auto j_elements_seg_inner = nlohmann::json::array();
-
-            for (size_t segment_i = 0; segment_i <= vp.segments_count; ++segment_i) {
-                C_float s = each_length * (C_float)segment_i / vp.segments_count;
-                C_Element c_seg_full = solver.get_solution_at(element_i, s);
-
-                j_elements_seg_inner.push_back(c_seg_full);
-            }
-
-            j_elements_seg_outer.push_back(j_elements_seg_inner);
-        }
-        j["solution_seg"] = j_elements_seg_outer;
-    }
 
     std::ofstream o(file_path);
-    o << std::setw(4) << j << std::endl;
+    solution_write_json(o, j, &solver, matplotlib ? vp.segments_count : 0);
 }
 
 void ShaderDrawer::process_event(sf::Event event) {
@@ -346,7 +388,13 @@ void ShaderDrawer::process_gui() {
         sb_changed |= ImGui::Checkbox("Disabled", &vp.disabled);
 
         if (!vp.disabled) {
-            sb_changed |= ImGui::SliderInt("Segments", &vp.segments_count, 1, 10);
+            ImGui::Checkbox("Adaptive segments", &vp.adaptive_segments);
+            if (vp.adaptive_segments) {
+                ImGui_Slider("Segment error (px)", &vp.segment_error_px, 0.05, 4.0, "%.2f", ImGuiSliderFlags_Logarithmic);
+            }
+            else {
+                sb_changed |= ImGui::SliderInt("Segments", &vp.segments_count, 1, 10);
+            }
             ImGui::Checkbox("Dashed lines", &vp.dashed);
         }
 
@@ -401,45 +449,192 @@ void ShaderDrawer::process_gui() {
 
         bool fem_changed = false;
 
-        fem_changed |= ImGui::SliderInt("Elements", &solver.up.elements_count, 1, 100);
+        if (sp.auto_elements) {
+            ImGui::Text("Elements: %d (error %.3g, order %.2f)", solver.up.elements_count, sp.elements_error, sp.elements_order);
+        }
+        else {
+            fem_changed |= ImGui::SliderInt("Elements", &solver.up.elements_count, 1, 100);
+        }
+        if (ImGui::Checkbox("Auto elements", &sp.auto_elements)) {
+            sp.solved = false;
+        }
+        if (sp.auto_elements) {
+            if (ImGui_Slider("Elements tolerance", &sp.elements_tolerance, 1e-6, 1e-1, "%.3g", ImGuiSliderFlags_Logarithmic)) {
+                sp.solved = false;
+            }
+        }
+        ImGui::Checkbox("Compact snapshots", &sp.compact_snapshots);
+        if (sp.compact_snapshots) {
+            ImGui::SliderInt("Kept borders stride", &sp.compact_stride, 1, 64, "%d", ImGuiSliderFlags_Logarithmic);
+        }
+        bool cache_changed = ImGui::Checkbox("Cache solutions", &sp.cache_solutions);
+        if (sp.cache_solutions) {
+            C_SolutionCache& cache = solver_worker.cache();
+            cache_changed |= ImGui::SliderInt("Cache budget (MiB)", &sp.cache_budget_mb, 1, 4096, "%d", ImGuiSliderFlags_Logarithmic);
+            cache_changed |= ImGui::Checkbox("Cache on disk", &sp.cache_on_disk);
+            ImGui::Text("Cached: %.1f MiB, %llu hits, %llu misses", (double)cache.memory_bytes() / (1 << 20),
+                        (unsigned long long)cache.hits(), (unsigned long long)cache.misses());
+        }
+        if (cache_changed) {
+            configure_cache();
+        }
         fem_changed |= ImGui::SliderInt("Corr solution", &solver.up.corr_selector, 0, 1);
 
         if (fem_changed) {
             setup(solver.up);
         }
 
+        int precision = solver.precision();
+        if (ImGui::Combo("Precision", &precision, "Double\0Float\0Mixed\0")) {
+            solver.set_precision(precision);
+            sp.solved = false;
+        }
+
         if (solver.was_setup()) {
             should_compute = sp.should_compute(&solver);
         }
     }
 
-    // Compute
+    // Compute (in the background)
+    // Changed parameters replace the solve in flight, otherwise it's waited for
     if (should_compute && !file_load_dialog.IsOpened() && !file_save_dialog.IsOpened()) {
-        compute(0, solver.up.elements_count);
-        copy_to_shaders(0, solver.up.elements_count);
+        if (!sp.solved || !solver_worker.busy()) {
+            request_solve();
+        }
     }
+    receive_solution();
+
+    frame_trace().process_gui();
 
     ImGui::End(); // MainWindow
 }
 
-void ShaderDrawer::compute(size_t begin, size_t end) {
-    solver.traverse(begin, end);
+void ShaderDrawer::request_solve() {
+    TRACE_SCOPE("ShaderDrawer::request_solve");
+    C_SolveRequest request;
+    request.up = solver.up;
+    request.precision = solver.precision();
+    size_t elements_count = solver.up.elements_count;
+    if (solver.has_EI_profile()) {
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            request.EI_profile.push_back(solver.element_EI(element_i));
+        }
+    }
+    if (solver.has_weight_profile()) {
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            request.weight_profile.push_back(solver.element_weight(element_i));
+        }
+    }
+    request.auto_fit_angle = sp.auto_fit_angle;
+    request.fp = sp.fit_params();
+    request.auto_elements = sp.auto_elements;
+    request.cp.tolerance = sp.elements_tolerance;
+    request.compact_snapshot = sp.compact_snapshots;
+    request.compact.stride = sp.compact_stride;
+    request.use_cache = sp.cache_solutions;
+
+    requested_generation = solver_worker.submit(std::move(request));
     sp.solved = true;
-    sp.accept_solution(&solver);
 }
 
-void ShaderDrawer::copy_to_shaders(size_t begin, size_t end) {
+void ShaderDrawer::receive_solution() {
+    TRACE_SCOPE("ShaderDrawer::receive_solution");
+    const C_SolveSnapshot* snapshot = solver_worker.take();
+    if (snapshot == nullptr) {
+        return;
+    }
+    // Solutions of older requests are shown while the latest one is being solved, as long as they fit the buffers
+    // (the next one is then uploaded whole, as its changes are relative to the skipped one)
+    if (snapshot->up.elements_count != solver.up.elements_count) {
+        // Except for the latest one's elements count picked by refinement, which is adopted
+        if (!sp.auto_elements || snapshot->generation != requested_generation) {
+            shaders_stale = true;
+            return;
+        }
+        solver.setup(snapshot->up);
+        ensure_sb();
+    }
+
+    // Only the elements that changed since the last solution are uploaded
+    size_t elements_count = solver.up.elements_count;
+    size_t changed_begin = shaders_stale ? 0 : std::min(snapshot->changed_begin, elements_count);
+    if (snapshot->compact.stored()) {
+        copy_to_shaders(snapshot->compact, changed_begin, elements_count);
+    }
+    else {
+        copy_to_shaders(snapshot->elements.data(), changed_begin, elements_count);
+    }
+    shaders_stale = false;
+    solution_shown = true;
+    shown_up = snapshot->up;
+
+    // The latest one is also taken as the solver's solution (e.g. for saving)
+    if (snapshot->generation == requested_generation) {
+        // Compact ones are only recomputed when needed
+        solver_elements_pending = snapshot->compact.stored();
+        if (solver_elements_pending) {
+            solver_compact = snapshot->compact;
+        }
+        else {
+            std::copy(snapshot->elements.begin(), snapshot->elements.end(), solver.elements);
+        }
+        solver.up.initial_angle = snapshot->up.initial_angle;
+        sp.accept_solution(&solver, snapshot->fit);
+        if (!snapshot->convergence.levels.empty()) {
+            sp.elements_error = snapshot->convergence.last().error;
+            sp.elements_order = snapshot->convergence.order;
+        }
+        solver.mark_solved();
+    }
+}
+
+void ShaderDrawer::copy_to_shaders(const C_Element* elements, size_t begin, size_t end) {
+    TRACE_SCOPE("ShaderDrawer::copy_to_shaders");
     GLSL_Element *glsl_elements = sb.get_buffer_ptr();
-    if (glsl_elements != nullptr) {
-        for (size_t element_i = begin; element_i < end; ++element_i) {
-            C_Element c_element = solver.elements[element_i];
-            GLSL_Element glsl_element = C2GLSL_Element(c_element);
-            glsl_elements[element_i] = glsl_element;
+    if (glsl_elements != nullptr && begin < end) {
+        C2GLSL_Elements(elements + begin, end - begin, glsl_elements + begin);
+        sb.commit(begin, end);
+    }
+}
+
+void ShaderDrawer::copy_to_shaders(const C_CompactSolution& compact, size_t begin, size_t end) {
+    TRACE_SCOPE("ShaderDrawer::copy_to_shaders");
+    const size_t chunk_elements = 4096;
+
+    GLSL_Element *glsl_elements = sb.get_buffer_ptr();
+    if (glsl_elements != nullptr && begin < end) {
+        std::vector<C_Element> chunk(std::min(end - begin, chunk_elements));
+        for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_elements) {
+            size_t chunk_end = std::min(chunk_begin + chunk_elements, end);
+            compact.expand(chunk_begin, chunk_end, chunk.data());
+            C2GLSL_Elements(chunk.data(), chunk_end - chunk_begin, glsl_elements + chunk_begin);
         }
+        sb.commit(begin, end);
+    }
+}
+
+void ShaderDrawer::configure_cache() {
+    C_SolutionCache& cache = solver_worker.cache();
+    cache.set_memory_budget(sp.cache_solutions ? (size_t)std::max(sp.cache_budget_mb, 0) << 20 : 0);
+    if (sp.cache_solutions && sp.cache_on_disk) {
+        std::error_code error;
+        std::filesystem::path dir = std::filesystem::temp_directory_path(error) / SOLUTION_CACHE_DIR;
+        cache.set_disk_tier(dir.string(), SOLUTION_CACHE_DISK_BUDGET);
+    }
+    else {
+        cache.set_disk_tier("", 0);
+    }
+}
+
+void ShaderDrawer::ensure_solver_elements() {
+    if (solver_elements_pending && solver_compact.up.elements_count == solver.up.elements_count) {
+        solver_compact.expand(0, (size_t)solver.up.elements_count + 1, solver.elements);
     }
+    solver_elements_pending = false;
 }
 
 void draw_grid_n_axes(C_float zoom, std::array<C_float, 2> look_at, C_float line_gap = 0.1) {
+    TRACE_SCOPE("draw_grid_n_axes");
     // Grid
     glBegin(GL_LINES);
     glColor3f(0.1, 0.1, 0.1);
@@ -463,9 +658,10 @@ void draw_grid_n_axes(C_float zoom, std::array<C_float, 2> look_at, C_float line
 void ShaderDrawer::draw() {
     draw_grid_n_axes(vp.zoom, vp.look_at, 0.1);
 
-    if (sp.solved) {
-        C_UniformParams c_up = solver.up;
+    if (solution_shown) {
+        C_UniformParams c_up = shown_up;
         GLSL_UniformParams glsl_up = C2GLSL_UniformParams(c_up);
+        sb.set_adaptive_segments(vp.adaptive_segments, GLSL_float(vp.segment_error_px));
         sb.draw(glsl_up, GLSL_float(vp.zoom), { GLSL_float(vp.look_at[0]), GLSL_float(vp.look_at[1]) }, vp.dashed);
     }
     file_load_dialog.Display();
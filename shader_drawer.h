@@ -2,12 +2,15 @@
 #define SHADERBEAMS_SHADER_DRAWER_H
 
 #include "Solver.h"
+#include "SolutionFile.h"
+#include "SolverWorker.h"
 #include "shader_buffers.h"
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Window/Event.hpp>
 #include <imgui.h>
 #include <imfilebrowser.h>
+#include <memory>
 
 
 #if C_USE_DOUBLE_PRECISION
@@ -20,10 +23,14 @@ inline bool ImGui_Slider(const char* label, C_float* v, C_float v_min, C_float v
     return ImGui::SliderScalar(label, C_ImGuiDataType, v, &v_min, &v_max, format, flags);
 }
 
-#define VisualParams_FIELDS disabled, segments_count, dashed, zoom, look_at, mouse_pressed, mouse_initial, look_at_initial
+#define VisualParams_FIELDS disabled, segments_count, adaptive_segments, segment_error_px, dashed, zoom, look_at, \
+                            mouse_pressed, mouse_initial, look_at_initial
 struct VisualParams {
     bool disabled = false;
     int segments_count = 0;
+    // Segments per element from its curvature on screen (see ShaderBuffers::set_adaptive_segments), or segments_count
+    bool adaptive_segments = true;
+    C_float segment_error_px = 0.25;
     bool dashed = false;
     C_float zoom = 0.1f;
     std::array<C_float, 2> look_at = {0.0, 0.0};
@@ -35,18 +42,37 @@ struct VisualParams {
 };
 
 
-#define SolverParams_FIELDS solved, auto_solve, auto_fit_angle, fit_threshold, fit_rate, fit_deviation
+#define SolverParams_FIELDS solved, auto_solve, auto_fit_angle, fit_threshold, fit_max_iterations, fit_deviation, fit_iterations, \
+                            auto_elements, elements_tolerance, elements_error, elements_order, compact_snapshots, compact_stride, \
+                            cache_solutions, cache_budget_mb, cache_on_disk
 struct SolverParams {
     bool solved = false;
     bool auto_solve = true;
     bool auto_fit_angle = true;
     C_float fit_threshold = 1e-3;
-    C_float fit_rate = 0.1;
+    int fit_max_iterations = 100;
     C_float fit_deviation = 0.0;
+    int fit_iterations = 0;
+    // Of the last solve (not saved)
+    C_TraverseStatus traverse_status;
+    // Elements count picked by mesh refinement, with its estimated error & the observed order of convergence
+    bool auto_elements = false;
+    C_float elements_tolerance = 1e-3;
+    C_float elements_error = 0.0;
+    C_float elements_order = 0.0;
+    // Solutions come from the worker as kept borders (see C_CompactSolution), for beams of very many elements
+    bool compact_snapshots = false;
+    int compact_stride = 4;
+    // Problems solved before (e.g. sliders moved back) are shown from the cache, without solving them again
+    bool cache_solutions = true;
+    int cache_budget_mb = 256;
+    bool cache_on_disk = false;
 
     bool should_compute(C_Solver* solver);
 
-    void accept_solution(C_Solver* solver);
+    [[nodiscard]] C_FitParams fit_params() const;
+
+    void accept_solution(C_Solver* solver, const C_FitResult& fit);
 };
 
 
@@ -79,11 +105,38 @@ private:
 
     void free_sb();
 
-    void compute(size_t begin, size_t end);
+    // Hands the current problem to the solver worker
+    void request_solve();
+
+    // Shows the worker's latest solution (if there's a new one)
+    void receive_solution();
+
+    void copy_to_shaders(const C_Element* elements, size_t begin, size_t end);
+
+    // Same, with the elements recomputed from kept borders (a chunk at a time)
+    void copy_to_shaders(const C_CompactSolution& compact, size_t begin, size_t end);
+
+    // Recomputes the solver's elements from the latest compact solution, if they weren't yet
+    void ensure_solver_elements();
 
-    void copy_to_shaders(size_t begin, size_t end);
+    // Applies the cache's parameters to the worker's cache
+    void configure_cache();
 
+    // Problem being edited (& its latest solution, once received)
     C_Solver solver;
+    C_SolverWorker solver_worker;
+    uint64_t requested_generation = 0;
+
+    // Solution in the shaders' buffers & the parameters it was solved for
+    bool solution_shown = false;
+    C_UniformParams shown_up {};
+    // Whether the buffers need a whole solution (rather than its changes)
+    bool shaders_stale = true;
+    // Latest compact solution, until the solver's elements are recomputed from it (e.g. for saving)
+    C_CompactSolution solver_compact;
+    bool solver_elements_pending = false;
+    // Last loaded binary file (the solver may still use its elements in place)
+    std::unique_ptr<C_SolutionFile> solution_file;
     ShaderBuffers sb;
     sf::RenderWindow *window;
 
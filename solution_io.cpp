@@ -0,0 +1,565 @@
+#include "solution_io.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using json = nlohmann::json;
+
+
+// Sets the solver up from j["problem"], with the optional per-element profiles
+static void setup_from_problem_json(const json& problem_j, C_Solver* solver) {
+    C_UniformParams up = problem_j;
+    solver->setup(up);
+
+    if (problem_j.contains("element_EI")) {
+        const json& j_profile = problem_j["element_EI"];
+        for (size_t element_i = 0; element_i < j_profile.size() && element_i < (size_t)up.elements_count; ++element_i) {
+            solver->set_element_EI(element_i, j_profile[element_i].template get<C_float>());
+        }
+    }
+    if (problem_j.contains("element_weight")) {
+        const json& j_profile = problem_j["element_weight"];
+        for (size_t element_i = 0; element_i < j_profile.size() && element_i < (size_t)up.elements_count; ++element_i) {
+            solver->set_element_weight(element_i, j_profile[element_i].template get<C_float>());
+        }
+    }
+}
+
+bool solution_from_json(const json& j, C_Solver* solver) {
+    const json& problem_j = j["problem"];
+    C_UniformParams up = problem_j;
+    setup_from_problem_json(problem_j, solver);
+
+    if (!j.contains("solution")) {
+        return false;
+    }
+
+    const json& el_j = j["solution"];
+    assert(el_j.size() == (size_t)up.elements_count + 1);
+
+    C_Element *c_elements = solver->elements;
+
+    for (auto& element : el_j) {
+        C_Element c_el = element.template get<C_Element>();
+        *c_elements++ = c_el;
+    }
+
+    return true;
+}
+
+void solution_to_json(json& j, const C_Solver* solver, int segments_count) {
+    j["problem"] = solver->up;
+    size_t elements_count = (size_t)solver->up.elements_count;
+
+    if (solver->has_EI_profile()) {
+        auto j_profile = json::array();
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            j_profile.push_back(solver->element_EI(element_i));
+        }
+        j["problem"]["element_EI"] = j_profile;
+    }
+    if (solver->has_weight_profile()) {
+        auto j_profile = json::array();
+        for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+            j_profile.push_back(solver->element_weight(element_i));
+        }
+        j["problem"]["element_weight"] = j_profile;
+    }
+
+    auto j_elements = json::array();
+    C_Element *c_elements = solver->elements;
+    for (size_t element_i = 0; element_i <= elements_count; ++element_i) {
+        C_Element c_el = c_elements[element_i];
+        j_elements.push_back(c_el);
+    }
+    j["solution"] = j_elements;
+
+    if (segments_count > 0) {
+        size_t samples_count = (size_t)segments_count + 1;
+        size_t borders_count = elements_count + 1;
+        C_float each_length = solver->up.total_length / (C_float)solver->up.elements_count;
+
+        std::vector<C_float> s(samples_count);
+        for (size_t segment_i = 0; segment_i < samples_count; ++segment_i) {
+            s[segment_i] = each_length * (C_float)segment_i / segments_count;
+        }
+
+        // All samples are computed up front (in parallel), the JSON is only built from them
+        std::vector<C_Element> samples(borders_count * samples_count);
+        C_ThreadPool::shared().parallel_for(0, borders_count, 64, [&](size_t element_i, size_t) {
+            solver->sample(element_i, s.data(), samples_count, &samples[element_i * samples_count]);
+        });
+
+        auto j_elements_seg_outer = json::array();
+        for (size_t element_i = 0; element_i < borders_count; ++element_i) {
+            auto j_elements_seg_inner = json::array();
+
+            for (size_t segment_i = 0; segment_i < samples_count; ++segment_i) {
+                j_elements_seg_inner.push_back(samples[element_i * samples_count + segment_i]);
+            }
+
+            j_elements_seg_outer.push_back(j_elements_seg_inner);
+        }
+        j["solution_seg"] = j_elements_seg_outer;
+    }
+}
+
+// Streaming writer: numbers are formatted straight into the stream, one element per line
+
+// Shortest representation that reads back exactly (non-finite numbers aren't JSON, they're written as null)
+static void write_number(std::ostream& o, C_float value) {
+    if (!std::isfinite(value)) {
+        o << "null";
+        return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    o.write(buffer, result.ptr - buffer);
+}
+
+static void write_field(std::ostream& o, const char* key, C_float value, bool first = false) {
+    if (!first) {
+        o << ',';
+    }
+    o << '"' << key << "\":";
+    write_number(o, value);
+}
+
+static void write_basis(std::ostream& o, const C_Basis& tn) {
+    o << ",\"tn\":{\"t\":[";
+    write_number(o, tn.t[0]);
+    o << ',';
+    write_number(o, tn.t[1]);
+    o << "],\"n\":[";
+    write_number(o, tn.n[0]);
+    o << ',';
+    write_number(o, tn.n[1]);
+    o << "]}";
+}
+
+static void write_element(std::ostream& o, const C_Element& el) {
+    o << "{\"full\":{";
+    write_field(o, "x", el.full.x, true);
+    write_field(o, "y", el.full.y);
+    write_field(o, "M", el.full.M);
+    write_field(o, "T", el.full.T);
+    write_basis(o, el.full.tn);
+    write_field(o, "Fx", el.full.Fx);
+    write_field(o, "Fy", el.full.Fy);
+
+    o << "},\"base\":{";
+    write_field(o, "u", el.base.u, true);
+    write_field(o, "w", el.base.w);
+    write_field(o, "M", el.base.M);
+    write_field(o, "T", el.base.T);
+    write_basis(o, el.base.tn);
+
+    o << "},\"corr\":{";
+    write_field(o, "u", el.corr.u, true);
+    write_field(o, "w", el.corr.w);
+    write_field(o, "M", el.corr.M);
+    write_field(o, "T", el.corr.T);
+    write_field(o, "N", el.corr.N);
+    write_field(o, "Q", el.corr.Q);
+    write_field(o, "Pt", el.corr.Pt);
+    write_field(o, "Pn", el.corr.Pn);
+    o << "}}";
+}
+
+static void write_profile(std::ostream& o, const char* key, const C_Solver* solver, bool EI) {
+    o << ",\n        \"" << key << "\": [";
+    for (size_t element_i = 0; element_i < (size_t)solver->up.elements_count; ++element_i) {
+        if (element_i > 0) {
+            o << ',';
+        }
+        write_number(o, EI ? solver->element_EI(element_i) : solver->element_weight(element_i));
+    }
+    o << ']';
+}
+
+void solution_write_json(std::ostream& o, const json& j, const C_Solver* solver, int segments_count) {
+    o << "{\n";
+
+    // Other top-level fields are small
+    for (auto& item : j.items()) {
+        if (item.key() == "problem" || item.key() == "solution" || item.key() == "solution_seg") {
+            continue;
+        }
+        o << "    " << json(item.key()).dump() << ": " << item.value().dump() << ",\n";
+    }
+
+    // Problem goes first, so that readers know the elements count before the elements
+    o << "    \"problem\": {";
+    bool first = true;
+    json up_j = solver->up;
+    for (auto& item : up_j.items()) {
+        o << (first ? "\n        " : ",\n        ") << json(item.key()).dump() << ": " << item.value().dump();
+        first = false;
+    }
+    if (solver->has_EI_profile()) {
+        write_profile(o, "element_EI", solver, true);
+    }
+    if (solver->has_weight_profile()) {
+        write_profile(o, "element_weight", solver, false);
+    }
+    o << "\n    },\n";
+
+    o << "    \"solution\": [";
+    size_t elements_count = (size_t)solver->up.elements_count + 1;
+    for (size_t element_i = 0; element_i < elements_count; ++element_i) {
+        o << (element_i == 0 ? "\n        " : ",\n        ");
+        write_element(o, solver->elements[element_i]);
+    }
+    o << "\n    ]";
+
+    if (segments_count > 0) {
+        size_t samples_count = (size_t)segments_count + 1;
+        C_float each_length = solver->up.total_length / (C_float)solver->up.elements_count;
+
+        std::vector<C_float> s(samples_count);
+        for (size_t segment_i = 0; segment_i < samples_count; ++segment_i) {
+            s[segment_i] = each_length * (C_float)segment_i / segments_count;
+        }
+
+        // Samples are computed (in parallel) for a chunk of elements at a time, & written before the next chunk
+        const size_t chunk_elements_count = 1024;
+        std::vector<C_Element> samples(std::min(chunk_elements_count, elements_count) * samples_count);
+
+        o << ",\n    \"solution_seg\": [";
+        for (size_t chunk_begin = 0; chunk_begin < elements_count; chunk_begin += chunk_elements_count) {
+            size_t chunk_end = std::min(chunk_begin + chunk_elements_count, elements_count);
+            C_ThreadPool::shared().parallel_for(chunk_begin, chunk_end, 64, [&](size_t element_i, size_t) {
+                solver->sample(element_i, s.data(), samples_count, &samples[(element_i - chunk_begin) * samples_count]);
+            });
+
+            for (size_t element_i = chunk_begin; element_i < chunk_end; ++element_i) {
+                o << (element_i == 0 ? "\n        [" : ",\n        [");
+                for (size_t segment_i = 0; segment_i < samples_count; ++segment_i) {
+                    if (segment_i > 0) {
+                        o << ',';
+                    }
+                    write_element(o, samples[(element_i - chunk_begin) * samples_count + segment_i]);
+                }
+                o << ']';
+            }
+        }
+        o << "\n    ]";
+    }
+
+    o << "\n}\n";
+}
+
+
+// Whether all fields of C_UniformParams are present
+static bool has_problem_fields(const json& problem_j) {
+    json fields = C_UniformParams {};
+    for (auto& item : fields.items()) {
+        if (!problem_j.contains(item.key())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// SAX reader: builds a DOM of everything but the large arrays
+// Elements of "solution" & the profiles are parsed straight into the solver, "solution_seg" is skipped
+class SolutionSax {
+public:
+    SolutionSax(json& new_j, C_Solver* new_solver) : j(new_j), solver(new_solver) {}
+
+    bool null() { return value(json(nullptr), NAN); }
+    bool boolean(bool v) { return value(json(v), v ? 1.0 : 0.0); }
+    bool number_integer(json::number_integer_t v) { return value(json(v), (C_float)v); }
+    bool number_unsigned(json::number_unsigned_t v) { return value(json(v), (C_float)v); }
+    bool number_float(json::number_float_t v, const json::string_t&) { return value(json(v), (C_float)v); }
+    bool string(json::string_t& v) { return value(json(v), NAN); }
+    bool binary(json::binary_t& v) { return value(json(v), NAN); }
+
+    bool start_object(size_t) {
+        if (mode == MODE_DOM) {
+            dom_stack.push_back(dom_add(json::object()));
+            return true;
+        }
+        if (mode == MODE_SOLUTION && depth == 0) {
+            // Next element
+            if (elements_read > (size_t)solver->up.elements_count) {
+                error = "too many elements in \"solution\"";
+                return false;
+            }
+            element = &solver->elements[elements_read++];
+            *element = C_Element {};
+        }
+        ++depth;
+        return true;
+    }
+
+    bool end_object() {
+        if (mode == MODE_DOM) {
+            dom_stack.pop_back();
+            return true;
+        }
+        --depth;
+        return true;
+    }
+
+    bool start_array(size_t) {
+        if (mode == MODE_DOM) {
+            // Large arrays are only expected at the top level & as the problem's profiles
+            if (dom_stack.size() == 1 && top_key == "solution") {
+                if (!j.contains("problem")) {
+                    error = "\"solution\" comes before \"problem\"";
+                    return false;
+                }
+                setup();
+                mode = MODE_SOLUTION;
+                depth = 0;
+                return true;
+            }
+            if (dom_stack.size() == 2 && top_key == "problem" &&
+                (dom_key == "element_EI" || dom_key == "element_weight") && has_problem_fields(j["problem"])) {
+                setup();
+                mode = MODE_PROFILE;
+                profile_EI = dom_key == "element_EI";
+                array_index = 0;
+                depth = 0;
+                return true;
+            }
+            if (dom_stack.size() == 1 && top_key == "solution_seg") {
+                mode = MODE_SKIP;
+                depth = 0;
+                return true;
+            }
+            dom_stack.push_back(dom_add(json::array()));
+            return true;
+        }
+        ++depth;
+        array_index = 0;
+        return true;
+    }
+
+    bool end_array() {
+        if (mode == MODE_DOM) {
+            dom_stack.pop_back();
+            return true;
+        }
+        if (depth == 0) {
+            // End of the large array
+            if (mode == MODE_SOLUTION) {
+                solution_read = true;
+            }
+            mode = MODE_DOM;
+            return true;
+        }
+        --depth;
+        return true;
+    }
+
+    bool key(json::string_t& k) {
+        if (mode == MODE_DOM) {
+            dom_key = k;
+            if (dom_stack.size() == 1) {
+                top_key = k;
+            }
+        }
+        else if (depth >= 1 && depth <= 3) {
+            keys[depth - 1] = k;
+        }
+        return true;
+    }
+
+    bool parse_error(size_t, const std::string&, const nlohmann::detail::exception& e) {
+        error = e.what();
+        return false;
+    }
+
+    // Sets the solver up from the problem read so far (once, as the profiles may already be read into it)
+    void setup() {
+        if (!setup_done) {
+            setup_from_problem_json(j["problem"], solver);
+            setup_done = true;
+        }
+    }
+
+    // Whether "solution" was read completely
+    [[nodiscard]] bool loaded() const {
+        return solution_read && elements_read == (size_t)solver->up.elements_count + 1;
+    }
+
+    std::string error;
+
+private:
+    bool value(json v, C_float number) {
+        if (mode == MODE_DOM) {
+            dom_add(std::move(v));
+            return true;
+        }
+        if (mode == MODE_PROFILE) {
+            if (depth == 0 && array_index < solver->up.elements_count) {
+                if (profile_EI) {
+                    solver->set_element_EI(array_index, number);
+                }
+                else {
+                    solver->set_element_weight(array_index, number);
+                }
+            }
+            ++array_index;
+        }
+        if (mode == MODE_SOLUTION) {
+            C_float* field = nullptr;
+            if (depth == 2) {
+                field = element_field(*element, keys[0], keys[1]);
+            }
+            else if (depth == 4 && keys[1] == "tn" && array_index < 2) {
+                C_Basis* tn = keys[0] == "full" ? &element->full.tn : keys[0] == "base" ? &element->base.tn : nullptr;
+                if (tn != nullptr) {
+                    field = keys[2] == "t" ? &tn->t[array_index] : keys[2] == "n" ? &tn->n[array_index] : nullptr;
+                }
+                ++array_index;
+            }
+            if (field != nullptr) {
+                *field = number;
+            }
+        }
+        return true;
+    }
+
+    // Field of an element by its part ("full", "base" or "corr") & name (nullptr for unknown ones)
+    static C_float* element_field(C_Element& el, const std::string& part, const std::string& name) {
+        if (part == "full") {
+            C_SolutionFull& f = el.full;
+            return name == "x" ? &f.x : name == "y" ? &f.y : name == "M" ? &f.M : name == "T" ? &f.T :
+                   name == "Fx" ? &f.Fx : name == "Fy" ? &f.Fy : nullptr;
+        }
+        if (part == "base") {
+            C_SolutionBase& b = el.base;
+            return name == "u" ? &b.u : name == "w" ? &b.w : name == "M" ? &b.M : name == "T" ? &b.T : nullptr;
+        }
+        if (part == "corr") {
+            C_SolutionCorr& c = el.corr;
+            return name == "u" ? &c.u : name == "w" ? &c.w : name == "M" ? &c.M : name == "T" ? &c.T :
+                   name == "N" ? &c.N : name == "Q" ? &c.Q : name == "Pt" ? &c.Pt : name == "Pn" ? &c.Pn : nullptr;
+        }
+        return nullptr;
+    }
+
+    // Adds a value to the container being built (or makes it the document)
+    json* dom_add(json v) {
+        if (dom_stack.empty()) {
+            j = std::move(v);
+            return &j;
+        }
+        json& parent = *dom_stack.back();
+        if (parent.is_array()) {
+            parent.push_back(std::move(v));
+            return &parent.back();
+        }
+        parent[dom_key] = std::move(v);
+        return &parent[dom_key];
+    }
+
+    static const int MODE_DOM = 0;
+    static const int MODE_SOLUTION = 1;
+    static const int MODE_SKIP = 2;
+    static const int MODE_PROFILE = 3;
+
+    json& j;
+    C_Solver* solver;
+
+    int mode = MODE_DOM;
+    std::vector<json*> dom_stack;
+    std::string dom_key, top_key;
+
+    // Nesting within the large array, keys of the element's part, field & basis vector
+    int depth = 0;
+    std::string keys[3];
+    int array_index = 0;
+    C_Element* element = nullptr;
+    size_t elements_read = 0;
+    bool solution_read = false;
+    bool setup_done = false;
+    bool profile_EI = false;
+};
+
+bool solution_read_json(std::istream& i, json& j, C_Solver* solver) {
+    SolutionSax sax(j, solver);
+    if (!json::sax_parse(i, &sax)) {
+        fprintf(stderr, "Error parsing solution: %s\n", sax.error.c_str());
+        // Partially read files are dropped altogether
+        j = json();
+        return false;
+    }
+    if (!j.contains("problem")) {
+        return false;
+    }
+    sax.setup();
+    return sax.loaded();
+}
+
+template<typename T>
+std::vector<T> sweep_axis_from_json(const json& j_sweep, const char* field) {
+    std::vector<T> axis;
+    if (!j_sweep.contains(field)) {
+        return axis;
+    }
+
+    const json& j_axis = j_sweep[field];
+    if (j_axis.is_array()) {
+        for (auto& value : j_axis) {
+            axis.push_back(value.template get<T>());
+        }
+        return axis;
+    }
+
+    double from = j_axis.at("from"), to = j_axis.at("to");
+    int count = j_axis.value("count", 2);
+    bool log = j_axis.value("log", false);
+    for (int value_i = 0; value_i < count; ++value_i) {
+        double t = (count > 1) ? double(value_i) / double(count - 1) : 0.0;
+        double value = log ? from * pow(to / from, t) : from + (to - from) * t;
+        axis.push_back(std::is_integral<T>::value ? T(lround(value)) : T(value));
+    }
+    return axis;
+}
+
+C_SweepGrid sweep_grid_from_json(const json& j) {
+    C_SweepGrid grid;
+    grid.base = j["problem"];
+
+    const json& j_sweep = j["sweep"];
+    grid.corr_selector = sweep_axis_from_json<int>(j_sweep, "corr_selector");
+    grid.EI = sweep_axis_from_json<C_float>(j_sweep, "EI");
+    grid.total_weight = sweep_axis_from_json<C_float>(j_sweep, "total_weight");
+    grid.total_length = sweep_axis_from_json<C_float>(j_sweep, "total_length");
+    grid.elements_count = sweep_axis_from_json<int>(j_sweep, "elements_count");
+
+    return grid;
+}
+
+json convergence_to_json(const C_ConvergenceResult& result) {
+    json j_levels = json::array();
+    for (const C_ConvergenceLevel& level : result.levels) {
+        j_levels.push_back({
+            {"elements_count", level.elements_count},
+            {"initial_angle", level.initial_angle},
+            {"difference", level.difference},
+            {"error", level.error},
+            {"fit_iterations", level.fit.iterations},
+            {"seconds", level.seconds},
+        });
+    }
+
+    return {
+        {"converged", result.converged},
+        {"elements_count", result.last().elements_count},
+        {"error", result.last().error},
+        {"order", result.order},
+        {"extrapolated_initial_angle", result.extrapolated_initial_angle},
+        {"extrapolated_end", result.extrapolated_end},
+        {"levels", j_levels},
+    };
+}
@@ -0,0 +1,47 @@
+#ifndef SHADERBEAMS_SOLUTION_IO_H
+#define SHADERBEAMS_SOLUTION_IO_H
+
+#include "Convergence.h"
+#include "Solver.h"
+#include "Sweep.h"
+
+#include <nlohmann/json.hpp>
+
+#include <istream>
+#include <ostream>
+
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_UniformParams, C_UniformParams_FIELDS)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_Basis, C_Basis_FIELDS)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_SolutionFull, C_SolutionFull_FIELDS)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_SolutionBase, C_SolutionBase_FIELDS)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_SolutionCorr, C_SolutionCorr_FIELDS)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(C_Element, C_Element_FIELDS)
+
+// Sets up the solver from j["problem"] and fills its elements from j["solution"] (if present)
+// j["problem"] may also hold per-element "element_EI" & "element_weight" arrays
+// Returns whether the solution was loaded
+bool solution_from_json(const nlohmann::json& j, C_Solver* solver);
+
+// Writes j["problem"] & j["solution"]
+// If segments_count > 0, also writes each element sampled at segments_count + 1 points to j["solution_seg"]
+void solution_to_json(nlohmann::json& j, const C_Solver* solver, int segments_count = 0);
+
+// Streaming counterparts of the above, for large solutions (memory doesn't grow with the file's size)
+// Reads the file into j, except for "solution" (parsed straight into the solver's elements), the profiles & "solution_seg"
+// "problem" has to precede "solution" (as it does in files written by either writer)
+// Returns whether the solution was loaded (j is left empty if the file couldn't be parsed)
+bool solution_read_json(std::istream& i, nlohmann::json& j, C_Solver* solver);
+
+// Writes the other fields of j, then "problem", "solution" & "solution_seg" (sampled a chunk of elements at a time)
+void solution_write_json(std::ostream& o, const nlohmann::json& j, const C_Solver* solver, int segments_count = 0);
+
+// Levels, order & extrapolated end state of a mesh refinement
+nlohmann::json convergence_to_json(const C_ConvergenceResult& result);
+
+// Builds a grid from j["problem"] (base values) & j["sweep"], where each swept field is either
+// an explicit array of values or a range {"from": a, "to": b, "count": n, "log": false}
+C_SweepGrid sweep_grid_from_json(const nlohmann::json& j);
+
+
+#endif //SHADERBEAMS_SOLUTION_IO_H